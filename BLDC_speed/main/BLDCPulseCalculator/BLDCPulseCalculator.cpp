@@ -5,14 +5,17 @@
 BLDCPulseCalculator::BLDCPulseCalculator(gpio_num_t wavePin, uint8_t motorId) :
 wavePin(wavePin), 
 motorId(motorId),
+counter(0),
+lastTimeStamp(0),
+hasLastTimeStamp(false),
+lastEdgeMicros(0),
+expectedPeriodMicros(0),
+seenOverflowCount(0),
 speed(0)
 {
-  memset((void *)(timePeriodValues), 0, sizeof(timePeriodValues));
-  memset((void *)(newTimePeriodValues), 0, sizeof(newTimePeriodValues));
+  memset(timePeriodValues, 0, sizeof(timePeriodValues));
+  memset(newTimePeriodValues, 0, sizeof(newTimePeriodValues));
 
-  this->counter=0;
-  this->nextTimeStamp=0;
-  this->timeStamp=0;
   // instance = this;
 }
 
@@ -99,60 +102,94 @@ void BLDCPulseCalculator::begin(const BaseType_t app_cpu) {
 }
 
 void BLDCPulseCalculator::calculateValuesInternal() {
-  // static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
-  portENTER_CRITICAL_ISR(&mux);
+  // Only publish the timestamp, all period math happens in motorSpeedTask.
+  // The 32-bit microsecond counter wraps every ~71 minutes, unsigned differences stay valid.
+  edgeBuffer.push(static_cast<uint32_t>(esp_timer_get_time()));
+}
 
-  timeStamp = esp_timer_get_time() / 1000;  // Convert to milliseconds
-  timePeriodValues[counter] = static_cast<uint32_t>(timeStamp - nextTimeStamp);
+void BLDCPulseCalculator::addPeriod(uint32_t period) {
+  timePeriodValues[counter] = period;
   counter = counter + 1;
-  nextTimeStamp = timeStamp;
 
-  if ((counter % 2) == 0 && counter != 0) {
+  if ((counter % 2) == 0) {
     newTimePeriodValues[counter / 2 - 1] = timePeriodValues[counter - 1] + timePeriodValues[counter - 2];
   }
 
   if (counter == 32) {
+    uint32_t sumTime = 0;
     counter = 0;
-    status = BLDCstates::PRINT;
-  }
 
-  portEXIT_CRITICAL_ISR(&mux);
+    for (int i = 0; i < 16; i++) {
+      sumTime += newTimePeriodValues[i];
+    }
+
+    // sumTime spans one revolution in microseconds, round to the nearest RPM
+    if (sumTime > 0) {
+      speed.store(static_cast<uint16_t>((MICROS_PER_MINUTE + sumTime / 2) / sumTime), std::memory_order_relaxed);
+      expectedPeriodMicros = sumTime / EDGES_PER_REVOLUTION;
+    }
+    // ESP_LOGI("MOTOR", "Speed %u", getSpeed());
+  }
 }
 
+void BLDCPulseCalculator::checkStandstill(uint32_t nowMicros) {
+  if (!hasLastTimeStamp && getSpeed() == 0) return;
+
+  const uint32_t elapsedMicros = nowMicros - lastEdgeMicros;
+  const bool stopped = (expectedPeriodMicros != 0)
+    ? (elapsedMicros > expectedPeriodMicros * STOP_PERIODS)
+    : (elapsedMicros > ZERO_SPEED_TIMEOUT_US);
+
+  if (stopped) {
+    speed.store(0, std::memory_order_relaxed);
+    hasLastTimeStamp = false;
+    expectedPeriodMicros = 0;
+    counter = 0;
+    return;
+  }
+
+  // The edge in flight is already elapsedMicros long, the wheel cannot be faster than that
+  if (expectedPeriodMicros != 0 && elapsedMicros > expectedPeriodMicros * DECELERATION_PERIODS) {
+    const uint32_t upperBound = MICROS_PER_MINUTE / (EDGES_PER_REVOLUTION * elapsedMicros);
+    if (upperBound < getSpeed()) {
+      speed.store(static_cast<uint16_t>(upperBound), std::memory_order_relaxed);
+    }
+  }
+}
 
 void BLDCPulseCalculator::motorSpeed() {
-  uint32_t sumTime = 0;
-
-  switch (status) {
-    case BLDCstates::PRINT:
-      for (int i = 0; i < 16; i++) {
-        sumTime += newTimePeriodValues[i];
-      }
-
-      // timePeriod = (uint32_t *)(sumTime / 16.0);
-      // speed = (uint16_t)(3750 / timePeriod);
-
-      speed = static_cast<uint16_t>(60000 / sumTime);
-      // ESP_LOGI("MOTOR", "Speed %u", speed);
-      // Serial.println(speed);
-
-      // OLEDFunctions::displayRPM(speed, motorId);
-      // if(motorId == 1)
-      // {
-      //   itoa(speed, OLEDFunctions::oledSpeed1, 10); // Using base 10
-      // }
-      // else
-      // {
-      //   itoa(speed, OLEDFunctions::oledSpeed2, 10); // Using base 10
-      // }
-
-      sumTime = 0;
-      status = BLDCstates::IDLE;
-      break;
-
-    case BLDCstates::IDLE:
-      break;
+  uint32_t timeStamp;
+  const uint32_t nowMicros = static_cast<uint32_t>(esp_timer_get_time());
+
+  // Edges were dropped while the ring was full, the next period would span the gap
+  const uint32_t overflowCount = edgeBuffer.getOverflowCount();
+  if (overflowCount != seenOverflowCount) {
+    ESP_LOGW("MOTOR", "Motor %d dropped %u edges", motorId, static_cast<unsigned>(overflowCount - seenOverflowCount));
+    seenOverflowCount = overflowCount;
+    edgeBuffer.clear();
+    hasLastTimeStamp = false;
+    lastEdgeMicros = nowMicros;
+    counter = 0;
   }
+
+  while (edgeBuffer.pop(timeStamp)) {
+    lastEdgeMicros = timeStamp;
+    if (hasLastTimeStamp) {
+      addPeriod(timeStamp - lastTimeStamp);
+    }
+    lastTimeStamp = timeStamp;
+    hasLastTimeStamp = true;
+  }
+
+  checkStandstill(nowMicros);
+}
+
+uint16_t BLDCPulseCalculator::getSpeed() {
+  return speed.load(std::memory_order_relaxed);
+}
+
+uint32_t BLDCPulseCalculator::getOverflowCount() {
+  return edgeBuffer.getOverflowCount();
 }
 
 void IRAM_ATTR BLDCPulseCalculator::staticCalculateValuesWrapper(void *args) {
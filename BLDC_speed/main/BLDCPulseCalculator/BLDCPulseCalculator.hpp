@@ -3,34 +3,51 @@
 #include <driver/gpio.h>
 #include <esp_log.h>
 #include <cstring>
+#include <atomic>
 #include "esp_timer.h"
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
 #include <freertos/task.h>
 // #include "oledFunctions.hpp"
+#include "EdgeRingBuffer.hpp"
 
 class BLDCPulseCalculator {
 private:
-  portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
-
   gpio_num_t wavePin;
   uint8_t motorId;
 
-  volatile uint8_t counter;
-  volatile unsigned long nextTimeStamp;
-  volatile unsigned long timeStamp;
+  // Edge timestamps are kept in microseconds so short Hall periods are not quantized
+  static constexpr uint32_t MICROS_PER_MINUTE = 60000000UL;
+  static constexpr uint32_t EDGES_PER_REVOLUTION = 32;
+
+  // Standstill is judged against the expected edge period at the last measured speed,
+  // past DECELERATION_PERIODS the elapsed time bounds the speed, past STOP_PERIODS it is zero.
+  // ZERO_SPEED_TIMEOUT_US is the fallback before the first full revolution.
+  static constexpr uint32_t DECELERATION_PERIODS = 2;
+  static constexpr uint32_t STOP_PERIODS = 4;
+  static constexpr uint32_t ZERO_SPEED_TIMEOUT_US = 2000000;
+
+  // 256 edges cover 8 revolutions, enough headroom for the 100 ms task period at 3000+ RPM
+  static constexpr size_t EDGE_BUFFER_SIZE = 256;
 
-  volatile uint32_t timePeriodValues[32];
-  volatile uint32_t newTimePeriodValues[16];
+  // ISR -> task hand-over, the ISR only ever touches this ring
+  EdgeRingBuffer<uint32_t, EDGE_BUFFER_SIZE> edgeBuffer;
 
-  volatile uint16_t speed;
+  // Task-side state, never touched by the ISR
+  uint8_t counter;
+  uint32_t lastTimeStamp;
+  bool hasLastTimeStamp;
+  uint32_t lastEdgeMicros;
+  uint32_t expectedPeriodMicros;
+  uint32_t seenOverflowCount;
 
+  uint32_t timePeriodValues[32];
+  uint32_t newTimePeriodValues[16];
 
-  enum class BLDCstates : uint8_t {
-    IDLE,
-    PRINT
-  };
-  volatile BLDCstates status = BLDCstates::IDLE;
+  std::atomic<uint16_t> speed;
+
+  inline void addPeriod(uint32_t period) __attribute__((always_inline));
+  inline void checkStandstill(uint32_t nowMicros) __attribute__((always_inline));
 
   // static BLDCPulseCalculator* instance;
   
@@ -44,6 +61,9 @@ public:
   
   inline void calculateValuesInternal(void) __attribute__((always_inline));
   inline void motorSpeed() __attribute__((always_inline));
+
+  uint16_t getSpeed();
+  uint32_t getOverflowCount();
   
   static inline void motorSpeedTask(void*) __attribute__((always_inline));
 
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/*
+  Single-producer / single-consumer ring of edge timestamps.
+
+  - The GPIO ISR is the only producer and the only writer of head and overflowCount.
+  - The speed task is the only consumer and the only writer of tail.
+
+  Each index is owned by exactly one side, so push() and pop() need no critical section,
+  only acquire/release ordering between the slot write and the index publish.
+  Head and tail are free running counters, the slot is (index & MASK).
+  When the ring is full the newest edge is dropped and counted, the consumer uses the
+  overflow counter to know that the timestamp sequence has a gap.
+*/
+template <typename T, size_t Capacity>
+class EdgeRingBuffer {
+private:
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+  static constexpr uint32_t MASK = Capacity - 1;
+
+  T buffer[Capacity];
+  std::atomic<uint32_t> head;
+  std::atomic<uint32_t> tail;
+  std::atomic<uint32_t> overflowCount;
+
+public:
+  EdgeRingBuffer();
+
+  // Producer side (ISR)
+  inline bool push(T value) __attribute__((always_inline));
+
+  // Consumer side (task)
+  inline bool pop(T &value) __attribute__((always_inline));
+  inline void clear() __attribute__((always_inline));
+
+  inline uint32_t size() const __attribute__((always_inline));
+  inline uint32_t getOverflowCount() const __attribute__((always_inline));
+  static constexpr size_t capacity() { return Capacity; }
+};
+
+template <typename T, size_t Capacity>
+EdgeRingBuffer<T, Capacity>::EdgeRingBuffer() :
+head(0),
+tail(0),
+overflowCount(0)
+{}
+
+template <typename T, size_t Capacity>
+bool EdgeRingBuffer<T, Capacity>::push(T value) {
+  const uint32_t currentHead = head.load(std::memory_order_relaxed);
+
+  if (currentHead - tail.load(std::memory_order_acquire) >= Capacity) {
+    // Single writer, a plain load/store avoids a read-modify-write on the ISR path
+    overflowCount.store(overflowCount.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    return false;
+  }
+
+  buffer[currentHead & MASK] = value;
+  head.store(currentHead + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename T, size_t Capacity>
+bool EdgeRingBuffer<T, Capacity>::pop(T &value) {
+  const uint32_t currentTail = tail.load(std::memory_order_relaxed);
+
+  if (currentTail == head.load(std::memory_order_acquire)) {
+    return false;
+  }
+
+  value = buffer[currentTail & MASK];
+  tail.store(currentTail + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename T, size_t Capacity>
+void EdgeRingBuffer<T, Capacity>::clear() {
+  tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+template <typename T, size_t Capacity>
+uint32_t EdgeRingBuffer<T, Capacity>::size() const {
+  return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+}
+
+template <typename T, size_t Capacity>
+uint32_t EdgeRingBuffer<T, Capacity>::getOverflowCount() const {
+  return overflowCount.load(std::memory_order_acquire);
+}
@@ -3,11 +3,13 @@
 #include <driver/gpio.h>
 #include <esp_log.h>
 #include <cstring>
+#include <atomic>
 #include "esp_timer.h"
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
 #include <freertos/task.h>
 #include "oledFunctions.hpp"
+#include "EdgeRingBuffer.hpp"
 
 class BLDCPulseCalculator {
 private:
@@ -15,20 +17,29 @@ private:
   gpio_num_t feedBackPin;
   uint8_t motorId;
 
-  volatile uint8_t counter;
-  volatile unsigned long nextTimeStamp;
-  volatile unsigned long timeStamp;
+  // Edge timestamps are kept in microseconds so short Hall periods are not quantized
+  static constexpr uint32_t MICROS_PER_MINUTE = 60000000UL;
+  static constexpr uint32_t ZERO_SPEED_TIMEOUT_US = 2000000;
 
-  volatile uint32_t timePeriodValues[32];
-  volatile uint32_t newTimePeriodValues[16];
+  // 256 edges cover 8 revolutions, enough headroom for the 100 ms task period at 3000+ RPM
+  static constexpr size_t EDGE_BUFFER_SIZE = 256;
 
-  volatile uint16_t speed;
+  // ISR -> task hand-over, the ISR only ever touches this ring
+  EdgeRingBuffer<uint32_t, EDGE_BUFFER_SIZE> edgeBuffer;
 
-  enum class BLDCstates : uint8_t {
-    IDLE,
-    PRINT
-  };
-  volatile BLDCstates status = BLDCstates::IDLE;
+  // Task-side state, never touched by the ISR
+  uint8_t counter;
+  uint32_t lastTimeStamp;
+  bool hasLastTimeStamp;
+  uint32_t seenOverflowCount;
+
+  uint32_t timePeriodValues[32];
+  uint32_t newTimePeriodValues[16];
+
+  std::atomic<uint16_t> speed;
+
+  inline void addPeriod(uint32_t period) __attribute__((always_inline));
+  inline void displaySpeed() __attribute__((always_inline));
 
   // static BLDCPulseCalculator* instance;
   
@@ -39,6 +50,7 @@ public:
   inline void motorSpeed() __attribute__((always_inline));
 
   inline uint16_t getSpeed() __attribute__((always_inline));
+  inline uint32_t getOverflowCount() __attribute__((always_inline));
   inline void begin(TaskHandle_t &, const BaseType_t = 1) __attribute__((always_inline));
 
   //FreeRTOS
@@ -51,13 +63,14 @@ public:
 BLDCPulseCalculator::BLDCPulseCalculator(gpio_num_t feedBackPin, uint8_t motorId) :
 feedBackPin(feedBackPin), 
 motorId(motorId),
-speed(0),
 counter(0),
-nextTimeStamp(0),
-timeStamp(0)
+lastTimeStamp(0),
+hasLastTimeStamp(false),
+seenOverflowCount(0),
+speed(0)
 {
-  memset((void *)(timePeriodValues), 0, sizeof(timePeriodValues));
-  memset((void *)(newTimePeriodValues), 0, sizeof(newTimePeriodValues));
+  memset(timePeriodValues, 0, sizeof(timePeriodValues));
+  memset(newTimePeriodValues, 0, sizeof(newTimePeriodValues));
 }
 
 /* 
@@ -150,71 +163,85 @@ void BLDCPulseCalculator::begin(TaskHandle_t &taskHandle, const BaseType_t app_c
 }
 
 void BLDCPulseCalculator::calculateValuesInternal() {
-  // static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
-  // portENTER_CRITICAL_ISR(&mux);
+  // Only publish the timestamp, all period math happens in motorSpeedTask.
+  // The 32-bit microsecond counter wraps every ~71 minutes, unsigned differences stay valid.
+  edgeBuffer.push(static_cast<uint32_t>(esp_timer_get_time()));
+}
 
-  timeStamp = esp_timer_get_time() / 1000;  // Convert to milliseconds
-  timePeriodValues[counter] = static_cast<uint32_t>(timeStamp - nextTimeStamp);
+void BLDCPulseCalculator::addPeriod(uint32_t period) {
+  timePeriodValues[counter] = period;
   counter = counter + 1;
-  nextTimeStamp = timeStamp;
 
-  if ((counter % 2) == 0 && counter != 0) {
+  if ((counter % 2) == 0) {
     newTimePeriodValues[counter / 2 - 1] = timePeriodValues[counter - 1] + timePeriodValues[counter - 2];
   }
 
   if (counter == 32) {
+    uint32_t sumTime = 0;
     counter = 0;
-    status = BLDCstates::PRINT;
-  }
 
-  // portEXIT_CRITICAL_ISR(&mux);
+    for (int i = 0; i < 16; i++) {
+      sumTime += newTimePeriodValues[i];
+    }
+
+    // sumTime spans one revolution in microseconds, round to the nearest RPM
+    if (sumTime > 0) {
+      speed.store(static_cast<uint16_t>((MICROS_PER_MINUTE + sumTime / 2) / sumTime), std::memory_order_relaxed);
+    }
+    displaySpeed();
+  }
 }
 
+void BLDCPulseCalculator::displaySpeed() {
+  // OLEDFunctions::displayRPM(speed, motorId);
+  if(motorId == 1)
+  {
+    itoa(getSpeed(), OLEDFunctions::oledSpeed1, 10); // Using base 10
+  }
+  else
+  {
+    itoa(getSpeed(), OLEDFunctions::oledSpeed2, 10); // Using base 10
+  }
+}
 
 void BLDCPulseCalculator::motorSpeed() {
-  uint32_t sumTime = 0;
-
-  switch (status) {
-    case BLDCstates::PRINT:
-      for (int i = 0; i < 16; i++) {
-        sumTime += newTimePeriodValues[i];
-      }
-
-      // timePeriod = (uint32_t *)(sumTime / 16.0);
-      // speed = (uint16_t)(3750 / timePeriod);
-
-      speed = static_cast<uint16_t>(60000 / sumTime);
-      // ESP_LOGI("MOTOR", "Speed %u", speed);
-      // Serial.println(speed);
-
-      // OLEDFunctions::displayRPM(speed, motorId);
-      if(motorId == 1)
-      {
-        itoa(speed, OLEDFunctions::oledSpeed1, 10); // Using base 10
-      }
-      else
-      {
-        itoa(speed, OLEDFunctions::oledSpeed2, 10); // Using base 10
-      }
-
-      sumTime = 0;
-      status = BLDCstates::IDLE;
-      break;
-
-    case BLDCstates::IDLE:
-      // This is to set the speed to 0 when the wheel is not moving
-      if(((esp_timer_get_time() / 1000) - nextTimeStamp) > 2000)
-      {
-        speed = 0;
-        if(motorId == 1)
-          itoa(speed, OLEDFunctions::oledSpeed1, 10); // Using base 10
-        else
-          itoa(speed, OLEDFunctions::oledSpeed2, 10); // Using base 10
-      }
-      break;
+  uint32_t timeStamp;
+
+  // Edges were dropped while the ring was full, the next period would span the gap
+  const uint32_t overflowCount = edgeBuffer.getOverflowCount();
+  if (overflowCount != seenOverflowCount) {
+    seenOverflowCount = overflowCount;
+    edgeBuffer.clear();
+    lastTimeStamp = static_cast<uint32_t>(esp_timer_get_time());
+    hasLastTimeStamp = false;
+    counter = 0;
+  }
+
+  while (edgeBuffer.pop(timeStamp)) {
+    if (hasLastTimeStamp) {
+      addPeriod(timeStamp - lastTimeStamp);
+    }
+    lastTimeStamp = timeStamp;
+    hasLastTimeStamp = true;
+  }
+
+  // This is to set the speed to 0 when the wheel is not moving
+  if ((hasLastTimeStamp || getSpeed() != 0) && (static_cast<uint32_t>(esp_timer_get_time()) - lastTimeStamp) > ZERO_SPEED_TIMEOUT_US) {
+    speed.store(0, std::memory_order_relaxed);
+    hasLastTimeStamp = false;
+    counter = 0;
+    displaySpeed();
   }
 }
 
+uint16_t BLDCPulseCalculator::getSpeed() {
+  return speed.load(std::memory_order_relaxed);
+}
+
+uint32_t BLDCPulseCalculator::getOverflowCount() {
+  return edgeBuffer.getOverflowCount();
+}
+
 void IRAM_ATTR BLDCPulseCalculator::staticCalculateValuesWrapper(void *args) {
   BLDCPulseCalculator* instance = static_cast<BLDCPulseCalculator*>(args);
   if (instance) {
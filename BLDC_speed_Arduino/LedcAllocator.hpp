@@ -0,0 +1,178 @@
+#pragma once
+
+#include "driver/ledc.h"
+#include "esp_log.h"
+
+/*
+  Hands out LEDC timers and channels to every PWM output of the firmware.
+
+  - A timer is shared by all channels asking for the same frequency and resolution, each
+    distinct pair costs one timer. Channels on one timer are phase aligned.
+  - Both speed modes are used: high speed first, then low speed, 2 x 4 timers and 2 x 8
+    channels on the ESP32. A channel always sits in the speed mode of its timer.
+  - Running out is an error return, never an abort. The caller keeps the output disabled,
+    getFailedCount() makes it visible in the status.
+  - A timer is configured when its first channel is allocated and free again with its last.
+
+  Allocate during setup (static construction included), the tables are not locked.
+*/
+class LedcAllocator {
+public:
+  struct Channel {
+    ledc_mode_t mode;
+    ledc_timer_t timer;
+    ledc_channel_t channel;
+  };
+
+  static constexpr uint8_t MODE_COUNT = LEDC_SPEED_MODE_MAX;
+  static constexpr uint8_t TIMERS_PER_MODE = LEDC_TIMER_MAX;
+  static constexpr uint8_t CHANNELS_PER_MODE = LEDC_CHANNEL_MAX;
+
+private:
+  struct TimerSlot {
+    uint32_t frequency;
+    uint8_t resolution;
+    uint8_t users;          // 0 = free
+  };
+
+  // Zero initialized before any constructor runs
+  static TimerSlot timers[MODE_COUNT][TIMERS_PER_MODE];
+  static bool channels[MODE_COUNT][CHANNELS_PER_MODE];
+  static uint32_t failedCount;
+
+  static bool claimChannel(ledc_mode_t mode, ledc_timer_t timer, Channel &out);
+  static void fail(const char *what, uint32_t frequency, uint8_t resolution);
+
+public:
+  // A channel on a timer running frequency/resolution, configuring a free timer if none does
+  static esp_err_t allocate(uint32_t frequency, ledc_timer_bit_t resolution, Channel &out);
+
+  // Another channel on the timer of an earlier allocation
+  static esp_err_t allocateOnTimer(const Channel &sibling, Channel &out);
+
+  static void release(const Channel &allocation);
+
+  static uint8_t getChannelsInUse();
+  static uint8_t getTimersInUse();
+  inline static uint8_t getChannelCount() { return MODE_COUNT * CHANNELS_PER_MODE; }
+  inline static uint32_t getFailedCount() { return failedCount; }
+};
+
+LedcAllocator::TimerSlot LedcAllocator::timers[LedcAllocator::MODE_COUNT][LedcAllocator::TIMERS_PER_MODE];
+bool LedcAllocator::channels[LedcAllocator::MODE_COUNT][LedcAllocator::CHANNELS_PER_MODE];
+uint32_t LedcAllocator::failedCount = 0;
+
+bool LedcAllocator::claimChannel(ledc_mode_t mode, ledc_timer_t timer, Channel &out) {
+  for (uint8_t c = 0; c < CHANNELS_PER_MODE; c++) {
+    if (channels[mode][c]) continue;
+
+    channels[mode][c] = true;
+    timers[mode][timer].users++;
+    out.mode = mode;
+    out.timer = timer;
+    out.channel = static_cast<ledc_channel_t>(c);
+    return true;
+  }
+  return false;
+}
+
+void LedcAllocator::fail(const char *what, uint32_t frequency, uint8_t resolution) {
+  failedCount++;
+  ESP_LOGE("LedcAllocator", "No %s for %u Hz %d-bit PWM: %d/%d channels, %d/%d timers in use",
+           what, static_cast<unsigned>(frequency), resolution, getChannelsInUse(), getChannelCount(),
+           getTimersInUse(), MODE_COUNT * TIMERS_PER_MODE);
+}
+
+esp_err_t LedcAllocator::allocate(uint32_t frequency, ledc_timer_bit_t resolution, Channel &out) {
+  // A timer already running this configuration
+  for (uint8_t m = 0; m < MODE_COUNT; m++) {
+    for (uint8_t t = 0; t < TIMERS_PER_MODE; t++) {
+      const TimerSlot &slot = timers[m][t];
+      if (slot.users == 0 || slot.frequency != frequency || slot.resolution != resolution) continue;
+
+      if (claimChannel(static_cast<ledc_mode_t>(m), static_cast<ledc_timer_t>(t), out)) {
+        return ESP_OK;
+      }
+    }
+  }
+
+  // A free timer in a speed mode that still has a free channel
+  bool timerFree = false;
+  for (uint8_t m = 0; m < MODE_COUNT; m++) {
+    for (uint8_t t = 0; t < TIMERS_PER_MODE; t++) {
+      if (timers[m][t].users != 0) continue;
+      timerFree = true;
+
+      const ledc_mode_t mode = static_cast<ledc_mode_t>(m);
+      const ledc_timer_t timer = static_cast<ledc_timer_t>(t);
+      if (!claimChannel(mode, timer, out)) break;   // Mode full, try the other one
+
+      ledc_timer_config_t ledc_timer = {
+        .speed_mode = mode,
+        .duty_resolution = resolution,
+        .timer_num = timer,
+        .freq_hz = frequency,
+        .clk_cfg = LEDC_AUTO_CLK
+      };
+      esp_err_t err = ledc_timer_config(&ledc_timer);
+      if (err != ESP_OK) {
+        release(out);
+        failedCount++;
+        ESP_LOGE("LedcAllocator", "Timer config for %u Hz %d-bit failed: %s", static_cast<unsigned>(frequency), resolution, esp_err_to_name(err));
+        return err;
+      }
+
+      timers[m][t].frequency = frequency;
+      timers[m][t].resolution = resolution;
+      return ESP_OK;
+    }
+  }
+
+  fail(timerFree ? "channel" : "timer", frequency, resolution);
+  return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t LedcAllocator::allocateOnTimer(const Channel &sibling, Channel &out) {
+  const TimerSlot &slot = timers[sibling.mode][sibling.timer];
+  if (slot.users == 0) {
+    ESP_LOGE("LedcAllocator", "Timer %d of mode %d is not allocated", sibling.timer, sibling.mode);
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  if (!claimChannel(sibling.mode, sibling.timer, out)) {
+    fail("channel", slot.frequency, slot.resolution);
+    return ESP_ERR_NOT_FOUND;
+  }
+  return ESP_OK;
+}
+
+void LedcAllocator::release(const Channel &allocation) {
+  if (!channels[allocation.mode][allocation.channel]) return;
+
+  ledc_stop(allocation.mode, allocation.channel, 0);
+  channels[allocation.mode][allocation.channel] = false;
+  TimerSlot &slot = timers[allocation.mode][allocation.timer];
+  if (slot.users > 0) {
+    slot.users--;
+  }
+}
+
+uint8_t LedcAllocator::getChannelsInUse() {
+  uint8_t count = 0;
+  for (uint8_t m = 0; m < MODE_COUNT; m++) {
+    for (uint8_t c = 0; c < CHANNELS_PER_MODE; c++) {
+      if (channels[m][c]) count++;
+    }
+  }
+  return count;
+}
+
+uint8_t LedcAllocator::getTimersInUse() {
+  uint8_t count = 0;
+  for (uint8_t m = 0; m < MODE_COUNT; m++) {
+    for (uint8_t t = 0; t < TIMERS_PER_MODE; t++) {
+      if (timers[m][t].users != 0) count++;
+    }
+  }
+  return count;
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "driver/ledc.h"
+#include "LedcAllocator.hpp"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 // #include "esp_log.h"
@@ -10,6 +11,7 @@ class PwmGenerator {
   gpio_num_t pwmPin;
   uint32_t frequency;
   ledc_timer_bit_t resolution;
+  ledc_mode_t speedMode;
   ledc_timer_t timer;
   ledc_channel_t channel;
   uint8_t dutyCycle;
@@ -33,23 +35,23 @@ frequency(frequency),
 resolution(resolution),
 dutyCycle(0)
 {
-  // Initialize timer and channel
-  timer = LEDC_TIMER_0; // Choose the timer number
-  channel = LEDC_CHANNEL_0; // Choose the channel number
-
-  ledc_timer_config_t ledc_timer = {
-    .speed_mode = LEDC_HIGH_SPEED_MODE,
-    .duty_resolution = resolution,
-    .timer_num = timer,
-    .freq_hz = frequency,
-    .clk_cfg = LEDC_AUTO_CLK
-    // .deconfigure = false // Do not de-configure the timer
-  };
-  ESP_ERROR_CHECK(ledc_timer_config(&ledc_timer));
+  // Timer shared with every output of the same frequency and resolution, own channel
+  LedcAllocator::Channel allocation;
+  if (LedcAllocator::allocate(frequency, resolution, allocation) != ESP_OK) {
+    ESP_LOGE("PwmGenerator", "No LEDC channel for GPIO %d, PWM output disabled", pwmPin);
+    this->pwmPin = GPIO_NUM_NC;
+    speedMode = LEDC_HIGH_SPEED_MODE;
+    timer = LEDC_TIMER_0;
+    channel = LEDC_CHANNEL_0;
+    return;
+  }
+  speedMode = allocation.mode;
+  timer = allocation.timer;
+  channel = allocation.channel;
 
   ledc_channel_config_t ledc_channel = {
     .gpio_num = pwmPin,
-    .speed_mode = LEDC_HIGH_SPEED_MODE,
+    .speed_mode = speedMode,
     .channel = channel,
     .intr_type = LEDC_INTR_DISABLE,
     .timer_sel = timer,
@@ -83,7 +85,8 @@ void PwmGenerator::begin(TaskHandle_t &taskHandle, const BaseType_t app_cpu) {
 
 void PwmGenerator::front() {
   // Update PwmGenerator duty cycle
-  ledc_update_duty(LEDC_HIGH_SPEED_MODE, channel);
+  if (pwmPin == GPIO_NUM_NC) return;
+  ledc_update_duty(speedMode, channel);
   vTaskDelay(pdMS_TO_TICKS(10));
 }
 
@@ -92,7 +95,8 @@ uint8_t PwmGenerator::getPwm() {
 }
 
 void PwmGenerator::setPwm(uint8_t dutyCycle) {
-  ledc_set_duty(LEDC_HIGH_SPEED_MODE, channel, dutyCycle);
+  if (pwmPin == GPIO_NUM_NC) return;
+  ledc_set_duty(speedMode, channel, dutyCycle);
 }
 
 void PwmGenerator::frontTask(void* pvParameters) {
@@ -3,73 +3,283 @@
 #include <driver/gpio.h>
 #include <esp_log.h>
 #include <cstring>
+#include <atomic>
 #include "esp_timer.h"
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
 #include <freertos/task.h>
+#include <driver/pulse_cnt.h>
+#include "CaptureBackend.hpp"
+#include "EdgeRingBuffer.hpp"
+#include "PeriodWindow.hpp"
+#include "EdgeFilter.hpp"
+#include "MotorGeometry.hpp"
+#include "McpwmCaptureTimer.hpp"
+#include "EdgeClock.hpp"
+#include "DerivativeEstimator.hpp"
+#include "MeasurementModeSelector.hpp"
+#include "EdgeRecorder.hpp"
+#include "SectorCalibration.hpp"
+#include "HallDiagnostics.hpp"
 
+// Build flags, set them with -D to tune the speed estimate without editing the class
+// - SPEED_WINDOW_EDGE_COUNT    : edge periods averaged by the hub motor window (one revolution)
+// - SPEED_EDGE_SMOOTHING_ALPHA : per-edge exponential smoothing on top of the window, 1.0 = off
+#ifndef SPEED_WINDOW_EDGE_COUNT
+#define SPEED_WINDOW_EDGE_COUNT 32
+#endif
+
+#ifndef SPEED_EDGE_SMOOTHING_ALPHA
+#define SPEED_EDGE_SMOOTHING_ALPHA 1.0f
+#endif
+
+// Geometry is a MotorGeometry<> describing pulses per revolution, window length and period unit
+template <typename Geometry>
 class BLDCPulseCalculator {
+public:
+  // Magnet spacing correction, one sector per edge of a revolution
+  using SectorTable = SectorCalibration<Geometry::EDGES_PER_REVOLUTION>;
+
 private:
   gpio_num_t feedBackPin;
   uint8_t motorId;
+  CaptureBackend backend;
 
-  volatile uint8_t counter;
-  volatile unsigned long nextTimeStamp;
-  volatile unsigned long timeStamp;
+  // Edges are captured in backend ticks and converted to Geometry::Unit periods in the task
+  static constexpr float MICROS_PER_MINUTE = 60000000.0f;
 
-  volatile uint32_t timePeriodValues[32];
-  volatile uint32_t newTimePeriodValues[16];
+  // Standstill is judged against the expected edge period at the last measured speed:
+  // past DECELERATION_PERIODS without an edge the wheel can at most turn at the speed the
+  // elapsed time implies and that bound is reported, past STOP_PERIODS it is declared stopped.
+  // ZERO_SPEED_TIMEOUT_US is the fallback when no period has been measured yet.
+  static constexpr uint32_t DECELERATION_PERIODS = 2;
+  static constexpr uint32_t STOP_PERIODS = 4;
+  static constexpr uint32_t ZERO_SPEED_TIMEOUT_US = 2000000;
 
-  volatile uint16_t speed;
+  // Acceleration and jerk come from a quadratic fit over the last 16 per-pulse speeds
+  static constexpr size_t DERIVATIVE_SAMPLES = 16;
 
-  enum class BLDCstates : uint8_t {
-    IDLE,
-    PRINT
-  };
-  volatile BLDCstates status = BLDCstates::IDLE;
+  // Speed is re-estimated on every edge over the last Geometry::WINDOW_EDGES periods
+  static constexpr uint8_t SPEED_WINDOW_EDGES = Geometry::WINDOW_EDGES;
+
+  // Optional exponential smoothing applied per edge on top of the window, 1.0 disables it
+  static constexpr float SPEED_SMOOTHING_ALPHA = SPEED_EDGE_SMOOTHING_ALPHA;
+  static_assert(SPEED_SMOOTHING_ALPHA > 0.0f && SPEED_SMOOTHING_ALPHA <= 1.0f, "Smoothing alpha must be in (0, 1]");
+
+  // 256 edges cover 8 revolutions, headroom if the task is starved of CPU for a while
+  static constexpr size_t EDGE_BUFFER_SIZE = 256;
+
+  // The ISR wakes the task every notifyEdgeCount edges (default: every edge),
+  // the timeout only matters for zero-speed detection while the wheel stands still
+  static constexpr uint8_t DEFAULT_NOTIFY_EDGE_COUNT = 1;
+  static constexpr uint32_t IDLE_TIMEOUT_MS = 100;
+
+  // Above the crossover the PCNT counts edges over a gate and the edge interrupt is disabled.
+  // 100 ms gate at 1500 RPM holds 80 edges of a 32 edge/rev motor, ~1% resolution.
+  static constexpr float FREQUENCY_CROSSOVER_RPM = 1500.0f;
+  static constexpr float FREQUENCY_HYSTERESIS = 0.1f;
+  static constexpr uint8_t MODE_CONFIRM_SAMPLES = 3;
+  static constexpr uint32_t FREQUENCY_GATE_US = IDLE_TIMEOUT_MS * 1000;
+  static constexpr uint32_t PCNT_GLITCH_FILTER_NS = 10000;
+  static constexpr int PCNT_HIGH_LIMIT = 32767;
+
+  // ISR -> task hand-over, the ISR only touches this ring and the filter lockout
+  EdgeRingBuffer<uint32_t, EDGE_BUFFER_SIZE> edgeBuffer;
+  EdgeFilter edgeFilter;
+
+  // Written once in begin() before the ISR is attached
+  TaskHandle_t speedTaskHandle;
+  uint32_t captureTicksPerMicro;
+  uint32_t captureWrapMicros;
+  mcpwm_cap_channel_handle_t captureChannel;
+  std::atomic<uint8_t> notifyEdgeCount;
+
+  // ISR-side state
+  uint8_t edgesSinceNotify;
+
+  // Task-side state, never touched by the ISR
+  uint32_t lastTimeStamp;
+  bool hasLastTimeStamp;
+  uint32_t lastEdgeMicros;
+  uint32_t expectedPeriodMicros;
+  uint32_t seenOverflowCount;
+  PeriodWindow<SPEED_WINDOW_EDGES> periodWindow;
+  float smoothedSpeed;
+
+  // Per-sector correction of magnet spacing, task-side. Learning is requested through
+  // sectorLearnRequest (revolutions) and a finished table is flagged for the store task.
+  SectorTable sectorCalibration;
+  std::atomic<uint16_t> sectorLearnRequest;
+  std::atomic<bool> sectorTableReady;
+  std::atomic<typename SectorTable::Status> sectorStatus;
+  std::atomic<float> instantSpeedRpm;
+
+  // Derivative estimate, task-side. edgeTimeMicros is the running time of the last edge,
+  // built from periods so it stays on one clock whatever the capture backend.
+  DerivativeEstimator<DERIVATIVE_SAMPLES> derivative;
+  uint32_t edgeTimeMicros;
+  uint32_t previousPeriodMicros;
+
+  // Frequency mode, task-side
+  pcnt_unit_handle_t pulseCounter;
+  MeasurementModeSelector modeSelector;
+  int lastPulseCount;
+  uint32_t lastGateMicros;
+  std::atomic<MeasurementModeSelector::Mode> measurementMode;
+
+  std::atomic<uint16_t> speed;
+  std::atomic<float> speedRpm;
+  std::atomic<float> acceleration;
+  std::atomic<float> jerk;
+
+  // Total edges since the last reset, 64-bit so it never wraps. Written by the speed task once
+  // per pass, the lock makes the two 32-bit halves consistent for readers on other tasks.
+  portMUX_TYPE odometryMux = portMUX_INITIALIZER_UNLOCKED;
+  uint64_t odometryEdges;
+
+  // Feedback health, fed from the speed task. driveDuty is the commanded PWM (0-255),
+  // written by whoever sets the PWM.
+  HallDiagnostics diagnostics;
+  std::atomic<uint8_t> driveDuty;
+  uint32_t seenLockoutRejects;
+
+  // Optional raw edge capture, fed from the speed task with the edges popped from the ring
+  EdgeRecorder *edgeRecorder;
+  uint8_t recorderChannel;
+
+  // Cycles spent in staticCalculateValuesWrapper, logged by the speed task
+#ifdef SPEED_ISR_PROFILING
+  IsrCycleProfile isrProfile;
+  static constexpr uint32_t PROFILE_REPORT_US = 5000000;
+#endif
+
+  inline void resetEstimate() __attribute__((always_inline));
+  inline void checkStandstill(uint32_t nowMicros) __attribute__((always_inline));
+  inline void beginGpioCapture() __attribute__((always_inline));
+  inline bool beginMcpwmCapture() __attribute__((always_inline));
+  inline bool beginPulseCounter() __attribute__((always_inline));
+
+  inline void measurePeriods(uint32_t nowMicros) __attribute__((always_inline));
+  inline void measureFrequency(uint32_t nowMicros) __attribute__((always_inline));
+  inline void updateMeasurementMode(float rpm, uint32_t nowMicros) __attribute__((always_inline));
+  inline void setEdgeInterrupt(bool enabled) __attribute__((always_inline));
+
+  inline void addPeriod(uint32_t periodMicros) __attribute__((always_inline));
+  inline void publishSpeed(float rpm) __attribute__((always_inline));
+  inline void addSpeedSample(uint32_t periodMicros) __attribute__((always_inline));
+  inline void publishDerivatives() __attribute__((always_inline));
+  inline void addOdometryEdges(uint32_t edges) __attribute__((always_inline));
+  inline void updateSectorCalibration() __attribute__((always_inline));
+  inline bool needsEveryEdge() __attribute__((always_inline));
 
 public:
-  inline BLDCPulseCalculator(gpio_num_t feedBackPin = GPIO_NUM_NC, uint8_t motorId = -1) __attribute__((always_inline));
-  inline void calculateValuesInternal(void) __attribute__((always_inline));
+  static constexpr uint32_t EDGES_PER_REVOLUTION = Geometry::EDGES_PER_REVOLUTION;
+
+  inline BLDCPulseCalculator(gpio_num_t feedBackPin = GPIO_NUM_NC, uint8_t motorId = -1, CaptureBackend backend = CaptureBackend::GPIO_ISR) __attribute__((always_inline));
+  inline BaseType_t calculateValuesInternal(uint32_t timeStamp) __attribute__((always_inline));
   inline void motorSpeed() __attribute__((always_inline));
 
   inline uint16_t getSpeed() __attribute__((always_inline));
+  inline float getSpeedRpm() __attribute__((always_inline));
+
+  // RPM from the latest single edge period, sector-corrected once calibrated and locked
+  inline float getInstantSpeed() __attribute__((always_inline));
+
+  // Sector calibration: learning runs in the speed task over the given number of steady
+  // revolutions. The table is loaded before begin() and taken by the store once learned.
+  inline void startSectorCalibration(uint16_t revolutions) __attribute__((always_inline));
+  inline typename SectorTable::Status getSectorCalibrationStatus() const { return sectorStatus.load(std::memory_order_relaxed); }
+  inline bool loadSectorTable(const float *table) __attribute__((always_inline));
+  inline bool takeSectorTable(float *table) __attribute__((always_inline));
+
+  // Angular acceleration in RPM/s and jerk in RPM/s^2 at the latest edge
+  inline float getAcceleration() __attribute__((always_inline));
+  inline float getJerk() __attribute__((always_inline));
+
+  // Odometry, safe from any task (not from an ISR). Edges dropped on ring overflow are not counted.
+  inline uint64_t getOdometryEdges() __attribute__((always_inline));
+  inline double getRevolutions() __attribute__((always_inline));
+  inline void resetOdometry() __attribute__((always_inline));
+  inline void restoreOdometry(uint64_t edges) __attribute__((always_inline));
+  inline uint32_t getOverflowCount() __attribute__((always_inline));
+  inline uint32_t getRejectedEdgeCount() __attribute__((always_inline));
+  inline const EdgeFilter &getEdgeFilter() const { return edgeFilter; }
+
+  // Hall fault codes (HallDiagnostics::Fault bits). The commanded duty lets the diagnostics
+  // tell a dead sensor from a wheel that is not driven.
+  inline void setDriveDuty(uint8_t duty) { driveDuty.store(duty, std::memory_order_relaxed); }
+  inline uint8_t getFaults() const { return diagnostics.getActiveFaults(); }
+  inline uint8_t getLatchedFaults() const { return diagnostics.getLatchedFaults(); }
+  inline void clearFaults() { diagnostics.clearLatched(); }
+  inline CaptureBackend getCaptureBackend() const { return backend; }
+  inline MeasurementModeSelector::Mode getMeasurementMode() const { return measurementMode.load(std::memory_order_relaxed); }
+  inline void setNotifyEdgeCount(uint8_t edges) __attribute__((always_inline));
+
+  // Registers this motor as a channel of the raw edge capture, call before recorder.begin()
+  inline bool setEdgeRecorder(EdgeRecorder &recorder) __attribute__((always_inline));
+
+  // How long the speed task may sleep without edges before standstill has to be re-checked
+  inline TickType_t getIdleTimeoutTicks() const __attribute__((always_inline));
   inline void begin(TaskHandle_t &, const BaseType_t = 1) __attribute__((always_inline));
 
+  // Sets up capture without a task or ISR of its own, edges notify speedTask and
+  // GPIO_ISR edges must be dispatched to calculateValuesInternal() by the caller (SpeedSensorBank)
+  inline bool attach(TaskHandle_t speedTask) __attribute__((always_inline));
+  inline gpio_num_t getFeedBackPin() const { return feedBackPin; }
+
   // FreeRTOS
   static inline void motorSpeedTask(void*) __attribute__((always_inline));
   static void staticCalculateValuesWrapper(void *);
+  static bool staticCaptureCallback(mcpwm_cap_channel_handle_t, const mcpwm_capture_event_data_t *, void *);
 };
 
-BLDCPulseCalculator::BLDCPulseCalculator(gpio_num_t feedBackPin, uint8_t motorId) :
+template <typename Geometry>
+BLDCPulseCalculator<Geometry>::BLDCPulseCalculator(gpio_num_t feedBackPin, uint8_t motorId, CaptureBackend backend) :
 feedBackPin(feedBackPin), 
 motorId(motorId),
+backend(backend),
+speedTaskHandle(nullptr),
+captureTicksPerMicro(1),
+captureWrapMicros(UINT32_MAX),
+captureChannel(nullptr),
+notifyEdgeCount(DEFAULT_NOTIFY_EDGE_COUNT),
+edgesSinceNotify(0),
+lastTimeStamp(0),
+hasLastTimeStamp(false),
+lastEdgeMicros(0),
+expectedPeriodMicros(0),
+seenOverflowCount(0),
+smoothedSpeed(0.0f),
+sectorLearnRequest(0),
+sectorTableReady(false),
+sectorStatus(SectorTable::Status::UNCALIBRATED),
+instantSpeedRpm(0.0f),
+edgeTimeMicros(0),
+previousPeriodMicros(0),
+pulseCounter(nullptr),
+modeSelector(FREQUENCY_CROSSOVER_RPM, FREQUENCY_HYSTERESIS, MODE_CONFIRM_SAMPLES),
+lastPulseCount(0),
+lastGateMicros(0),
+measurementMode(MeasurementModeSelector::Mode::PERIOD),
 speed(0),
-counter(0),
-nextTimeStamp(0),
-timeStamp(0)
-{
-  memset((void *)(timePeriodValues), 0, sizeof(timePeriodValues));
-  memset((void *)(newTimePeriodValues), 0, sizeof(newTimePeriodValues));
-}
+speedRpm(0.0f),
+acceleration(0.0f),
+jerk(0.0f),
+odometryEdges(0),
+diagnostics(Geometry::EDGES_PER_PULSE == 2),
+driveDuty(0),
+seenLockoutRejects(0),
+edgeRecorder(nullptr),
+recorderChannel(0)
+{}
 
-void BLDCPulseCalculator::begin(TaskHandle_t &taskHandle, const BaseType_t app_cpu) {
+template <typename Geometry>
+void BLDCPulseCalculator<Geometry>::begin(TaskHandle_t &taskHandle, const BaseType_t app_cpu) {
   if (feedBackPin == GPIO_NUM_NC) return; // Skip if pin not configured
 
   char *TAG = "BLDCPulseCalculator::begin";
 
-  gpio_config_t gpioOutputConfigure = {
-    .pin_bit_mask = (1ULL << this->feedBackPin),
-    .mode = GPIO_MODE_INPUT,
-    .pull_up_en = GPIO_PULLUP_DISABLE,
-    .pull_down_en = GPIO_PULLDOWN_ENABLE,
-    .intr_type = GPIO_INTR_ANYEDGE
-  };
-  ESP_ERROR_CHECK(gpio_config(&gpioOutputConfigure));
-
-  gpio_install_isr_service(0);
-  gpio_isr_handler_add(this->feedBackPin, staticCalculateValuesWrapper, (void*)(this));
-
+  // The task has to exist before the first edge tries to notify it
   if(taskHandle == nullptr) {
     BaseType_t result = xTaskCreatePinnedToCore(
       &motorSpeedTask,
@@ -89,65 +299,656 @@ void BLDCPulseCalculator::begin(TaskHandle_t &taskHandle, const BaseType_t app_c
   } else {
     ESP_LOGI(TAG, "motorSpeedTask already created for motor %d", motorId);
   }
+  attach(taskHandle);
+
+  if (backend == CaptureBackend::GPIO_ISR) {
+    gpio_install_isr_service(0);
+    gpio_isr_handler_add(this->feedBackPin, staticCalculateValuesWrapper, (void*)(this));
+  }
 }
 
-void BLDCPulseCalculator::calculateValuesInternal() {
-  timeStamp = esp_timer_get_time() / 1000;  // Convert to milliseconds
-  timePeriodValues[counter] = static_cast<uint32_t>(timeStamp - nextTimeStamp);
-  counter = counter + 1;
-  nextTimeStamp = timeStamp;
+template <typename Geometry>
+bool BLDCPulseCalculator<Geometry>::attach(TaskHandle_t speedTask) {
+  if (feedBackPin == GPIO_NUM_NC) return false;
 
-  if ((counter % 2) == 0 && counter != 0) {
-    newTimePeriodValues[counter / 2 - 1] = timePeriodValues[counter - 1] + timePeriodValues[counter - 2];
+  const char *TAG = "BLDCPulseCalculator::attach";
+
+  // The task has to be known before the first edge tries to notify it
+  speedTaskHandle = speedTask;
+
+  // pcnt_new_channel() runs gpio_config() on the pin, pulling it up and disabling its interrupt.
+  // The capture backend configures the pin after it, so its pull-down and edge interrupt win.
+  if (!beginPulseCounter()) {
+    ESP_LOGW(TAG, "No PCNT unit for motor %d, period measurement only", motorId);
+  }
+
+  if (backend == CaptureBackend::MCPWM_CAPTURE && !beginMcpwmCapture()) {
+    ESP_LOGW(TAG, "No MCPWM capture channel for motor %d, falling back to the GPIO ISR", motorId);
+    backend = CaptureBackend::GPIO_ISR;
   }
 
-  if (counter == 32) {
-    counter = 0;
-    status = BLDCstates::PRINT;
+  if (backend == CaptureBackend::GPIO_ISR) {
+    beginGpioCapture();
   }
+  return true;
 }
 
-void BLDCPulseCalculator::motorSpeed() {
-  uint32_t sumTime = 0;
+template <typename Geometry>
+void BLDCPulseCalculator<Geometry>::beginGpioCapture() {
+  gpio_config_t gpioOutputConfigure = {
+    .pin_bit_mask = (1ULL << this->feedBackPin),
+    .mode = GPIO_MODE_INPUT,
+    .pull_up_en = GPIO_PULLUP_DISABLE,
+    .pull_down_en = GPIO_PULLDOWN_ENABLE,
+    .intr_type = Geometry::EDGE_MODE
+  };
+  ESP_ERROR_CHECK(gpio_config(&gpioOutputConfigure));
+
+  // Timestamps are EdgeClock ticks, CPU cycles unless built for esp_timer
+  captureTicksPerMicro = EdgeClock::ticksPerMicro();
+  captureWrapMicros = UINT32_MAX / captureTicksPerMicro;
+  edgeFilter.setTicksPerMicro(captureTicksPerMicro);
+}
 
-  switch (status) {
-    case BLDCstates::PRINT:
-      for (int i = 0; i < 16; i++) {
-        sumTime += newTimePeriodValues[i];
-      }
+template <typename Geometry>
+bool BLDCPulseCalculator<Geometry>::beginMcpwmCapture() {
+  const char *TAG = "BLDCPulseCalculator::beginMcpwmCapture";
+
+  uint32_t resolutionHz = 0;
+  mcpwm_cap_timer_handle_t timer = McpwmCaptureTimer::acquireChannel(resolutionHz);
+  if (timer == nullptr) return false;
+
+  // The capture unit configures the pin itself, same pull-down as the GPIO path
+  mcpwm_capture_channel_config_t channelConfig = {};
+  channelConfig.gpio_num = feedBackPin;
+  channelConfig.prescale = 1;
+  channelConfig.flags.pos_edge = (Geometry::EDGE_MODE != GPIO_INTR_NEGEDGE);
+  channelConfig.flags.neg_edge = (Geometry::EDGE_MODE != GPIO_INTR_POSEDGE);
+  channelConfig.flags.pull_down = true;
+
+  esp_err_t err = mcpwm_new_capture_channel(timer, &channelConfig, &captureChannel);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to create capture channel for motor %d: %s", motorId, esp_err_to_name(err));
+    McpwmCaptureTimer::releaseChannel(timer);
+    captureChannel = nullptr;
+    return false;
+  }
+
+  // The 80 MHz capture counter wraps every ~53 s, far above the zero-speed timeout
+  captureTicksPerMicro = resolutionHz / 1000000;
+  captureWrapMicros = UINT32_MAX / captureTicksPerMicro;
+  edgeFilter.setTicksPerMicro(captureTicksPerMicro);
+
+  mcpwm_capture_event_callbacks_t callbacks = {};
+  callbacks.on_cap = staticCaptureCallback;
+  ESP_ERROR_CHECK(mcpwm_capture_channel_register_event_callbacks(captureChannel, &callbacks, this));
+  ESP_ERROR_CHECK(mcpwm_capture_channel_enable(captureChannel));
+
+  ESP_LOGI(TAG, "Motor %d captured by MCPWM at %u ticks/us", motorId, static_cast<unsigned>(captureTicksPerMicro));
+  return true;
+}
+
+template <typename Geometry>
+bool BLDCPulseCalculator<Geometry>::beginPulseCounter() {
+  const char *TAG = "BLDCPulseCalculator::beginPulseCounter";
+
+  // accum_count extends the 16-bit hardware counter in software at the high limit watch point
+  pcnt_unit_config_t unitConfig = {};
+  unitConfig.low_limit = -1;
+  unitConfig.high_limit = PCNT_HIGH_LIMIT;
+  unitConfig.flags.accum_count = 1;
+
+  esp_err_t err = pcnt_new_unit(&unitConfig, &pulseCounter);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to create PCNT unit for motor %d: %s", motorId, esp_err_to_name(err));
+    pulseCounter = nullptr;
+    return false;
+  }
+
+  pcnt_glitch_filter_config_t filterConfig = {};
+  filterConfig.max_glitch_ns = PCNT_GLITCH_FILTER_NS;
+  err = pcnt_unit_set_glitch_filter(pulseCounter, &filterConfig);
+
+  // Counts the same edges the period path timestamps, the pin is shared through the GPIO matrix
+  pcnt_chan_config_t channelConfig = {};
+  channelConfig.edge_gpio_num = feedBackPin;
+  channelConfig.level_gpio_num = -1;
+
+  pcnt_channel_handle_t channel = nullptr;
+  if (err == ESP_OK) {
+    err = pcnt_new_channel(pulseCounter, &channelConfig, &channel);
+  }
+  if (err == ESP_OK) {
+    err = pcnt_channel_set_edge_action(channel,
+      (Geometry::EDGE_MODE != GPIO_INTR_NEGEDGE) ? PCNT_CHANNEL_EDGE_ACTION_INCREASE : PCNT_CHANNEL_EDGE_ACTION_HOLD,
+      (Geometry::EDGE_MODE != GPIO_INTR_POSEDGE) ? PCNT_CHANNEL_EDGE_ACTION_INCREASE : PCNT_CHANNEL_EDGE_ACTION_HOLD);
+  }
+  if (err == ESP_OK) {
+    err = pcnt_unit_add_watch_point(pulseCounter, PCNT_HIGH_LIMIT);
+  }
+  if (err == ESP_OK) {
+    err = pcnt_unit_enable(pulseCounter);
+  }
+  if (err == ESP_OK) {
+    err = pcnt_unit_clear_count(pulseCounter);
+  }
+  if (err == ESP_OK) {
+    err = pcnt_unit_start(pulseCounter);
+  }
+
+  if (err != ESP_OK) {
+    // Counting is optional, release the unit and keep the period path running
+    ESP_LOGE(TAG, "Failed to set up PCNT for motor %d: %s", motorId, esp_err_to_name(err));
+    pcnt_unit_disable(pulseCounter);
+    if (channel != nullptr) {
+      pcnt_del_channel(channel);
+    }
+    pcnt_del_unit(pulseCounter);
+    pulseCounter = nullptr;
+    return false;
+  }
+  return true;
+}
+
+template <typename Geometry>
+BaseType_t BLDCPulseCalculator<Geometry>::calculateValuesInternal(uint32_t timeStamp) {
+  BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+  // Only publish the timestamp (backend ticks), all period math happens in motorSpeedTask.
+  // The 32-bit counters wrap, unsigned differences stay valid.
+  // Ringing edges inside the lockout never reach the ring
+  if (!edgeFilter.acceptEdge(timeStamp)) {
+    return higherPriorityTaskWoken;
+  }
+
+  edgeBuffer.push(timeStamp);
+
+  edgesSinceNotify = edgesSinceNotify + 1;
+  if (edgesSinceNotify >= notifyEdgeCount.load(std::memory_order_relaxed)) {
+    edgesSinceNotify = 0;
+    if (speedTaskHandle != nullptr) {
+      vTaskNotifyGiveFromISR(speedTaskHandle, &higherPriorityTaskWoken);
+    }
+  }
+
+  return higherPriorityTaskWoken;
+}
+
+template <typename Geometry>
+void BLDCPulseCalculator<Geometry>::addPeriod(uint32_t periodMicros) {
+  using FromMicros = typename Geometry::FromMicros;
+  const uint32_t period = static_cast<uint32_t>((static_cast<uint64_t>(periodMicros) * FromMicros::num) / FromMicros::den);
+
+  periodWindow.push(period);
+
+  // A window of zero-length periods (coarse unit, glitches) has no defined speed
+  const uint32_t sumTime = periodWindow.getSum();
+  if (sumTime == 0) return;
+
+  // The window spans getCount() edges, RPM_PER_EDGE folds in the revolution and time unit
+  const float rawSpeed = (Geometry::RPM_PER_EDGE * periodWindow.getCount()) / sumTime;
+
+  if (SPEED_SMOOTHING_ALPHA >= 1.0f || smoothedSpeed == 0.0f) {
+    smoothedSpeed = rawSpeed;
+  } else {
+    smoothedSpeed += SPEED_SMOOTHING_ALPHA * (rawSpeed - smoothedSpeed);
+  }
+
+  // Mean edge period of the window, both halves of an asymmetric pulse average out
+  expectedPeriodMicros = static_cast<uint32_t>(MICROS_PER_MINUTE / (Geometry::EDGES_PER_REVOLUTION * rawSpeed));
+
+  publishSpeed(smoothedSpeed);
+  ESP_LOGV("MOTOR", "Motor %d Speed: %u RPM", motorId, getSpeed());
+}
+
+template <typename Geometry>
+void BLDCPulseCalculator<Geometry>::publishSpeed(float rpm) {
+  speedRpm.store(rpm, std::memory_order_relaxed);
+
+  // getSpeed() is a uint16_t, saturate instead of wrapping on absurd estimates
+  if (rpm >= static_cast<float>(UINT16_MAX)) {
+    speed.store(UINT16_MAX, std::memory_order_relaxed);
+  } else {
+    speed.store(static_cast<uint16_t>(rpm + 0.5f), std::memory_order_relaxed);
+  }
+}
+
+template <typename Geometry>
+void BLDCPulseCalculator<Geometry>::resetEstimate() {
+  hasLastTimeStamp = false;
+  expectedPeriodMicros = 0;
+  periodWindow.reset();
+  edgeFilter.reset();
+
+  previousPeriodMicros = 0;
+  derivative.reset();
+  publishDerivatives();
+
+  sectorCalibration.breakPhase();
+  instantSpeedRpm.store(0.0f, std::memory_order_relaxed);
+  diagnostics.breakSequence();
+}
+
+template <typename Geometry>
+void BLDCPulseCalculator<Geometry>::addSpeedSample(uint32_t periodMicros) {
+  // Speed over the last whole pulse, the two halves of an asymmetric pulse cancel
+  uint32_t pulseMicros = periodMicros;
+  if (Geometry::EDGES_PER_PULSE == 2) {
+    const uint32_t firstHalf = previousPeriodMicros;
+    previousPeriodMicros = periodMicros;
+    if (firstHalf == 0) return;
+    pulseMicros += firstHalf;
+  }
+
+  const float pulseRpm = (MICROS_PER_MINUTE * Geometry::EDGES_PER_PULSE) / (static_cast<float>(Geometry::EDGES_PER_REVOLUTION) * pulseMicros);
+
+  // The pulse speed belongs to the middle of the pulse
+  derivative.push(edgeTimeMicros - pulseMicros / 2, pulseRpm);
+  publishDerivatives();
+}
 
-      speed = static_cast<uint16_t>(60000 / sumTime);
-      ESP_LOGD("MOTOR", "Motor %d Speed: %u RPM", motorId, speed);
+template <typename Geometry>
+void BLDCPulseCalculator<Geometry>::publishDerivatives() {
+  acceleration.store(derivative.getSlope(), std::memory_order_relaxed);
+  jerk.store(derivative.getCurvature(), std::memory_order_relaxed);
+}
+
+template <typename Geometry>
+void BLDCPulseCalculator<Geometry>::checkStandstill(uint32_t nowMicros) {
+  if (!hasLastTimeStamp && getSpeedRpm() == 0.0f) return;
+
+  const uint32_t elapsedMicros = nowMicros - lastEdgeMicros;
+  const bool stopped = (expectedPeriodMicros != 0)
+    ? (elapsedMicros > expectedPeriodMicros * STOP_PERIODS)
+    : (elapsedMicros > ZERO_SPEED_TIMEOUT_US);
+
+  if (stopped) {
+    smoothedSpeed = 0.0f;
+    publishSpeed(0.0f);
+    resetEstimate();
+    return;
+  }
+
+  // The edge in flight is already elapsedMicros long, the wheel cannot be faster than that.
+  // Only the published value decays, the window keeps the last real measurement.
+  if (expectedPeriodMicros != 0 && elapsedMicros > expectedPeriodMicros * DECELERATION_PERIODS) {
+    const float upperBound = MICROS_PER_MINUTE / (static_cast<float>(Geometry::EDGES_PER_REVOLUTION) * elapsedMicros);
+    if (upperBound < getSpeedRpm()) {
+      publishSpeed(upperBound);
+    }
+  }
+}
+
+template <typename Geometry>
+void BLDCPulseCalculator<Geometry>::motorSpeed() {
+  const uint32_t nowMicros = static_cast<uint32_t>(esp_timer_get_time());
+
+  const uint16_t learnRevolutions = sectorLearnRequest.exchange(0, std::memory_order_relaxed);
+  if (learnRevolutions > 0) {
+    sectorCalibration.startLearning(learnRevolutions);
+  }
+
+  if (modeSelector.getMode() == MeasurementModeSelector::Mode::FREQUENCY) {
+    measureFrequency(nowMicros);
+  } else {
+    measurePeriods(nowMicros);
+  }
+
+  if (edgeRecorder != nullptr) {
+    edgeRecorder->updateSpeed(recorderChannel, getSpeedRpm(), nowMicros);
+  }
+
+  updateSectorCalibration();
+  // Edges dropped by the ISR lockout are only visible through its counter
+  const uint32_t lockoutRejects = edgeFilter.getLockoutRejectCount();
+  diagnostics.onLockoutRejects(lockoutRejects - seenLockoutRejects);
+  seenLockoutRejects = lockoutRejects;
+  diagnostics.update(nowMicros, getSpeedRpm(), driveDuty.load(std::memory_order_relaxed));
+}
+
+template <typename Geometry>
+void BLDCPulseCalculator<Geometry>::measurePeriods(uint32_t nowMicros) {
+  uint32_t timeStamp;
+
+  // Edges were dropped while the ring was full, the next period would span the gap
+  const uint32_t overflowCount = edgeBuffer.getOverflowCount();
+  if (overflowCount != seenOverflowCount) {
+    ESP_LOGW("MOTOR", "Motor %d dropped %u edges", motorId, static_cast<unsigned>(overflowCount - seenOverflowCount));
+    seenOverflowCount = overflowCount;
+    diagnostics.onOverflow();
+    edgeBuffer.clear();
+    lastEdgeMicros = nowMicros;
+    resetEstimate();
+  }
+
+  // The capture counter may have wrapped since the reference edge, a period across it is meaningless
+  if (hasLastTimeStamp && (nowMicros - lastEdgeMicros) >= captureWrapMicros) {
+    hasLastTimeStamp = false;
+  }
+
+  uint32_t countedEdges = 0;
+  while (edgeBuffer.pop(timeStamp)) {
+    // Capture ticks are not on the esp_timer clock, zero-speed detection uses arrival time
+    lastEdgeMicros = nowMicros;
+
+    if (edgeRecorder != nullptr) {
+      edgeRecorder->record(recorderChannel, timeStamp, captureTicksPerMicro, nowMicros);
+    }
+
+    if (hasLastTimeStamp) {
+      const uint32_t period = (timeStamp - lastTimeStamp) / captureTicksPerMicro;
+
+      switch (edgeFilter.classifyPeriod(period)) {
+        case EdgeFilter::Verdict::TOO_SHORT:
+          // Spurious edge, keep measuring from the last good one
+          diagnostics.onSpuriousEdges(1);
+          continue;
+
+        case EdgeFilter::Verdict::TOO_LONG:
+          // Edges went missing, restart the period from this edge
+          edgeTimeMicros += period;
+          previousPeriodMicros = 0;
+          sectorCalibration.breakPhase();
+          diagnostics.onMissingEdge();
+          lastTimeStamp = timeStamp;
+          countedEdges++;
+          continue;
 
-      sumTime = 0;
-      status = BLDCstates::IDLE;
-      break;
+        case EdgeFilter::Verdict::ACCEPT: {
+          edgeTimeMicros += period;
+          diagnostics.onPeriod(period);
 
-    case BLDCstates::IDLE:
-      // Set speed to 0 when wheel is not moving for 2 seconds
-      if(((esp_timer_get_time() / 1000) - nextTimeStamp) > 2000)
-      {
-        speed = 0;
+          // Everything downstream sees the period an evenly spaced motor would produce
+          const float correctedPeriod = sectorCalibration.apply(period);
+          instantSpeedRpm.store(MICROS_PER_MINUTE / (Geometry::EDGES_PER_REVOLUTION * correctedPeriod), std::memory_order_relaxed);
+
+          const uint32_t normalizedPeriod = static_cast<uint32_t>(correctedPeriod + 0.5f);
+          addPeriod(normalizedPeriod);
+          addSpeedSample(normalizedPeriod);
+          break;
+        }
       }
-      break;
+    }
+    lastTimeStamp = timeStamp;
+    hasLastTimeStamp = true;
+    countedEdges++;
+  }
+
+  if (countedEdges > 0) {
+    addOdometryEdges(countedEdges);
+  }
+
+  checkStandstill(nowMicros);
+
+  if (pulseCounter != nullptr) {
+    updateMeasurementMode(getSpeedRpm(), nowMicros);
   }
 }
 
-uint16_t BLDCPulseCalculator::getSpeed() {
-  return speed;
+template <typename Geometry>
+void BLDCPulseCalculator<Geometry>::measureFrequency(uint32_t nowMicros) {
+  // A wake-up right after the switch (pending notification) would give a short, coarse gate
+  const uint32_t gateMicros = nowMicros - lastGateMicros;
+  if (gateMicros < FREQUENCY_GATE_US / 2) return;
+
+  int pulseCount = 0;
+  if (pcnt_unit_get_count(pulseCounter, &pulseCount) != ESP_OK) return;
+
+  // Unsigned difference, the accumulated count may wrap
+  const uint32_t edges = static_cast<uint32_t>(pulseCount) - static_cast<uint32_t>(lastPulseCount);
+  lastPulseCount = pulseCount;
+  lastGateMicros = nowMicros;
+  addOdometryEdges(edges);
+
+  const float rpm = (60000000.0f * edges) / (static_cast<float>(Geometry::EDGES_PER_REVOLUTION) * gateMicros);
+  smoothedSpeed = rpm;
+  publishSpeed(rpm);
+
+  // Gated speeds are samples too, on the esp_timer clock (the fit restarts on every mode switch)
+  derivative.push(nowMicros - gateMicros / 2, rpm);
+  publishDerivatives();
+  ESP_LOGV("MOTOR", "Motor %d Speed: %u RPM (gated)", motorId, getSpeed());
+
+  updateMeasurementMode(rpm, nowMicros);
+}
+
+template <typename Geometry>
+void BLDCPulseCalculator<Geometry>::updateMeasurementMode(float rpm, uint32_t nowMicros) {
+  const MeasurementModeSelector::Mode previous = modeSelector.getMode();
+  MeasurementModeSelector::Mode next = modeSelector.update(rpm);
+
+  // Raw capture and sector learning need every edge, gated counting has none
+  if (needsEveryEdge() && next == MeasurementModeSelector::Mode::FREQUENCY) {
+    modeSelector.reset();
+    next = MeasurementModeSelector::Mode::PERIOD;
+  }
+  if (next == previous) return;
+
+  if (next == MeasurementModeSelector::Mode::FREQUENCY) {
+    // No more per-edge interrupts, the gate starts at the current count
+    setEdgeInterrupt(false);
+    derivative.reset();
+    pcnt_unit_get_count(pulseCounter, &lastPulseCount);
+    lastGateMicros = nowMicros;
+  } else {
+    // Whatever is left in the ring predates the switch
+    edgeBuffer.clear();
+    resetEstimate();
+    lastEdgeMicros = nowMicros;
+    if (rpm > 0.0f) {
+      // Standstill checks continue from the gated speed until the window refills
+      expectedPeriodMicros = static_cast<uint32_t>(MICROS_PER_MINUTE / (Geometry::EDGES_PER_REVOLUTION * rpm));
+    }
+    setEdgeInterrupt(true);
+  }
+
+  measurementMode.store(next, std::memory_order_relaxed);
+  ESP_LOGI("MOTOR", "Motor %d switched to %s measurement at %.0f RPM", motorId,
+           next == MeasurementModeSelector::Mode::FREQUENCY ? "frequency" : "period", rpm);
+}
+
+template <typename Geometry>
+void BLDCPulseCalculator<Geometry>::setEdgeInterrupt(bool enabled) {
+  if (backend == CaptureBackend::MCPWM_CAPTURE) {
+    if (enabled) {
+      mcpwm_capture_channel_enable(captureChannel);
+    } else {
+      mcpwm_capture_channel_disable(captureChannel);
+    }
+  } else {
+    if (enabled) {
+      gpio_intr_enable(feedBackPin);
+    } else {
+      gpio_intr_disable(feedBackPin);
+    }
+  }
 }
 
-void IRAM_ATTR BLDCPulseCalculator::staticCalculateValuesWrapper(void *args) {
+template <typename Geometry>
+uint16_t BLDCPulseCalculator<Geometry>::getSpeed() {
+  return speed.load(std::memory_order_relaxed);
+}
+
+template <typename Geometry>
+float BLDCPulseCalculator<Geometry>::getSpeedRpm() {
+  return speedRpm.load(std::memory_order_relaxed);
+}
+
+template <typename Geometry>
+float BLDCPulseCalculator<Geometry>::getAcceleration() {
+  return acceleration.load(std::memory_order_relaxed);
+}
+
+template <typename Geometry>
+float BLDCPulseCalculator<Geometry>::getJerk() {
+  return jerk.load(std::memory_order_relaxed);
+}
+
+template <typename Geometry>
+void BLDCPulseCalculator<Geometry>::addOdometryEdges(uint32_t edges) {
+  portENTER_CRITICAL(&odometryMux);
+  odometryEdges += edges;
+  portEXIT_CRITICAL(&odometryMux);
+}
+
+template <typename Geometry>
+uint64_t BLDCPulseCalculator<Geometry>::getOdometryEdges() {
+  portENTER_CRITICAL(&odometryMux);
+  const uint64_t edges = odometryEdges;
+  portEXIT_CRITICAL(&odometryMux);
+  return edges;
+}
+
+template <typename Geometry>
+double BLDCPulseCalculator<Geometry>::getRevolutions() {
+  return static_cast<double>(getOdometryEdges()) / EDGES_PER_REVOLUTION;
+}
+
+template <typename Geometry>
+void BLDCPulseCalculator<Geometry>::resetOdometry() {
+  restoreOdometry(0);
+}
+
+template <typename Geometry>
+void BLDCPulseCalculator<Geometry>::restoreOdometry(uint64_t edges) {
+  portENTER_CRITICAL(&odometryMux);
+  odometryEdges = edges;
+  portEXIT_CRITICAL(&odometryMux);
+}
+
+template <typename Geometry>
+uint32_t BLDCPulseCalculator<Geometry>::getOverflowCount() {
+  return edgeBuffer.getOverflowCount();
+}
+
+template <typename Geometry>
+uint32_t BLDCPulseCalculator<Geometry>::getRejectedEdgeCount() {
+  return edgeFilter.getLockoutRejectCount() + edgeFilter.getOutlierRejectCount();
+}
+
+template <typename Geometry>
+void BLDCPulseCalculator<Geometry>::setNotifyEdgeCount(uint8_t edges) {
+  notifyEdgeCount.store(edges > 0 ? edges : 1, std::memory_order_relaxed);
+}
+
+template <typename Geometry>
+bool BLDCPulseCalculator<Geometry>::needsEveryEdge() {
+  return (edgeRecorder != nullptr && edgeRecorder->isActive()) ||
+         sectorCalibration.getStatus() == SectorTable::Status::LEARNING ||
+         sectorLearnRequest.load(std::memory_order_relaxed) != 0;
+}
+
+template <typename Geometry>
+void BLDCPulseCalculator<Geometry>::updateSectorCalibration() {
+  const typename SectorTable::Status previous = sectorStatus.load(std::memory_order_relaxed);
+  const typename SectorTable::Status status = sectorCalibration.getStatus();
+  if (status == previous) return;
+
+  if (previous == SectorTable::Status::LEARNING && status != SectorTable::Status::UNCALIBRATED) {
+    sectorTableReady.store(true, std::memory_order_release);
+    ESP_LOGI("MOTOR", "Motor %d learned its sector table over %u revolutions", motorId, sectorCalibration.getLearnedRevolutions());
+  }
+  sectorStatus.store(status, std::memory_order_relaxed);
+}
+
+template <typename Geometry>
+float BLDCPulseCalculator<Geometry>::getInstantSpeed() {
+  return instantSpeedRpm.load(std::memory_order_relaxed);
+}
+
+template <typename Geometry>
+void BLDCPulseCalculator<Geometry>::startSectorCalibration(uint16_t revolutions) {
+  sectorLearnRequest.store(revolutions > 0 ? revolutions : 1, std::memory_order_relaxed);
+}
+
+template <typename Geometry>
+bool BLDCPulseCalculator<Geometry>::loadSectorTable(const float *table) {
+  const bool loaded = sectorCalibration.setTable(table);
+  sectorStatus.store(sectorCalibration.getStatus(), std::memory_order_relaxed);
+  return loaded;
+}
+
+template <typename Geometry>
+bool BLDCPulseCalculator<Geometry>::takeSectorTable(float *table) {
+  // The table only changes again when the next learning run completes
+  if (!sectorTableReady.exchange(false, std::memory_order_acquire)) return false;
+
+  memcpy(table, sectorCalibration.getTable(), sizeof(float) * Geometry::EDGES_PER_REVOLUTION);
+  return true;
+}
+
+template <typename Geometry>
+bool BLDCPulseCalculator<Geometry>::setEdgeRecorder(EdgeRecorder &recorder) {
+  const int8_t channel = recorder.addChannel(Geometry::EDGES_PER_REVOLUTION);
+  if (channel < 0) return false;
+
+  recorderChannel = channel;
+  edgeRecorder = &recorder;
+  return true;
+}
+
+template <typename Geometry>
+TickType_t BLDCPulseCalculator<Geometry>::getIdleTimeoutTicks() const {
+  uint32_t timeoutMs = IDLE_TIMEOUT_MS;
+
+  // Moving in period mode: look again after one expected period, the gate sets the pace otherwise
+  if (modeSelector.getMode() == MeasurementModeSelector::Mode::PERIOD && expectedPeriodMicros != 0) {
+    const uint32_t periodMs = expectedPeriodMicros / 1000;
+    if (periodMs < timeoutMs) {
+      timeoutMs = periodMs;
+    }
+  }
+
+  const TickType_t ticks = pdMS_TO_TICKS(timeoutMs);
+  return ticks > 0 ? ticks : 1;
+}
+
+template <typename Geometry>
+void IRAM_ATTR BLDCPulseCalculator<Geometry>::staticCalculateValuesWrapper(void *args) {
+#ifdef SPEED_ISR_PROFILING
+  const uint32_t startCycles = esp_cpu_get_cycle_count();
+#endif
+
   BLDCPulseCalculator* instance = static_cast<BLDCPulseCalculator*>(args);
-  if (instance) {
-    instance->calculateValuesInternal();
+  const BaseType_t higherPriorityTaskWoken = instance ? instance->calculateValuesInternal(EdgeClock::now()) : pdFALSE;
+
+#ifdef SPEED_ISR_PROFILING
+  if (instance) instance->isrProfile.record(esp_cpu_get_cycle_count() - startCycles);
+#endif
+
+  if (higherPriorityTaskWoken == pdTRUE) {
+    portYIELD_FROM_ISR();
   }
 }
 
-void BLDCPulseCalculator::motorSpeedTask(void* pvParameters) {
+template <typename Geometry>
+bool IRAM_ATTR BLDCPulseCalculator<Geometry>::staticCaptureCallback(mcpwm_cap_channel_handle_t, const mcpwm_capture_event_data_t *edata, void *args) {
+  // The driver yields on return when a higher priority task was woken
+  BLDCPulseCalculator* instance = static_cast<BLDCPulseCalculator*>(args);
+  return instance && instance->calculateValuesInternal(edata->cap_value) == pdTRUE;
+}
+
+template <typename Geometry>
+void BLDCPulseCalculator<Geometry>::motorSpeedTask(void* pvParameters) {
   BLDCPulseCalculator* instance = static_cast<BLDCPulseCalculator*>(pvParameters);
+#ifdef SPEED_ISR_PROFILING
+  uint32_t lastProfileReport = static_cast<uint32_t>(esp_timer_get_time());
+#endif
   while (1) {
+    // Woken by the ISR as soon as edges are ready, the timeout only drives zero-speed detection
+    ulTaskNotifyTake(pdTRUE, instance->getIdleTimeoutTicks());
     instance->motorSpeed();
-    vTaskDelay(100 / portTICK_PERIOD_MS);
+
+#ifdef SPEED_ISR_PROFILING
+    if (static_cast<uint32_t>(esp_timer_get_time()) - lastProfileReport > PROFILE_REPORT_US) {
+      lastProfileReport = static_cast<uint32_t>(esp_timer_get_time());
+      instance->isrProfile.report("staticCalculateValuesWrapper");
+    }
+#endif
   }
-}
\ No newline at end of file
+}
+
+// Hub motors fitted to the pods: 16 feedback pulses per revolution counted on both edges,
+// speed averaged over SPEED_WINDOW_EDGE_COUNT edges (default one revolution) with microsecond periods
+using HubMotorGeometry = MotorGeometry<16, SPEED_WINDOW_EDGE_COUNT, std::micro, GPIO_INTR_ANYEDGE>;
+using MotorPulseCalculator = BLDCPulseCalculator<HubMotorGeometry>;
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+
+// Where edge timestamps come from
+// - GPIO_ISR      : per-edge GPIO interrupt through the shared gpio ISR service, EdgeClock timestamp
+// - MCPWM_CAPTURE : the MCPWM capture unit latches the edge time in hardware, the capture
+//                   callback only forwards the latched value (no dispatcher, no timer read)
+enum class CaptureBackend : uint8_t {
+  GPIO_ISR,
+  MCPWM_CAPTURE
+};
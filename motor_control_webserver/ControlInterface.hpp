@@ -9,6 +9,10 @@
 // Forward declarations from GLOBALS.hpp
 extern PwmGenerator motorPWM1;
 extern PwmGenerator motorPWM2;
+extern MotorPwmGroup motorPWMGroup;
+extern SpeedController<MotorPulseCalculator, 2> motorSpeedController;
+extern MotorPulseCalculator motorPulse1;
+extern MotorPulseCalculator motorPulse2;
 extern DoorLock doorLock;
 
 // Global state variables
@@ -28,6 +32,10 @@ private:
     float maxCurrent;
     uint8_t emergencyStopPWM;
     
+    // Duty changes ramp at this slope, in duty steps per second (0 = immediate)
+    static constexpr uint32_t DEFAULT_RAMP_DUTY_PER_SECOND = 128;
+    uint32_t rampDutyPerSecond;
+    
     // Control validation
     bool validatePWMValue(uint8_t pwm);
     bool validateCommand(const String& command);
@@ -36,6 +44,10 @@ private:
     void controlLights(bool state);
     void controlDoors(bool lock);
     void controlMotorPWM(uint8_t pwm);
+    void rampMotorPWM(uint8_t pwm, int32_t rampMs);
+    
+    // PWM fade end, reports the reached duty to the speed calculator passed as arg
+    static void rampDone(uint8_t duty, void* arg);
     
     // Safety methods
     bool checkSafetyLimits();
@@ -54,7 +66,8 @@ public:
     bool processCommand(const String& command, const JsonDocument& data);
     
     // Direct control methods
-    bool setPWM(uint8_t pwm);
+    // Ramps to pwm in rampMs, a negative rampMs uses the configured slope
+    bool setPWM(uint8_t pwm, int32_t rampMs = -1);
     bool toggleDoors();
     bool toggleLights();
     bool lockDoors();
@@ -65,6 +78,8 @@ public:
     void setSafetyLimits(float maxCurrentAmps, uint8_t maxPwmValue);
     void enableSafety(bool enable);
     bool isSafetyEnabled() const { return safetyEnabled; }
+    void setRampSlope(uint32_t dutyPerSecond);
+    uint32_t getRampSlope() const { return rampDutyPerSecond; }
     
     // Status methods
     uint8_t getCurrentPWM() const { return currentPWM; }
@@ -76,7 +91,7 @@ public:
 
 ControlInterface::ControlInterface() 
     : initialized(false), maxPWM(255), minPWM(0), safetyEnabled(true), 
-      maxCurrent(10.0f), emergencyStopPWM(0) {
+      maxCurrent(10.0f), emergencyStopPWM(0), rampDutyPerSecond(DEFAULT_RAMP_DUTY_PER_SECOND) {
 }
 
 ControlInterface::~ControlInterface() {
@@ -106,6 +121,8 @@ void ControlInterface::begin() {
     
     // Initialize PWM to safe state
     currentPWM = 0;
+    motorPWM1.setRampDoneCallback(&rampDone, &motorPulse1);
+    motorPWM2.setRampDoneCallback(&rampDone, &motorPulse2);
     
     initialized = true;
     ESP_LOGI(TAG, "Control interface initialized");
@@ -188,7 +205,7 @@ bool ControlInterface::processCommand(const String& command, const JsonDocument&
 
 // WebSocket message processing removed - now handled by HTTP API
 
-bool ControlInterface::setPWM(uint8_t pwm) {
+bool ControlInterface::setPWM(uint8_t pwm, int32_t rampMs) {
     if (!validatePWMValue(pwm)) {
         ESP_LOGW("ControlInterface", "Invalid PWM value: %d", pwm);
         return false;
@@ -199,12 +216,13 @@ bool ControlInterface::setPWM(uint8_t pwm) {
         return false;
     }
     
-    // Set PWM for both motors (synchronized)
-    motorPWM1.setPwm(pwm);
-    motorPWM2.setPwm(pwm);
-    currentPWM = pwm;
+    // A raw duty means open loop, the speed controller lets go first
+    motorSpeedController.disable();
+    
+    // Ramp both motors (synchronized)
+    rampMotorPWM(pwm, rampMs);
     
-    ESP_LOGI("ControlInterface", "PWM set to %d", pwm);
+    ESP_LOGI("ControlInterface", "PWM ramping to %d", pwm);
     return true;
 }
 
@@ -257,11 +275,37 @@ void ControlInterface::controlDoors(bool lock) {
 }
 
 void ControlInterface::controlMotorPWM(uint8_t pwm) {
-    motorPWM1.setPwm(pwm);
-    motorPWM2.setPwm(pwm);
+    motorSpeedController.disable();
+    motorPWMGroup.setPwm(pwm);
+    motorPulse1.setDriveDuty(pwm);
+    motorPulse2.setDriveDuty(pwm);
     currentPWM = pwm;
 }
 
+void ControlInterface::rampMotorPWM(uint8_t pwm, int32_t rampMs) {
+    // Diagnostics judge the speed against the lower end of the ramp until it is done
+    const uint8_t output1 = motorPWM1.getOutputDuty();
+    const uint8_t output2 = motorPWM2.getOutputDuty();
+    motorPulse1.setDriveDuty(pwm < output1 ? pwm : output1);
+    motorPulse2.setDriveDuty(pwm < output2 ? pwm : output2);
+    
+    if (rampMs < 0) {
+        motorPWMGroup.slewTo(pwm, rampDutyPerSecond);
+    } else {
+        motorPWMGroup.rampTo(pwm, rampMs);
+    }
+    currentPWM = pwm;
+    
+    // Immediate or no-op changes never see a fade end
+    if (!motorPWM1.isRamping()) motorPulse1.setDriveDuty(pwm);
+    if (!motorPWM2.isRamping()) motorPulse2.setDriveDuty(pwm);
+}
+
+// Runs in the LEDC fade end ISR: keep it ISR-safe, it only stores an atomic (no logging, locks or allocation)
+void ControlInterface::rampDone(uint8_t duty, void* arg) {
+    static_cast<MotorPulseCalculator*>(arg)->setDriveDuty(duty);
+}
+
 bool ControlInterface::validatePWMValue(uint8_t pwm) {
     return (pwm >= minPWM && pwm <= maxPWM);
 }
@@ -307,6 +351,11 @@ void ControlInterface::setSafetyLimits(float maxCurrentAmps, uint8_t maxPwmValue
     ESP_LOGI("ControlInterface", "Safety limits set: Max current=%.1fA, Max PWM=%d", maxCurrent, maxPWM);
 }
 
+void ControlInterface::setRampSlope(uint32_t dutyPerSecond) {
+    rampDutyPerSecond = dutyPerSecond;
+    ESP_LOGI("ControlInterface", "PWM ramp slope set to %u/s", static_cast<unsigned>(dutyPerSecond));
+}
+
 void ControlInterface::enableSafety(bool enable) {
     safetyEnabled = enable;
     ESP_LOGI("ControlInterface", "Safety %s", enable ? "enabled" : "disabled");
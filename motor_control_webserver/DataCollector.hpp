@@ -8,8 +8,10 @@
 // Forward declarations from GLOBALS.hpp
 extern PwmGenerator motorPWM1;
 extern PwmGenerator motorPWM2;
-extern BLDCPulseCalculator motorPulse1;
-extern BLDCPulseCalculator motorPulse2;
+extern MotorPwmGroup motorPWMGroup;
+extern SpeedController<MotorPulseCalculator, 2> motorSpeedController;
+extern MotorPulseCalculator motorPulse1;
+extern MotorPulseCalculator motorPulse2;
 extern DoorLock doorLock;
 extern UARTCurrentSensor currentSensor;
 
@@ -22,6 +24,7 @@ extern float motor2Speed;
 extern float motor1Current;
 extern float motor2Current;
 extern float systemVoltage;
+extern const float wheelDiameterMeters;
 
 class DataCollector {
 private:
@@ -34,6 +37,7 @@ private:
     void collectMotorData();
     void collectCurrentData();
     void collectSystemData();
+    void addFaults(JsonObject motor, MotorPulseCalculator &calculator);
     
 public:
     DataCollector(const BaseType_t core = 1);
@@ -110,8 +114,8 @@ void DataCollector::end() {
 
 void DataCollector::collectMotorData() {
     // Update motor speeds from pulse calculators
-    motor1Speed = motorPulse1.getSpeed();
-    motor2Speed = motorPulse2.getSpeed();
+    motor1Speed = motorPulse1.getSpeedRpm();
+    motor2Speed = motorPulse2.getSpeedRpm();
     
     // Get current PWM value
     currentPWM = motorPWM1.getPwm(); // Assuming synchronized PWM
@@ -186,6 +190,20 @@ DynamicJsonDocument DataCollector::getSystemData() {
     return doc;
 }
 
+void DataCollector::addFaults(JsonObject motor, MotorPulseCalculator &calculator) {
+    const uint8_t active = calculator.getFaults();
+    const uint8_t latched = calculator.getLatchedFaults();
+    motor["fault_code"] = active;
+    motor["latched_fault_code"] = latched;
+    
+    JsonArray faults = motor.createNestedArray("faults");
+    for (uint8_t i = 0; i < HallDiagnostics::FAULT_COUNT; i++) {
+        if (active & (1 << i)) {
+            faults.add(HallDiagnostics::faultName(1 << i));
+        }
+    }
+}
+
 DynamicJsonDocument DataCollector::getAllData() {
     DynamicJsonDocument doc(2048);
     
@@ -194,14 +212,73 @@ DynamicJsonDocument DataCollector::getAllData() {
     motor1["speed"] = motor1Speed;
     motor1["current"] = motor1Current;
     motor1["power"] = motor1Current * systemVoltage;
+    motor1["rejected_edges"] = motorPulse1.getRejectedEdgeCount();
+    motor1["acceleration"] = motorPulse1.getAcceleration();
+    motor1["jerk"] = motorPulse1.getJerk();
+    motor1["revolutions"] = motorPulse1.getRevolutions();
+    motor1["distance"] = motorPulse1.getRevolutions() * PI * wheelDiameterMeters;
+    motor1["instant_speed"] = motorPulse1.getInstantSpeed();
+    motor1["sector_calibration"] = MotorPulseCalculator::SectorTable::statusName(motorPulse1.getSectorCalibrationStatus());
+    motor1["speed_setpoint"] = motorSpeedController.getSetpoint(0);
+    motor1["speed_control_duty"] = motorSpeedController.getDuty(0);
+    auto motor1Gains = motorSpeedController.getGains(0);
+    motor1["speed_kp"] = motor1Gains.kp;
+    motor1["speed_ki"] = motor1Gains.ki;
+    motor1["speed_kd"] = motor1Gains.kd;
+    motor1["autotune"] = RelayAutotune::statusName(motorSpeedController.getAutotuneStatus(0));
+    motor1["autotune_ku"] = motorSpeedController.getUltimateGain(0);
+    motor1["autotune_tu"] = motorSpeedController.getUltimatePeriod(0);
+    motor1["feedforward"] = FeedforwardTable::statusName(motorSpeedController.getFeedforwardStatus(0));
+    motor1["pwm_commits"] = motorPWM1.getCommitCount();
+    motor1["pwm_output"] = motorPWM1.getOutputDuty();
+    motor1["pwm_ramping"] = motorPWM1.isRamping();
+    motor1["pwm_duty"] = motorPWM1.getDuty();
+    motor1["pwm_resolution_bits"] = motorPWM1.getResolutionBits();
+    motor1["pwm_frequency"] = motorPWM1.getFrequency();
+    addFaults(motor1, motorPulse1);
     
     JsonObject motor2 = doc["motor2"].to<JsonObject>();
     motor2["speed"] = motor2Speed;
     motor2["current"] = motor2Current;
     motor2["power"] = motor2Current * systemVoltage;
+    motor2["rejected_edges"] = motorPulse2.getRejectedEdgeCount();
+    motor2["acceleration"] = motorPulse2.getAcceleration();
+    motor2["jerk"] = motorPulse2.getJerk();
+    motor2["revolutions"] = motorPulse2.getRevolutions();
+    motor2["distance"] = motorPulse2.getRevolutions() * PI * wheelDiameterMeters;
+    motor2["instant_speed"] = motorPulse2.getInstantSpeed();
+    motor2["sector_calibration"] = MotorPulseCalculator::SectorTable::statusName(motorPulse2.getSectorCalibrationStatus());
+    motor2["speed_setpoint"] = motorSpeedController.getSetpoint(1);
+    motor2["speed_control_duty"] = motorSpeedController.getDuty(1);
+    auto motor2Gains = motorSpeedController.getGains(1);
+    motor2["speed_kp"] = motor2Gains.kp;
+    motor2["speed_ki"] = motor2Gains.ki;
+    motor2["speed_kd"] = motor2Gains.kd;
+    motor2["autotune"] = RelayAutotune::statusName(motorSpeedController.getAutotuneStatus(1));
+    motor2["autotune_ku"] = motorSpeedController.getUltimateGain(1);
+    motor2["autotune_tu"] = motorSpeedController.getUltimatePeriod(1);
+    motor2["feedforward"] = FeedforwardTable::statusName(motorSpeedController.getFeedforwardStatus(1));
+    motor2["pwm_commits"] = motorPWM2.getCommitCount();
+    motor2["pwm_output"] = motorPWM2.getOutputDuty();
+    motor2["pwm_ramping"] = motorPWM2.isRamping();
+    motor2["pwm_duty"] = motorPWM2.getDuty();
+    motor2["pwm_resolution_bits"] = motorPWM2.getResolutionBits();
+    motor2["pwm_frequency"] = motorPWM2.getFrequency();
+    addFaults(motor2, motorPulse2);
     
     // Control data
     doc["pwm"] = currentPWM;
+    doc["speed_control"] = SpeedController<MotorPulseCalculator, 2>::modeName(motorSpeedController.getMode());
+    doc["speed_feedforward"] = motorSpeedController.isFeedforwardEnabled();
+    doc["speed_sync_mode"] = SpeedController<MotorPulseCalculator, 2>::syncModeName(motorSpeedController.getSyncMode());
+    doc["speed_coupling_gain"] = motorSpeedController.getCouplingGain();
+    doc["sync_error"] = motorSpeedController.getSyncError();
+    doc["sync_error_peak"] = motorSpeedController.getPeakSyncError();
+    doc["pwm_synchronized"] = motorPWMGroup.isSynchronized();
+    doc["pwm_group_commits"] = motorPWMGroup.getCommitCount();
+    doc["ledc_channels_used"] = LedcAllocator::getChannelsInUse();
+    doc["ledc_timers_used"] = LedcAllocator::getTimersInUse();
+    doc["ledc_allocation_failures"] = LedcAllocator::getFailedCount();
     doc["voltage"] = systemVoltage;
     doc["doors_locked"] = doorsLocked;
     doc["lights_on"] = lightsOn;
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/*
+  First and second time derivative of a sampled signal from a least-squares quadratic fit
+  over the last N (time, value) samples.
+
+  - Samples may be unevenly spaced (one per Hall edge), which rules out fixed
+    Savitzky-Golay coefficients; the fit is solved directly from the normal equations.
+  - Time is taken relative to the newest sample and scaled by the window span, so the
+    3x3 system stays well conditioned in float whatever the speed.
+  - The derivatives are evaluated at the newest sample: getSlope() is value/s,
+    getCurvature() is value/s^2. Every push costs O(N) with N fixed at compile time.
+  - Only used from task context, no synchronization needed.
+*/
+template <size_t N>
+class DerivativeEstimator {
+private:
+  static_assert(N >= 3 && N <= 255, "A quadratic fit needs at least 3 samples and the index is uint8_t");
+
+  uint32_t times[N];
+  float values[N];
+  uint8_t index;
+  uint8_t count;
+
+  float slope;
+  float curvature;
+
+  inline void fit() __attribute__((always_inline));
+
+public:
+  DerivativeEstimator();
+
+  inline void push(uint32_t timeMicros, float value) __attribute__((always_inline));
+  inline void reset() __attribute__((always_inline));
+
+  inline float getSlope() const { return slope; }
+  inline float getCurvature() const { return curvature; }
+  inline uint8_t getCount() const { return count; }
+};
+
+template <size_t N>
+DerivativeEstimator<N>::DerivativeEstimator() {
+  reset();
+}
+
+template <size_t N>
+void DerivativeEstimator<N>::push(uint32_t timeMicros, float value) {
+  times[index] = timeMicros;
+  values[index] = value;
+  index = (index + 1 == N) ? 0 : index + 1;
+  if (count < N) {
+    count = count + 1;
+  }
+
+  fit();
+}
+
+template <size_t N>
+void DerivativeEstimator<N>::reset() {
+  memset(times, 0, sizeof(times));
+  memset(values, 0, sizeof(values));
+  index = 0;
+  count = 0;
+  slope = 0.0f;
+  curvature = 0.0f;
+}
+
+template <size_t N>
+void DerivativeEstimator<N>::fit() {
+  if (count < 2) return;
+
+  const uint8_t newest = (index == 0) ? N - 1 : index - 1;
+  const uint8_t oldest = (count < N) ? 0 : index;
+  const uint32_t newestTime = times[newest];
+  const float newestValue = values[newest];
+
+  // Unsigned difference, the microsecond clock may wrap inside the window
+  const float spanMicros = static_cast<float>(newestTime - times[oldest]);
+  if (spanMicros <= 0.0f) return;
+
+  if (count == 2) {
+    slope = (newestValue - values[oldest]) * 1e6f / spanMicros;
+    curvature = 0.0f;
+    return;
+  }
+
+  // x in [-1, 0], y relative to the newest value
+  float s1 = 0.0f, s2 = 0.0f, s3 = 0.0f, s4 = 0.0f;
+  float t0 = 0.0f, t1 = 0.0f, t2 = 0.0f;
+  for (uint8_t i = 0; i < count; i++) {
+    const float x = -static_cast<float>(newestTime - times[i]) / spanMicros;
+    const float y = values[i] - newestValue;
+    const float x2 = x * x;
+    s1 += x;
+    s2 += x2;
+    s3 += x2 * x;
+    s4 += x2 * x2;
+    t0 += y;
+    t1 += x * y;
+    t2 += x2 * y;
+  }
+  const float s0 = count;
+
+  // Cramer's rule on [s0 s1 s2; s1 s2 s3; s2 s3 s4] * [a b c] = [t0 t1 t2]
+  const float det = s0 * (s2 * s4 - s3 * s3) - s1 * (s1 * s4 - s3 * s2) + s2 * (s1 * s3 - s2 * s2);
+  if (det > -1e-9f && det < 1e-9f) return;
+
+  const float detB = s0 * (t1 * s4 - s3 * t2) - t0 * (s1 * s4 - s3 * s2) + s2 * (s1 * t2 - t1 * s2);
+  const float detC = s0 * (s2 * t2 - t1 * s3) - s1 * (s1 * t2 - t1 * s2) + t0 * (s1 * s3 - s2 * s2);
+
+  // y = a + b x + c x^2 with x = t / span, back to seconds at x = 0
+  const float spanSeconds = spanMicros * 1e-6f;
+  slope = (detB / det) / spanSeconds;
+  curvature = 2.0f * (detC / det) / (spanSeconds * spanSeconds);
+}
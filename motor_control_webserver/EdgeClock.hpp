@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <esp_cpu.h>
+#include <esp_rom_sys.h>
+#include <esp_log.h>
+#include "esp_timer.h"
+
+/*
+  Timestamp source of the GPIO edge ISR.
+
+  - Default: the Xtensa CCOUNT cycle counter, one register read and no arithmetic in the ISR.
+    240 ticks per microsecond at 240 MHz, wraps every ~17.9 s. The speed task converts
+    periods to microseconds and drops its reference once more than one wrap may have passed.
+  - CCOUNT is per core: the ISR must stay on the core it was registered on (it does) and the
+    CPU clock must be fixed, dynamic frequency scaling would change the tick rate.
+  - Build with SPEED_ISR_ESP_TIMER_TIMESTAMP to go back to esp_timer_get_time() (64-bit
+    read and divide), build with SPEED_ISR_PROFILING to have the speed task log ISR cycles.
+    Profiling both builds gives the before/after numbers of the edge ISR.
+*/
+struct EdgeClock {
+  static inline uint32_t now() __attribute__((always_inline)) {
+#ifdef SPEED_ISR_ESP_TIMER_TIMESTAMP
+    return static_cast<uint32_t>(esp_timer_get_time());
+#else
+    return esp_cpu_get_cycle_count();
+#endif
+  }
+
+  static inline uint32_t ticksPerMicro() {
+#ifdef SPEED_ISR_ESP_TIMER_TIMESTAMP
+    return 1;
+#else
+    return esp_rom_get_cpu_ticks_per_us();
+#endif
+  }
+};
+
+// Cycle statistics of an ISR body, written by the ISR, reported and reset by a task
+class IsrCycleProfile {
+private:
+  std::atomic<uint32_t> count;
+  std::atomic<uint32_t> totalCycles;
+  std::atomic<uint32_t> maxCycles;
+
+public:
+  IsrCycleProfile() : count(0), totalCycles(0), maxCycles(0) {}
+
+  // ISR, single writer
+  inline void record(uint32_t cycles) __attribute__((always_inline)) {
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    totalCycles.store(totalCycles.load(std::memory_order_relaxed) + cycles, std::memory_order_relaxed);
+    if (cycles > maxCycles.load(std::memory_order_relaxed)) {
+      maxCycles.store(cycles, std::memory_order_relaxed);
+    }
+  }
+
+  // Task, a sample recorded during the reset may be lost, good enough for statistics
+  void report(const char *name) {
+    const uint32_t samples = count.exchange(0, std::memory_order_relaxed);
+    const uint32_t total = totalCycles.exchange(0, std::memory_order_relaxed);
+    const uint32_t peak = maxCycles.exchange(0, std::memory_order_relaxed);
+    if (samples == 0) return;
+
+    ESP_LOGI("ISR_PROFILE", "%s: %u calls, avg %u cycles, max %u cycles", name,
+             static_cast<unsigned>(samples), static_cast<unsigned>(total / samples), static_cast<unsigned>(peak));
+  }
+};
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+/*
+  Two stage validation of Hall feedback edges, periods in microseconds.
+
+  - Stage 1 runs in the ISR: an edge closer than the lockout to the previous accepted edge
+    is PWM ringing and is dropped before it reaches the ring buffer. A compare and a store,
+    the lockout itself is computed by the task and kept in capture ticks
+    (ticksPerMicro, 1 for esp_timer timestamps) so the ISR never converts.
+  - Stage 2 runs in the speed task: a period is compared against the median of the last
+    MEDIAN_LENGTH accepted periods and rejected when it is more than OUTLIER_RATIO times
+    shorter (spurious edge) or longer (missed edge). The median is what sets the lockout.
+
+  With both edges counted the periods alternate between the high and low half of a pulse,
+  the ratios below tolerate feedback duty cycles between roughly 25% and 75%.
+*/
+class EdgeFilter {
+public:
+  enum class Verdict : uint8_t {
+    ACCEPT,
+    TOO_SHORT,
+    TOO_LONG
+  };
+
+private:
+  static constexpr uint8_t MEDIAN_LENGTH = 5;
+  static constexpr uint32_t OUTLIER_RATIO = 4;
+
+  // Lockout is a quarter of the typical period, never below the PWM ringing time
+  static constexpr uint32_t LOCKOUT_DIVISOR = 4;
+  static constexpr uint32_t MIN_LOCKOUT_US = 20;
+
+  // Set before the ISR is attached
+  uint32_t ticksPerMicro;
+
+  // ISR-side state, the ISR is the only writer
+  uint32_t lastAcceptedTicks;
+  std::atomic<uint32_t> lockoutRejectCount;
+
+  // Written by the task, read by the ISR
+  std::atomic<uint32_t> lockoutTicks;
+
+  // Task-side state
+  uint32_t recentPeriods[MEDIAN_LENGTH];
+  uint8_t recentIndex;
+  uint8_t recentCount;
+  uint8_t consecutiveRejects;
+  std::atomic<uint32_t> outlierRejectCount;
+
+  inline uint32_t median() const __attribute__((always_inline));
+  inline void remember(uint32_t periodMicros) __attribute__((always_inline));
+  inline void storeLockout(uint32_t micros) __attribute__((always_inline));
+
+public:
+  EdgeFilter();
+
+  // Capture tick rate of the timestamps handed to acceptEdge(), call before the ISR runs
+  inline void setTicksPerMicro(uint32_t ticks) __attribute__((always_inline));
+
+  // ISR
+  inline bool acceptEdge(uint32_t nowTicks) __attribute__((always_inline));
+
+  // Task
+  inline Verdict classifyPeriod(uint32_t periodMicros) __attribute__((always_inline));
+  inline void reset() __attribute__((always_inline));
+
+  uint32_t getLockoutRejectCount() const { return lockoutRejectCount.load(std::memory_order_relaxed); }
+  uint32_t getOutlierRejectCount() const { return outlierRejectCount.load(std::memory_order_relaxed); }
+  uint32_t getLockoutMicros() const { return lockoutTicks.load(std::memory_order_relaxed) / ticksPerMicro; }
+};
+
+EdgeFilter::EdgeFilter() :
+ticksPerMicro(1),
+lastAcceptedTicks(0),
+lockoutRejectCount(0),
+lockoutTicks(MIN_LOCKOUT_US),
+recentIndex(0),
+recentCount(0),
+consecutiveRejects(0),
+outlierRejectCount(0)
+{
+  memset(recentPeriods, 0, sizeof(recentPeriods));
+}
+
+void EdgeFilter::setTicksPerMicro(uint32_t ticks) {
+  ticksPerMicro = ticks > 0 ? ticks : 1;
+  storeLockout(MIN_LOCKOUT_US);
+}
+
+bool EdgeFilter::acceptEdge(uint32_t nowTicks) {
+  if ((nowTicks - lastAcceptedTicks) < lockoutTicks.load(std::memory_order_relaxed)) {
+    lockoutRejectCount.store(lockoutRejectCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return false;
+  }
+
+  lastAcceptedTicks = nowTicks;
+  return true;
+}
+
+EdgeFilter::Verdict EdgeFilter::classifyPeriod(uint32_t periodMicros) {
+  // Not enough history yet, accept everything to get the median going
+  if (recentCount < MEDIAN_LENGTH) {
+    remember(periodMicros);
+    return Verdict::ACCEPT;
+  }
+
+  const uint32_t typical = median();
+  Verdict verdict = Verdict::ACCEPT;
+
+  if (periodMicros * OUTLIER_RATIO < typical) {
+    verdict = Verdict::TOO_SHORT;
+  } else if (periodMicros > typical * OUTLIER_RATIO) {
+    verdict = Verdict::TOO_LONG;
+  }
+
+  if (verdict != Verdict::ACCEPT) {
+    outlierRejectCount.store(outlierRejectCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    // A run of rejections means the speed really changed, start over from this period
+    consecutiveRejects = consecutiveRejects + 1;
+    if (consecutiveRejects < MEDIAN_LENGTH) {
+      return verdict;
+    }
+    reset();
+  }
+
+  consecutiveRejects = 0;
+  remember(periodMicros);
+  return Verdict::ACCEPT;
+}
+
+void EdgeFilter::reset() {
+  recentIndex = 0;
+  recentCount = 0;
+  consecutiveRejects = 0;
+  storeLockout(MIN_LOCKOUT_US);
+}
+
+void EdgeFilter::remember(uint32_t periodMicros) {
+  recentPeriods[recentIndex] = periodMicros;
+  recentIndex = (recentIndex + 1 == MEDIAN_LENGTH) ? 0 : recentIndex + 1;
+  if (recentCount < MEDIAN_LENGTH) {
+    recentCount = recentCount + 1;
+  }
+
+  if (recentCount == MEDIAN_LENGTH) {
+    const uint32_t lockout = median() / LOCKOUT_DIVISOR;
+    storeLockout(lockout > MIN_LOCKOUT_US ? lockout : MIN_LOCKOUT_US);
+  }
+}
+
+void EdgeFilter::storeLockout(uint32_t micros) {
+  lockoutTicks.store(micros * ticksPerMicro, std::memory_order_relaxed);
+}
+
+uint32_t EdgeFilter::median() const {
+  uint32_t sorted[MEDIAN_LENGTH];
+  memcpy(sorted, recentPeriods, sizeof(sorted));
+
+  // Insertion sort, five elements
+  for (uint8_t i = 1; i < MEDIAN_LENGTH; i++) {
+    const uint32_t value = sorted[i];
+    uint8_t j = i;
+    while (j > 0 && sorted[j - 1] > value) {
+      sorted[j] = sorted[j - 1];
+      j--;
+    }
+    sorted[j] = value;
+  }
+
+  return sorted[MEDIAN_LENGTH / 2];
+}
@@ -0,0 +1,339 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include "esp_timer.h"
+
+/*
+  Raw edge capture for offline analysis: every edge the speed task pops from a calculator's
+  ring is stored as an esp_timer microsecond timestamp, before any filtering or windowing.
+
+  - The buffer is allocated once in begin(), in PSRAM when the board has it, internal RAM
+    otherwise. Nothing is allocated or locked while recording and the ISRs are untouched:
+    the speed task writes the edges it already pops, one store per edge.
+  - A capture is armed over the API and starts immediately (MANUAL) or once a trigger
+    condition is met on the published speeds. It ends when every channel is full or the
+    duration has elapsed, whichever comes first.
+  - Within a channel timestamps are built from capture ticks, as precise as the backend.
+    Each channel is anchored to esp_timer at its first recorded edge, so channels line up
+    only to within the speed task latency.
+  - One writer per channel (its speed task), the HTTP handler only reads a finished capture.
+*/
+class EdgeRecorder {
+public:
+  static constexpr size_t MAX_CHANNELS = 6;
+  static constexpr uint32_t DEFAULT_EDGES_PER_CHANNEL = 10240;
+  static constexpr uint32_t DEFAULT_DURATION_MS = 30000;
+  static constexpr uint32_t MAX_DURATION_MS = 600000;    // Keeps the microsecond span far from wrapping
+
+  enum class State : uint8_t {
+    IDLE,
+    ARMED,
+    RECORDING,
+    DONE
+  };
+
+  enum class Trigger : uint8_t {
+    MANUAL,           // Start as soon as armed
+    SPEED_ABOVE,      // Any channel above threshold RPM
+    SPEED_DIFFERENCE  // Fastest and slowest channel more than threshold RPM apart
+  };
+
+  // Download layout, little endian: FileHeader, channelCount ChannelHeaders,
+  // then the uint32_t timestamps of channel 0, channel 1, ...
+  struct __attribute__((packed)) FileHeader {
+    char magic[4];           // "EDGE"
+    uint16_t version;
+    uint16_t channelCount;
+    uint32_t startMicros;    // esp_timer time the capture was triggered
+    uint32_t durationMicros;
+  };
+
+  struct __attribute__((packed)) ChannelHeader {
+    uint32_t edgeCount;
+    uint16_t edgesPerRevolution;
+    uint16_t reserved;
+  };
+
+private:
+  static constexpr uint16_t FILE_VERSION = 1;
+
+  struct Channel {
+    uint32_t *edges;
+    std::atomic<uint32_t> count;
+    uint16_t edgesPerRevolution;
+    std::atomic<float> rpm;
+
+    // Task-side time base of the running capture
+    bool anchored;
+    uint32_t anchorMicros;
+    uint32_t lastTicks;
+    uint32_t lastArrivalMicros;
+    uint64_t elapsedTicks;
+  };
+
+  Channel channels[MAX_CHANNELS];
+  uint8_t channelCount;
+  uint32_t edgesPerChannel;
+  uint32_t *storage;
+  bool inPsram;
+
+  std::atomic<State> state;
+  Trigger trigger;
+  float threshold;
+  uint32_t durationMicros;
+  uint32_t startMicros;
+  uint32_t stopMicros;
+
+  inline bool triggerMet() const __attribute__((always_inline));
+  inline bool allFull() const __attribute__((always_inline));
+  inline void finish(uint32_t nowMicros) __attribute__((always_inline));
+
+public:
+  EdgeRecorder(uint32_t edgesPerChannel = DEFAULT_EDGES_PER_CHANNEL);
+
+  // Registers a channel before begin(), returns its index or -1 when full
+  int8_t addChannel(uint16_t edgesPerRevolution);
+
+  // Allocates the capture buffer, false when neither PSRAM nor RAM has room
+  bool begin();
+
+  // API side. arm() fails while a capture is recording or without a buffer.
+  bool arm(Trigger trigger, float threshold, uint32_t durationMs = DEFAULT_DURATION_MS);
+  void stop();
+
+  // Speed task side, per popped edge and once per pass
+  inline void record(uint8_t channel, uint32_t ticks, uint32_t ticksPerMicro, uint32_t arrivalMicros) __attribute__((always_inline));
+  inline void updateSpeed(uint8_t channel, float rpm, uint32_t nowMicros) __attribute__((always_inline));
+
+  // True while edges are wanted, calculators stay in period mode meanwhile
+  inline bool isActive() const { State s = state.load(std::memory_order_relaxed); return s == State::ARMED || s == State::RECORDING; }
+
+  inline State getState() const { return state.load(std::memory_order_acquire); }
+  inline uint8_t getChannelCount() const { return channelCount; }
+  inline uint32_t getEdgesPerChannel() const { return storage != nullptr ? edgesPerChannel : 0; }
+  inline uint32_t getEdgeCount(uint8_t channel) const { return channels[channel].count.load(std::memory_order_acquire); }
+  inline bool isInPsram() const { return inPsram; }
+
+  // Download of a finished capture, valid in DONE only
+  size_t getDownloadSize() const;
+  void fillHeader(FileHeader &header) const;
+  void fillChannelHeader(uint8_t channel, ChannelHeader &header) const;
+  inline const uint32_t *getEdges(uint8_t channel) const { return channels[channel].edges; }
+
+  static const char *stateName(State state);
+  static bool parseTrigger(const char *name, Trigger &trigger);
+};
+
+EdgeRecorder::EdgeRecorder(uint32_t edgesPerChannel) :
+channelCount(0),
+edgesPerChannel(edgesPerChannel),
+storage(nullptr),
+inPsram(false),
+state(State::IDLE),
+trigger(Trigger::MANUAL),
+threshold(0.0f),
+durationMicros(DEFAULT_DURATION_MS * 1000),
+startMicros(0),
+stopMicros(0)
+{
+  for (size_t i = 0; i < MAX_CHANNELS; i++) {
+    channels[i].edges = nullptr;
+    channels[i].count.store(0, std::memory_order_relaxed);
+    channels[i].edgesPerRevolution = 0;
+    channels[i].rpm.store(0.0f, std::memory_order_relaxed);
+    channels[i].anchored = false;
+  }
+}
+
+int8_t EdgeRecorder::addChannel(uint16_t edgesPerRevolution) {
+  if (channelCount >= MAX_CHANNELS || storage != nullptr) {
+    ESP_LOGE("EdgeRecorder", "Cannot add a capture channel");
+    return -1;
+  }
+
+  channels[channelCount].edgesPerRevolution = edgesPerRevolution;
+  return channelCount++;
+}
+
+bool EdgeRecorder::begin() {
+  const char *TAG = "EdgeRecorder::begin";
+
+  if (channelCount == 0) return false;
+
+  const size_t bytes = static_cast<size_t>(channelCount) * edgesPerChannel * sizeof(uint32_t);
+  storage = static_cast<uint32_t*>(heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+  inPsram = (storage != nullptr);
+  if (storage == nullptr) {
+    storage = static_cast<uint32_t*>(heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+  }
+
+  if (storage == nullptr) {
+    ESP_LOGE(TAG, "No room for %u bytes of edge capture", static_cast<unsigned>(bytes));
+    return false;
+  }
+
+  for (uint8_t i = 0; i < channelCount; i++) {
+    channels[i].edges = storage + static_cast<size_t>(i) * edgesPerChannel;
+  }
+
+  ESP_LOGI(TAG, "Edge capture: %u edges x %u channels in %s", static_cast<unsigned>(edgesPerChannel),
+           channelCount, inPsram ? "PSRAM" : "internal RAM");
+  return true;
+}
+
+bool EdgeRecorder::arm(Trigger trigger, float threshold, uint32_t durationMs) {
+  if (storage == nullptr) return false;
+
+  // A trigger may fire concurrently, only take over a capture that is not recording.
+  // No channel writes outside RECORDING, the task state can be reset from here.
+  State current = state.load(std::memory_order_acquire);
+  do {
+    if (current == State::RECORDING) return false;
+  } while (!state.compare_exchange_weak(current, State::IDLE, std::memory_order_acq_rel));
+
+  this->trigger = trigger;
+  this->threshold = threshold;
+  if (durationMs == 0) durationMs = DEFAULT_DURATION_MS;
+  if (durationMs > MAX_DURATION_MS) durationMs = MAX_DURATION_MS;
+  durationMicros = durationMs * 1000;
+  for (uint8_t i = 0; i < channelCount; i++) {
+    channels[i].count.store(0, std::memory_order_relaxed);
+    channels[i].anchored = false;
+  }
+  startMicros = 0;
+  stopMicros = 0;
+
+  state.store(State::ARMED, std::memory_order_release);
+  ESP_LOGI("EdgeRecorder", "Capture armed, trigger %u threshold %.0f", static_cast<unsigned>(trigger), threshold);
+  return true;
+}
+
+void EdgeRecorder::stop() {
+  const State current = state.load(std::memory_order_acquire);
+  if (current == State::RECORDING) {
+    finish(static_cast<uint32_t>(esp_timer_get_time()));
+  } else if (current == State::ARMED) {
+    state.store(State::IDLE, std::memory_order_release);
+  }
+}
+
+void EdgeRecorder::record(uint8_t channel, uint32_t ticks, uint32_t ticksPerMicro, uint32_t arrivalMicros) {
+  if (state.load(std::memory_order_relaxed) != State::RECORDING) return;
+
+  Channel &c = channels[channel];
+  const uint32_t index = c.count.load(std::memory_order_relaxed);
+  if (index >= edgesPerChannel) return;
+
+  // First edge, or the tick counter may have wrapped since the last one: anchor on arrival
+  if (!c.anchored || (arrivalMicros - c.lastArrivalMicros) >= UINT32_MAX / ticksPerMicro) {
+    c.anchored = true;
+    c.anchorMicros = arrivalMicros;
+    c.elapsedTicks = 0;
+  } else {
+    // Ticks are accumulated, not microseconds, so the division never drifts
+    c.elapsedTicks += ticks - c.lastTicks;
+  }
+  c.lastTicks = ticks;
+  c.lastArrivalMicros = arrivalMicros;
+
+  c.edges[index] = c.anchorMicros + static_cast<uint32_t>(c.elapsedTicks / ticksPerMicro);
+  c.count.store(index + 1, std::memory_order_release);
+}
+
+void EdgeRecorder::updateSpeed(uint8_t channel, float rpm, uint32_t nowMicros) {
+  channels[channel].rpm.store(rpm, std::memory_order_relaxed);
+
+  State current = state.load(std::memory_order_acquire);
+  if (current == State::ARMED && triggerMet()) {
+    // Several speed tasks may see the trigger, only one starts the capture
+    if (state.compare_exchange_strong(current, State::RECORDING, std::memory_order_acq_rel)) {
+      startMicros = nowMicros;
+      ESP_LOGI("EdgeRecorder", "Capture triggered");
+    }
+    return;
+  }
+
+  if (current == State::RECORDING && (allFull() || (nowMicros - startMicros) >= durationMicros)) {
+    finish(nowMicros);
+  }
+}
+
+bool EdgeRecorder::triggerMet() const {
+  if (trigger == Trigger::MANUAL) return true;
+
+  float fastest = channels[0].rpm.load(std::memory_order_relaxed);
+  float slowest = fastest;
+  for (uint8_t i = 1; i < channelCount; i++) {
+    const float rpm = channels[i].rpm.load(std::memory_order_relaxed);
+    if (rpm > fastest) fastest = rpm;
+    if (rpm < slowest) slowest = rpm;
+  }
+
+  if (trigger == Trigger::SPEED_ABOVE) {
+    return fastest > threshold;
+  }
+  return (fastest - slowest) > threshold;
+}
+
+bool EdgeRecorder::allFull() const {
+  for (uint8_t i = 0; i < channelCount; i++) {
+    if (channels[i].count.load(std::memory_order_relaxed) < edgesPerChannel) return false;
+  }
+  return true;
+}
+
+void EdgeRecorder::finish(uint32_t nowMicros) {
+  State expected = State::RECORDING;
+  if (!state.compare_exchange_strong(expected, State::DONE, std::memory_order_acq_rel)) return;
+
+  stopMicros = nowMicros;
+  ESP_LOGI("EdgeRecorder", "Capture done after %u ms", static_cast<unsigned>((stopMicros - startMicros) / 1000));
+}
+
+size_t EdgeRecorder::getDownloadSize() const {
+  size_t bytes = sizeof(FileHeader) + channelCount * sizeof(ChannelHeader);
+  for (uint8_t i = 0; i < channelCount; i++) {
+    bytes += getEdgeCount(i) * sizeof(uint32_t);
+  }
+  return bytes;
+}
+
+void EdgeRecorder::fillHeader(FileHeader &header) const {
+  memcpy(header.magic, "EDGE", sizeof(header.magic));
+  header.version = FILE_VERSION;
+  header.channelCount = channelCount;
+  header.startMicros = startMicros;
+  header.durationMicros = stopMicros - startMicros;
+}
+
+void EdgeRecorder::fillChannelHeader(uint8_t channel, ChannelHeader &header) const {
+  header.edgeCount = getEdgeCount(channel);
+  header.edgesPerRevolution = channels[channel].edgesPerRevolution;
+  header.reserved = 0;
+}
+
+const char *EdgeRecorder::stateName(State state) {
+  switch (state) {
+    case State::ARMED: return "armed";
+    case State::RECORDING: return "recording";
+    case State::DONE: return "done";
+    default: return "idle";
+  }
+}
+
+bool EdgeRecorder::parseTrigger(const char *name, Trigger &trigger) {
+  if (name == nullptr || strcmp(name, "manual") == 0) {
+    trigger = Trigger::MANUAL;
+  } else if (strcmp(name, "speed_above") == 0) {
+    trigger = Trigger::SPEED_ABOVE;
+  } else if (strcmp(name, "speed_difference") == 0) {
+    trigger = Trigger::SPEED_DIFFERENCE;
+  } else {
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,266 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+/*
+  Steady-state duty to speed map of one motor, learned by a calibration sweep.
+
+  - The sweep steps the duty down from maxDuty (at most MAX_SWEEP_DUTY) to 0 in POINTS - 1
+    equal steps. The duty slews into every point at SLEW_DUTY_PER_SECOND, from standstill
+    too, so the sweep never steps the motor current. Once at the point it waits SETTLE_MS,
+    then averages speed and current over WINDOW_MS windows until two windows in a row agree
+    within STEADY_TOLERANCE (or POINT_TIMEOUT_MS passes).
+  - Going down keeps the motor turning, so only the first point below the deadband sees a
+    standstill. The sweep ends there and fills the lower points with zero speed. A stopped
+    motor never sits at a stall duty long enough to look like lost feedback. The deadband
+    found is the stall duty, a little below the breakaway duty; the loop's integrator covers
+    the gap.
+  - The measured speeds are made monotonic (a point never exceeds the one above it) before
+    the table is installed. dutyFor() inverts it by linear interpolation, with speeds above
+    the table clamped to its top duty.
+  - A sweep in progress does not touch the installed table, an aborted sweep keeps the old one.
+
+  Plain arithmetic without any ESP-IDF dependency, feed it a simulated motor on the host.
+  Only used from task context, no synchronization needed.
+*/
+class FeedforwardTable {
+public:
+  enum class Status : uint8_t {
+    EMPTY,
+    SWEEPING,
+    READY,
+    ABORTED
+  };
+
+  struct Point {
+    float duty;
+    float rpm;
+    float current;          // Amps
+  };
+
+  static constexpr uint8_t POINTS = 16;
+  static constexpr uint32_t SETTLE_MS = 500;
+  static constexpr uint32_t WINDOW_MS = 400;
+  static constexpr uint32_t POINT_TIMEOUT_MS = 5000;  // Bounds a sweep to POINTS * 5 s
+  static constexpr float STEADY_TOLERANCE = 0.02f;
+  static constexpr float STEADY_MIN_RPM = 3.0f;       // Tolerance floor at low speed
+  static constexpr float STANDSTILL_RPM = 1.0f;
+  static constexpr float MAX_SWEEP_DUTY = 0.9f;
+  static constexpr float SLEW_DUTY_PER_SECOND = 0.5f;  // Standstill to MAX_SWEEP_DUTY in 1.8 s
+
+private:
+  Point table[POINTS];
+  bool ready;
+
+  // Sweep
+  Point swept[POINTS];
+  bool sweeping;
+  bool aborted;
+  uint8_t index;
+  float duty;               // Commanded, slewing towards the point
+  uint32_t sampleMs;
+  uint32_t pointMs;
+  uint32_t windowMs;
+  float speedSum;
+  float currentSum;
+  uint32_t windowSamples;
+  float previousWindowRpm;
+  bool hasPreviousWindow;
+
+  void startPoint();
+  void recordPoint(float rpm, float current);
+
+public:
+  FeedforwardTable();
+
+  // Begins a sweep up to maxDuty from standstill, update() is then due every sampleMs
+  void startSweep(float maxDuty, uint32_t sampleMs);
+  void abort();
+
+  // Next sample of the swept motor, returns the duty to drive
+  float update(float rpm, float current);
+
+  inline bool isSweeping() const { return sweeping; }
+  Status getStatus() const;
+
+  // Installs a table (ascending duty), made monotonic. False and unchanged when it is invalid.
+  bool setTable(const Point *points);
+  inline const Point *getTable() const { return table; }
+  inline bool isReady() const { return ready; }
+
+  // Steady duty for rpm, 0 without a table
+  float dutyFor(float rpm) const;
+
+  static const char *statusName(Status status);
+};
+
+FeedforwardTable::FeedforwardTable() :
+ready(false),
+sweeping(false),
+aborted(false),
+index(0),
+duty(0.0f),
+sampleMs(1),
+pointMs(0),
+windowMs(0),
+speedSum(0.0f),
+currentSum(0.0f),
+windowSamples(0),
+previousWindowRpm(0.0f),
+hasPreviousWindow(false)
+{
+  memset(table, 0, sizeof(table));
+  memset(swept, 0, sizeof(swept));
+}
+
+void FeedforwardTable::startSweep(float maxDuty, uint32_t sampleMs) {
+  if (!(maxDuty > 0.0f)) return;
+  if (maxDuty > MAX_SWEEP_DUTY) maxDuty = MAX_SWEEP_DUTY;
+
+  for (uint8_t i = 0; i < POINTS; i++) {
+    swept[i].duty = maxDuty * i / (POINTS - 1);
+    swept[i].rpm = 0.0f;
+    swept[i].current = 0.0f;
+  }
+  this->sampleMs = sampleMs > 0 ? sampleMs : 1;
+  index = POINTS - 1;
+  duty = 0.0f;
+  sweeping = true;
+  aborted = false;
+  startPoint();
+}
+
+void FeedforwardTable::abort() {
+  if (sweeping) {
+    sweeping = false;
+    aborted = true;
+  }
+}
+
+void FeedforwardTable::startPoint() {
+  pointMs = 0;
+  windowMs = 0;
+  speedSum = 0.0f;
+  currentSum = 0.0f;
+  windowSamples = 0;
+  hasPreviousWindow = false;
+}
+
+float FeedforwardTable::update(float rpm, float current) {
+  if (!sweeping) return 0.0f;
+
+  // The point's timers start once the duty has arrived
+  const float target = swept[index].duty;
+  if (duty != target) {
+    const float slew = SLEW_DUTY_PER_SECOND * sampleMs / 1000.0f;
+    if (fabsf(target - duty) <= slew) {
+      duty = target;
+    } else {
+      duty += target > duty ? slew : -slew;
+    }
+    return duty;
+  }
+
+  pointMs += sampleMs;
+  if (pointMs <= SETTLE_MS) return duty;
+
+  speedSum += rpm;
+  currentSum += current;
+  windowSamples++;
+  windowMs += sampleMs;
+  if (windowMs < WINDOW_MS) return duty;
+
+  const float windowRpm = speedSum / windowSamples;
+  const float windowCurrent = currentSum / windowSamples;
+  const float tolerance = fmaxf(windowRpm * STEADY_TOLERANCE, STEADY_MIN_RPM);
+  const bool standstill = windowRpm < STANDSTILL_RPM;
+  const bool steady = hasPreviousWindow && fabsf(windowRpm - previousWindowRpm) <= tolerance;
+
+  if (standstill || steady || pointMs >= POINT_TIMEOUT_MS) {
+    recordPoint(windowRpm, windowCurrent);
+    return sweeping ? duty : 0.0f;
+  }
+
+  previousWindowRpm = windowRpm;
+  hasPreviousWindow = true;
+  windowMs = 0;
+  speedSum = 0.0f;
+  currentSum = 0.0f;
+  windowSamples = 0;
+  return duty;
+}
+
+void FeedforwardTable::recordPoint(float rpm, float current) {
+  if (rpm < STANDSTILL_RPM) {
+    // Below the deadband, every lower duty stands still too
+    for (int16_t i = index; i >= 0; i--) {
+      swept[i].rpm = 0.0f;
+      swept[i].current = (i == index) ? current : 0.0f;
+    }
+    index = 0;
+  } else {
+    swept[index].rpm = rpm;
+    swept[index].current = current;
+  }
+
+  if (index > 0) {
+    index--;
+    startPoint();
+    return;
+  }
+
+  sweeping = false;
+  aborted = !setTable(swept);
+}
+
+FeedforwardTable::Status FeedforwardTable::getStatus() const {
+  if (sweeping) return Status::SWEEPING;
+  if (aborted) return Status::ABORTED;
+  return ready ? Status::READY : Status::EMPTY;
+}
+
+bool FeedforwardTable::setTable(const Point *points) {
+  for (uint8_t i = 0; i < POINTS; i++) {
+    const Point &point = points[i];
+    if (!(point.duty >= 0.0f && point.duty <= 1.0f) || !(point.rpm >= 0.0f) || !std::isfinite(point.rpm) ||
+        !std::isfinite(point.current)) {
+      return false;
+    }
+    if (i > 0 && !(point.duty > points[i - 1].duty)) return false;
+  }
+  if (!(points[POINTS - 1].rpm >= STANDSTILL_RPM)) return false;   // The motor never turned
+
+  memcpy(table, points, sizeof(table));
+  for (int16_t i = POINTS - 2; i >= 0; i--) {
+    if (table[i].rpm > table[i + 1].rpm) {
+      table[i].rpm = table[i + 1].rpm;
+    }
+  }
+  ready = true;
+  return true;
+}
+
+float FeedforwardTable::dutyFor(float rpm) const {
+  if (!ready || !(rpm > 0.0f)) return 0.0f;
+  if (rpm <= table[0].rpm) return table[0].duty;
+  if (rpm >= table[POINTS - 1].rpm) return table[POINTS - 1].duty;
+
+  // First point reaching rpm, the one below it is slower
+  uint8_t i = 1;
+  while (table[i].rpm < rpm) i++;
+
+  const Point &below = table[i - 1];
+  const Point &above = table[i];
+  return below.duty + (rpm - below.rpm) / (above.rpm - below.rpm) * (above.duty - below.duty);
+}
+
+const char *FeedforwardTable::statusName(Status status) {
+  switch (status) {
+    case Status::SWEEPING: return "sweeping";
+    case Status::READY: return "ready";
+    case Status::ABORTED: return "aborted";
+    default: return "empty";
+  }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+/*
+  Signed fixed-point number with FractionBits fractional bits, for control loops on cores
+  without a fast FPU or where results must be bit-exact across builds.
+
+  - Arithmetic saturates at the range of Storage instead of wrapping, a controller that
+    overshoots its numeric range clamps like it would clamp its output.
+  - Products and quotients go through a 64-bit intermediate and round to nearest.
+  - Converts implicitly from float so generic code can write T(0.5f), converting back is
+    explicit.
+
+  Q16 (16.16 in int32_t) covers +-32767 with a step of 1.5e-5, enough for normalized speeds
+  and gains.
+*/
+template <uint8_t FractionBits, typename Storage = int32_t>
+class FixedPoint {
+private:
+  static_assert(std::numeric_limits<Storage>::is_signed, "Storage must be signed");
+  static_assert(FractionBits < sizeof(Storage) * 8 - 1, "No integer bits left");
+
+  static constexpr int64_t ONE = static_cast<int64_t>(1) << FractionBits;
+  static constexpr int64_t MAX_RAW = std::numeric_limits<Storage>::max();
+  static constexpr int64_t MIN_RAW = std::numeric_limits<Storage>::min();
+
+  Storage raw;
+
+  static constexpr Storage saturate(int64_t value) {
+    return static_cast<Storage>(value > MAX_RAW ? MAX_RAW : (value < MIN_RAW ? MIN_RAW : value));
+  }
+
+  static constexpr Storage fromFloat(float value) {
+    const float scaled = value * ONE;
+    if (scaled != scaled) return 0;   // NaN
+    if (scaled <= static_cast<float>(MIN_RAW)) return static_cast<Storage>(MIN_RAW);
+    if (scaled >= static_cast<float>(MAX_RAW)) return static_cast<Storage>(MAX_RAW);
+    return saturate(static_cast<int64_t>(scaled + (scaled >= 0.0f ? 0.5f : -0.5f)));
+  }
+
+  struct RawTag {};
+  constexpr FixedPoint(Storage raw, RawTag) : raw(raw) {}
+
+public:
+  constexpr FixedPoint() : raw(0) {}
+  constexpr FixedPoint(float value) : raw(fromFloat(value)) {}
+  constexpr FixedPoint(int value) : raw(saturate(static_cast<int64_t>(value) * ONE)) {}
+
+  static constexpr FixedPoint fromRaw(Storage raw) { return FixedPoint(raw, RawTag()); }
+  constexpr Storage toRaw() const { return raw; }
+
+  explicit constexpr operator float() const { return static_cast<float>(raw) / ONE; }
+
+  friend constexpr FixedPoint operator+(FixedPoint a, FixedPoint b) {
+    return fromRaw(saturate(static_cast<int64_t>(a.raw) + b.raw));
+  }
+  friend constexpr FixedPoint operator-(FixedPoint a, FixedPoint b) {
+    return fromRaw(saturate(static_cast<int64_t>(a.raw) - b.raw));
+  }
+  friend constexpr FixedPoint operator*(FixedPoint a, FixedPoint b) {
+    const int64_t product = static_cast<int64_t>(a.raw) * b.raw;
+    return fromRaw(saturate((product + (product >= 0 ? ONE / 2 : -ONE / 2)) / ONE));
+  }
+  friend constexpr FixedPoint operator/(FixedPoint a, FixedPoint b) {
+    if (b.raw == 0) return fromRaw(a.raw >= 0 ? saturate(MAX_RAW) : saturate(MIN_RAW));
+    const int64_t numerator = static_cast<int64_t>(a.raw) * ONE;
+    const int64_t half = ((numerator >= 0) == (b.raw >= 0) ? b.raw / 2 : -b.raw / 2);
+    return fromRaw(saturate((numerator + half) / b.raw));
+  }
+  constexpr FixedPoint operator-() const { return fromRaw(saturate(-static_cast<int64_t>(raw))); }
+
+  FixedPoint &operator+=(FixedPoint other) { return *this = *this + other; }
+  FixedPoint &operator-=(FixedPoint other) { return *this = *this - other; }
+  FixedPoint &operator*=(FixedPoint other) { return *this = *this * other; }
+  FixedPoint &operator/=(FixedPoint other) { return *this = *this / other; }
+
+  friend constexpr bool operator==(FixedPoint a, FixedPoint b) { return a.raw == b.raw; }
+  friend constexpr bool operator!=(FixedPoint a, FixedPoint b) { return a.raw != b.raw; }
+  friend constexpr bool operator<(FixedPoint a, FixedPoint b) { return a.raw < b.raw; }
+  friend constexpr bool operator>(FixedPoint a, FixedPoint b) { return a.raw > b.raw; }
+  friend constexpr bool operator<=(FixedPoint a, FixedPoint b) { return a.raw <= b.raw; }
+  friend constexpr bool operator>=(FixedPoint a, FixedPoint b) { return a.raw >= b.raw; }
+};
+
+using Q16 = FixedPoint<16>;
@@ -7,7 +7,14 @@
 #include <atomic>
 
 #include "PwmGenerator.hpp"
+#include "PwmGroup.hpp"
 #include "BLDCPulseCalculator.hpp"
+#include "SpeedSensorBank.hpp"
+#include "OdometryStore.hpp"
+#include "EdgeRecorder.hpp"
+#include "SectorCalibrationStore.hpp"
+#include "SpeedController.hpp"
+#include "SpeedGainStore.hpp"
 #include "MotorDirection.hpp"
 #include "DoorLock.hpp"
 #include "UARTCurrentSensor.hpp"
@@ -26,7 +33,19 @@ static const BaseType_t app_cpu1 = 1;  // Web server, WebSocket, speed calculati
 
 // Motor Properties
 const uint32_t frequency = 100000;                            // PWM frequency in Hz
-const ledc_timer_bit_t resolution = LEDC_TIMER_8_BIT;         // PWM resolution (8-bit)
+const ledc_timer_bit_t resolution = PwmGenerator::AUTO_RESOLUTION;  // Most duty bits the LEDC clock allows (9-bit at 100 kHz)
+const CaptureBackend speedCaptureBackend = CaptureBackend::MCPWM_CAPTURE;  // Hall edges timestamped by MCPWM capture
+constexpr size_t maxSpeedSensors = 6;                         // Feedback inputs served by the speed sensor bank
+using MotorSpeedSensorBank = SpeedSensorBank<MotorPulseCalculator, maxSpeedSensors>;
+using MotorOdometryStore = OdometryStore<MotorPulseCalculator, maxSpeedSensors>;
+using MotorSectorCalibrationStore = SectorCalibrationStore<MotorPulseCalculator, maxSpeedSensors>;
+constexpr uint16_t sectorCalibrationRevolutions = 50;         // Steady revolutions averaged by a sector calibration run
+using MotorSpeedController = SpeedController<MotorPulseCalculator, 2>;  // Closed-loop RPM control of both motors
+constexpr float maxMotorRpm = 600.0f;                         // Speed loop scale, ~535 rpm no-load at full duty
+using MotorSpeedGainStore = SpeedGainStore<MotorSpeedController, 2>;
+constexpr float autotuneAmplitude = 0.1f;                     // Relay duty step around the autotune operating point
+constexpr uint32_t autotuneTimeoutMs = 30000;                 // Longest autotune run before it gives up at zero duty
+extern const float wheelDiameterMeters;                       // Hub motor wheel diameter, distance = revolutions * PI * D
 
 // ESP32 DevKit V1 Pin Configuration
 // Motor 1 Configuration  
@@ -59,8 +78,15 @@ constexpr gpio_num_t UART_RX_PIN = GPIO_NUM_16;     // UART2 RX from Arduino Nan
 // Global Objects
 extern PwmGenerator motorPWM1;
 extern PwmGenerator motorPWM2;
-extern BLDCPulseCalculator motorPulse1;
-extern BLDCPulseCalculator motorPulse2;
+extern MotorPwmGroup motorPWMGroup;       // Phase aligned duty commits of both motors
+extern MotorPulseCalculator motorPulse1;
+extern MotorPulseCalculator motorPulse2;
+extern MotorSpeedSensorBank speedSensors; // One ISR and one task for every feedback input
+extern MotorOdometryStore odometryStore;  // NVS persistence of the per-motor odometry
+extern EdgeRecorder edgeRecorder;         // Raw edge capture of both motors for offline analysis
+extern MotorSectorCalibrationStore sectorCalibrationStore; // NVS persistence of the magnet spacing tables
+extern MotorSpeedController motorSpeedController; // PID from the RPM setpoint to the PWM duty
+extern MotorSpeedGainStore speedGainStore;        // NVS persistence of the autotuned gains and feedforward tables
 extern MotorDirection direction;        // Future implementation
 extern DoorLock doorLock;              // Door solenoid control
 extern UARTCurrentSensor currentSensor; // UART communication with Arduino Nano
@@ -71,10 +97,11 @@ extern DataCollector dataCollector;
 extern ControlInterface controlInterface;
 
 // Task Handles
-extern TaskHandle_t motor1SpeedTaskHandle;
-extern TaskHandle_t motor2SpeedTaskHandle;
-extern TaskHandle_t motor1PWMTaskHandle;
-extern TaskHandle_t motor2PWMTaskHandle;
+extern TaskHandle_t speedSensorTaskHandle;
+extern TaskHandle_t odometryStoreTaskHandle;
+extern TaskHandle_t sectorCalibrationStoreTaskHandle;
+extern TaskHandle_t speedControllerTaskHandle;
+extern TaskHandle_t speedGainStoreTaskHandle;
 extern TaskHandle_t currentSensorTaskHandle;
 extern TaskHandle_t dataCollectorTaskHandle;
 extern TaskHandle_t webSocketTaskHandle;
@@ -106,4 +133,5 @@ float motor2Speed = 0.0f;
 float motor1Current = 0.0f;
 float motor2Current = 0.0f;
 float systemVoltage = 0.0f;
-gpio_num_t lightsPin = GPIO_NUM_27;
\ No newline at end of file
+gpio_num_t lightsPin = GPIO_NUM_27;
+const float wheelDiameterMeters = 0.254f;   // 10 inch hub motor wheel
\ No newline at end of file
@@ -0,0 +1,293 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/*
+  Online health check of one Hall feedback input, fed by the speed task.
+
+  A dead sensor or an intermittent wire otherwise only looks like a slower wheel. Faults are
+  bits of one code, active while their condition holds and latched until clearLatched():
+  - NO_FEEDBACK:         driven at DRIVE_MIN_DUTY or more for NO_FEEDBACK_US without an edge
+  - SPEED_LOW_FOR_DRIVE: at a steady duty the speed stays below LOW_SPEED_RATIO of the
+                         speed per duty learned while healthy (edges lost, or a stalled wheel)
+  - DUTY_ASYMMETRY:      the two halves of a feedback pulse differ by more than
+                         ASYMMETRY_LIMIT on average, the sensor threshold is drifting
+  - MISSING_EDGES:       more than MISSING_EDGE_LIMIT of the periods spanned a lost edge.
+                         A single lost edge merges two halves of a pulse, about twice the
+                         mean of the two periods before it whatever the pulse asymmetry.
+                         The edge filter only rejects far longer gaps.
+  - NOISY_EDGES:         more than SPURIOUS_EDGE_LIMIT of the edges were outlier glitches, or
+                         the ISR lockout dropped more than LOCKOUT_REJECT_LIMIT edges per
+                         good one (some ringing is expected, a glitch on most edges is not;
+                         a pulse too asymmetric for the filter also ends up here)
+  - EDGE_OVERFLOW:       the edge ring overflowed, the speed task is starved
+
+  Edge ratios are judged over WINDOW_US windows holding at least MIN_WINDOW_EDGES edges, so
+  frequency mode (no edges in the task) and standstill never raise them.
+  Every input is O(1), cheap enough to stay on in production.
+  Plain arithmetic without any ESP-IDF dependency, feed it simulated edges on the host.
+*/
+class HallDiagnostics {
+public:
+  enum Fault : uint8_t {
+    NO_FEEDBACK         = 1 << 0,
+    SPEED_LOW_FOR_DRIVE = 1 << 1,
+    DUTY_ASYMMETRY      = 1 << 2,
+    MISSING_EDGES       = 1 << 3,
+    NOISY_EDGES         = 1 << 4,
+    EDGE_OVERFLOW       = 1 << 5
+  };
+  static constexpr uint8_t FAULT_COUNT = 6;
+
+private:
+  static constexpr uint32_t WINDOW_US = 1000000;
+  static constexpr uint32_t MIN_WINDOW_EDGES = 16;
+  static constexpr float MISSING_EDGE_LIMIT = 0.02f;
+  static constexpr float SPURIOUS_EDGE_LIMIT = 0.05f;
+  static constexpr float LOCKOUT_REJECT_LIMIT = 0.5f;
+  static constexpr float ASYMMETRY_LIMIT = 0.35f;     // 32/68 split, before the edge filter gives up at 25/75
+  static constexpr float LOST_EDGE_RATIO = 1.7f;      // Tolerates down to a 15/85 split
+
+  // Duty in the 0-255 PWM scale. Driven means clearly above the ~0.36 stall duty of the hub
+  // motors: a loop integrating up from standstill at a low setpoint spends seconds below the
+  // breakaway duty with a healthy sensor and no edge.
+  static constexpr uint8_t DRIVE_MIN_DUTY = 115;     // 0.45
+  static constexpr uint8_t DRIVE_STEADY_TOLERANCE = 4;
+  static constexpr uint32_t NO_FEEDBACK_US = 2000000;
+  static constexpr uint32_t DRIVE_SETTLE_US = 1000000;
+  static constexpr uint32_t LOW_SPEED_US = 2000000;
+  static constexpr float LOW_SPEED_RATIO = 0.25f;
+  static constexpr float RPM_PER_DUTY_ALPHA = 0.1f;   // One sample per window, ~10 s time constant
+
+  bool pairedEdges;
+
+  // Current window
+  uint32_t windowStartMicros;
+  uint32_t windowEdges;
+  uint32_t windowMissing;
+  uint32_t windowSpurious;
+  uint32_t windowLockoutRejects;
+  uint32_t windowOverflows;
+  uint32_t windowPairs;
+  float windowAsymmetry;
+  uint32_t previousPeriod;
+  uint32_t olderPeriod;
+
+  // Drive consistency
+  uint8_t steadyDuty;
+  uint32_t steadySinceMicros;
+  uint32_t noEdgesSinceMicros;
+  bool noEdges;
+  uint32_t lowSpeedSinceMicros;
+  bool lowSpeed;
+  float rpmPerDuty;
+  uint32_t lastLearnMicros;
+
+  std::atomic<uint8_t> activeFaults;
+  std::atomic<uint8_t> latchedFaults;
+
+  inline void evaluateWindow() __attribute__((always_inline));
+  inline void evaluateDrive(uint32_t nowMicros, float rpm, uint8_t duty) __attribute__((always_inline));
+  inline void setFault(Fault fault, bool active) __attribute__((always_inline));
+
+public:
+  // pairedEdges: both edges of a pulse are timed, the periods alternate between its halves
+  HallDiagnostics(bool pairedEdges);
+
+  // Speed task, per period verdict
+  inline void onPeriod(uint32_t periodMicros) __attribute__((always_inline));
+  inline void onMissingEdge() __attribute__((always_inline));
+  inline void onSpuriousEdges(uint32_t edges) __attribute__((always_inline));
+  inline void onLockoutRejects(uint32_t edges) __attribute__((always_inline));
+  inline void onOverflow() __attribute__((always_inline));
+
+  // The period sequence restarted (standstill, mode switch), the next period has no history
+  inline void breakSequence() __attribute__((always_inline));
+
+  // Speed task, once per pass with the published speed and the commanded duty
+  inline void update(uint32_t nowMicros, float rpm, uint8_t duty) __attribute__((always_inline));
+
+  // Any task
+  inline uint8_t getActiveFaults() const { return activeFaults.load(std::memory_order_relaxed); }
+  inline uint8_t getLatchedFaults() const { return latchedFaults.load(std::memory_order_relaxed); }
+  inline void clearLatched() { latchedFaults.store(activeFaults.load(std::memory_order_relaxed), std::memory_order_relaxed); }
+
+  static const char *faultName(uint8_t bit);
+};
+
+HallDiagnostics::HallDiagnostics(bool pairedEdges) :
+pairedEdges(pairedEdges),
+windowStartMicros(0),
+windowEdges(0),
+windowMissing(0),
+windowSpurious(0),
+windowLockoutRejects(0),
+windowOverflows(0),
+windowPairs(0),
+windowAsymmetry(0.0f),
+previousPeriod(0),
+olderPeriod(0),
+steadyDuty(0),
+steadySinceMicros(0),
+noEdgesSinceMicros(0),
+noEdges(false),
+lowSpeedSinceMicros(0),
+lowSpeed(false),
+rpmPerDuty(0.0f),
+lastLearnMicros(0),
+activeFaults(0),
+latchedFaults(0)
+{}
+
+void HallDiagnostics::onPeriod(uint32_t periodMicros) {
+  windowEdges = windowEdges + 1;
+
+  const uint32_t previous = previousPeriod;
+  const uint32_t older = olderPeriod;
+  olderPeriod = previous;
+  previousPeriod = periodMicros;
+  if (previous == 0 || older == 0) return;
+
+  // The two periods before are one whole pulse, their mean is half of it
+  const float halfPulse = 0.5f * (static_cast<float>(previous) + older);
+  if (periodMicros > LOST_EDGE_RATIO * halfPulse) {
+    windowMissing = windowMissing + 1;
+    breakSequence();
+    return;
+  }
+
+  if (!pairedEdges) return;
+
+  // Adjacent periods are the two halves of a pulse, in either order
+  const float sum = static_cast<float>(periodMicros) + previous;
+  const float difference = (periodMicros > previous) ? periodMicros - previous : previous - periodMicros;
+  windowAsymmetry += difference / sum;
+  windowPairs = windowPairs + 1;
+}
+
+void HallDiagnostics::onMissingEdge() {
+  windowMissing = windowMissing + 1;
+  breakSequence();
+}
+
+void HallDiagnostics::onSpuriousEdges(uint32_t edges) {
+  windowSpurious += edges;
+}
+
+void HallDiagnostics::onLockoutRejects(uint32_t edges) {
+  windowLockoutRejects += edges;
+}
+
+void HallDiagnostics::onOverflow() {
+  windowOverflows = windowOverflows + 1;
+  breakSequence();
+}
+
+void HallDiagnostics::breakSequence() {
+  previousPeriod = 0;
+  olderPeriod = 0;
+}
+
+void HallDiagnostics::update(uint32_t nowMicros, float rpm, uint8_t duty) {
+  if (nowMicros - windowStartMicros >= WINDOW_US) {
+    evaluateWindow();
+    windowStartMicros = nowMicros;
+  }
+  evaluateDrive(nowMicros, rpm, duty);
+}
+
+void HallDiagnostics::evaluateWindow() {
+  setFault(EDGE_OVERFLOW, windowOverflows > 0);
+
+  // Too few edges to judge ratios, keep the previous verdict
+  if (windowEdges + windowMissing >= MIN_WINDOW_EDGES) {
+    const float periods = static_cast<float>(windowEdges + windowMissing);
+    setFault(MISSING_EDGES, windowMissing > MISSING_EDGE_LIMIT * periods);
+    setFault(NOISY_EDGES, windowSpurious > SPURIOUS_EDGE_LIMIT * (periods + windowSpurious) ||
+                          windowLockoutRejects > LOCKOUT_REJECT_LIMIT * periods);
+  }
+  if (windowPairs >= MIN_WINDOW_EDGES) {
+    setFault(DUTY_ASYMMETRY, windowAsymmetry / windowPairs > ASYMMETRY_LIMIT);
+  }
+
+  windowEdges = 0;
+  windowMissing = 0;
+  windowSpurious = 0;
+  windowLockoutRejects = 0;
+  windowOverflows = 0;
+  windowPairs = 0;
+  windowAsymmetry = 0.0f;
+}
+
+void HallDiagnostics::evaluateDrive(uint32_t nowMicros, float rpm, uint8_t duty) {
+  const int dutyChange = static_cast<int>(duty) - steadyDuty;
+  if (dutyChange > DRIVE_STEADY_TOLERANCE || dutyChange < -DRIVE_STEADY_TOLERANCE) {
+    steadyDuty = duty;
+    steadySinceMicros = nowMicros;
+    lowSpeed = false;
+  }
+
+  const bool driven = duty >= DRIVE_MIN_DUTY;
+
+  // Driven without a single edge
+  if (driven && rpm == 0.0f) {
+    if (!noEdges) {
+      noEdges = true;
+      noEdgesSinceMicros = nowMicros;
+    }
+    setFault(NO_FEEDBACK, nowMicros - noEdgesSinceMicros >= NO_FEEDBACK_US);
+  } else {
+    noEdges = false;
+    setFault(NO_FEEDBACK, false);
+  }
+
+  // Speed against what this duty gave while healthy, only once the wheel had time to settle
+  const bool settled = driven && (nowMicros - steadySinceMicros >= DRIVE_SETTLE_US);
+  if (!settled || rpm == 0.0f) {
+    lowSpeed = false;
+    setFault(SPEED_LOW_FOR_DRIVE, false);
+    return;
+  }
+
+  const float expectedRpm = rpmPerDuty * duty;
+  if (expectedRpm > 0.0f && rpm < LOW_SPEED_RATIO * expectedRpm) {
+    if (!lowSpeed) {
+      lowSpeed = true;
+      lowSpeedSinceMicros = nowMicros;
+    }
+    setFault(SPEED_LOW_FOR_DRIVE, nowMicros - lowSpeedSinceMicros >= LOW_SPEED_US);
+    return;
+  }
+
+  lowSpeed = false;
+  setFault(SPEED_LOW_FOR_DRIVE, false);
+  // Learned slowly so a sensor that degrades over seconds is still caught
+  if (activeFaults.load(std::memory_order_relaxed) == 0 && nowMicros - lastLearnMicros >= WINDOW_US) {
+    lastLearnMicros = nowMicros;
+    const float sample = rpm / duty;
+    rpmPerDuty = (rpmPerDuty == 0.0f) ? sample : rpmPerDuty + RPM_PER_DUTY_ALPHA * (sample - rpmPerDuty);
+  }
+}
+
+void HallDiagnostics::setFault(Fault fault, bool active) {
+  const uint8_t faults = activeFaults.load(std::memory_order_relaxed);
+  if (active) {
+    activeFaults.store(faults | fault, std::memory_order_relaxed);
+    latchedFaults.fetch_or(fault, std::memory_order_relaxed);
+  } else if (faults & fault) {
+    activeFaults.store(faults & ~fault, std::memory_order_relaxed);
+  }
+}
+
+const char *HallDiagnostics::faultName(uint8_t bit) {
+  switch (bit) {
+    case NO_FEEDBACK: return "no_feedback";
+    case SPEED_LOW_FOR_DRIVE: return "speed_low_for_drive";
+    case DUTY_ASYMMETRY: return "duty_asymmetry";
+    case MISSING_EDGES: return "missing_edges";
+    case NOISY_EDGES: return "noisy_edges";
+    case EDGE_OVERFLOW: return "edge_overflow";
+    default: return "unknown";
+  }
+}
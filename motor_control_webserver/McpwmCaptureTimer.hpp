@@ -0,0 +1,71 @@
+#pragma once
+
+#include <driver/mcpwm_cap.h>
+#include <esp_log.h>
+#include <soc/soc_caps.h>
+
+/*
+  Shared MCPWM capture timers.
+
+  Every MCPWM group has a single free running capture timer feeding
+  SOC_MCPWM_CAPTURE_CHANNELS_PER_TIMER capture channels (3 per group, 6 on the ESP32).
+  Calculators using the MCPWM backend share the timer of a group and take its next free
+  channel, the timer is created and started by the first user of the group.
+  Only called from setup(), no locking.
+*/
+class McpwmCaptureTimer {
+private:
+  static mcpwm_cap_timer_handle_t timers[SOC_MCPWM_GROUPS];
+  static uint8_t channelsInUse[SOC_MCPWM_GROUPS];
+
+public:
+  // Reserves a channel and returns the timer to attach it to, nullptr when every channel is taken.
+  // resolutionHz is the capture tick rate of that timer.
+  static mcpwm_cap_timer_handle_t acquireChannel(uint32_t &resolutionHz);
+
+  // Gives back a channel reserved by acquireChannel() whose creation failed
+  static void releaseChannel(mcpwm_cap_timer_handle_t timer);
+};
+
+mcpwm_cap_timer_handle_t McpwmCaptureTimer::timers[SOC_MCPWM_GROUPS] = {};
+uint8_t McpwmCaptureTimer::channelsInUse[SOC_MCPWM_GROUPS] = {};
+
+mcpwm_cap_timer_handle_t McpwmCaptureTimer::acquireChannel(uint32_t &resolutionHz) {
+  const char *TAG = "McpwmCaptureTimer";
+
+  for (int group = 0; group < SOC_MCPWM_GROUPS; group++) {
+    if (channelsInUse[group] >= SOC_MCPWM_CAPTURE_CHANNELS_PER_TIMER) continue;
+
+    if (timers[group] == nullptr) {
+      mcpwm_capture_timer_config_t timerConfig = {};
+      timerConfig.group_id = group;
+      timerConfig.clk_src = MCPWM_CAPTURE_CLK_SRC_DEFAULT;
+
+      mcpwm_cap_timer_handle_t timer = nullptr;
+      esp_err_t err = mcpwm_new_capture_timer(&timerConfig, &timer);
+      if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Capture timer of group %d unavailable: %s", group, esp_err_to_name(err));
+        continue;
+      }
+      ESP_ERROR_CHECK(mcpwm_capture_timer_enable(timer));
+      ESP_ERROR_CHECK(mcpwm_capture_timer_start(timer));
+      timers[group] = timer;
+    }
+
+    ESP_ERROR_CHECK(mcpwm_capture_timer_get_resolution(timers[group], &resolutionHz));
+    channelsInUse[group]++;
+    return timers[group];
+  }
+
+  ESP_LOGW(TAG, "All MCPWM capture channels are in use");
+  return nullptr;
+}
+
+void McpwmCaptureTimer::releaseChannel(mcpwm_cap_timer_handle_t timer) {
+  for (int group = 0; group < SOC_MCPWM_GROUPS; group++) {
+    if (timers[group] == timer && channelsInUse[group] > 0) {
+      channelsInUse[group]--;
+      return;
+    }
+  }
+}
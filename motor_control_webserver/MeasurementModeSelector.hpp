@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+  Chooses between period measurement (timestamp every edge) and frequency measurement
+  (count edges over a gate time) from the current speed estimate.
+
+  - Above crossoverRpm * (1 + hysteresis) counting is precise enough and costs nothing per edge.
+  - Below crossoverRpm * (1 - hysteresis) the gate holds too few pulses, timing edges is better.
+  - A switch needs confirmSamples consecutive estimates beyond the threshold, so a single
+    outlier never toggles the mode.
+
+  Plain arithmetic without any ESP-IDF dependency, feed it simulated speeds on the host.
+*/
+class MeasurementModeSelector {
+public:
+  enum class Mode : uint8_t {
+    PERIOD,
+    FREQUENCY
+  };
+
+private:
+  float enterFrequencyRpm;
+  float leaveFrequencyRpm;
+  uint8_t confirmSamples;
+
+  Mode mode;
+  uint8_t pendingSamples;
+
+public:
+  MeasurementModeSelector(float crossoverRpm, float hysteresis, uint8_t confirmSamples);
+
+  // Returns the mode to use for the next measurement
+  inline Mode update(float rpm) __attribute__((always_inline));
+  inline void reset() __attribute__((always_inline));
+
+  inline Mode getMode() const { return mode; }
+  inline float getEnterFrequencyRpm() const { return enterFrequencyRpm; }
+  inline float getLeaveFrequencyRpm() const { return leaveFrequencyRpm; }
+};
+
+MeasurementModeSelector::MeasurementModeSelector(float crossoverRpm, float hysteresis, uint8_t confirmSamples) :
+enterFrequencyRpm(crossoverRpm * (1.0f + hysteresis)),
+leaveFrequencyRpm(crossoverRpm * (1.0f - hysteresis)),
+confirmSamples(confirmSamples > 0 ? confirmSamples : 1),
+mode(Mode::PERIOD),
+pendingSamples(0)
+{}
+
+MeasurementModeSelector::Mode MeasurementModeSelector::update(float rpm) {
+  const bool beyondThreshold = (mode == Mode::PERIOD) ? (rpm > enterFrequencyRpm) : (rpm < leaveFrequencyRpm);
+
+  if (!beyondThreshold) {
+    pendingSamples = 0;
+    return mode;
+  }
+
+  pendingSamples = pendingSamples + 1;
+  if (pendingSamples >= confirmSamples) {
+    mode = (mode == Mode::PERIOD) ? Mode::FREQUENCY : Mode::PERIOD;
+    pendingSamples = 0;
+  }
+
+  return mode;
+}
+
+void MeasurementModeSelector::reset() {
+  mode = Mode::PERIOD;
+  pendingSamples = 0;
+}
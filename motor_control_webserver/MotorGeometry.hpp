@@ -0,0 +1,45 @@
+#pragma once
+
+#include <driver/gpio.h>
+#include <cstdint>
+#include <ratio>
+
+/*
+  Compile-time description of a motor's speed feedback.
+
+  - PulsesPerRev : feedback pulses per mechanical revolution (magnet pole pairs for hub motors)
+  - WindowEdges  : number of edge periods averaged by the sliding speed window
+  - TimeUnit     : std::ratio unit of the stored periods (std::micro = microseconds)
+  - EdgeMode     : GPIO interrupt edge, GPIO_INTR_ANYEDGE counts two edges per pulse
+
+  Everything the speed formula needs is folded into constants here, so the hot path only
+  divides by the measured window sum and never by a configuration value.
+*/
+template <uint16_t PulsesPerRev, uint8_t WindowEdges, typename TimeUnit = std::micro, gpio_int_type_t EdgeMode = GPIO_INTR_ANYEDGE>
+struct MotorGeometry {
+  static_assert(PulsesPerRev > 0, "A motor needs at least one feedback pulse per revolution");
+  static_assert(WindowEdges > 0, "The speed window needs at least one period");
+  static_assert(EdgeMode == GPIO_INTR_POSEDGE || EdgeMode == GPIO_INTR_NEGEDGE || EdgeMode == GPIO_INTR_ANYEDGE,
+                "Speed feedback must be edge triggered");
+  static_assert(EdgeMode != GPIO_INTR_ANYEDGE || WindowEdges % 2 == 0,
+                "With both edges counted the window must hold whole pulses to cancel duty-cycle asymmetry");
+  // Captures are microseconds and the window sum is 32-bit, finer units would overflow it
+  static_assert(std::ratio_less_equal<TimeUnit, std::milli>::value && std::ratio_greater_equal<TimeUnit, std::micro>::value,
+                "Period unit must be between microseconds and milliseconds");
+
+  using Unit = TimeUnit;
+
+  static constexpr gpio_int_type_t EDGE_MODE = EdgeMode;
+  static constexpr uint8_t EDGES_PER_PULSE = (EdgeMode == GPIO_INTR_ANYEDGE) ? 2 : 1;
+  static constexpr uint32_t EDGES_PER_REVOLUTION = static_cast<uint32_t>(PulsesPerRev) * EDGES_PER_PULSE;
+  static constexpr uint8_t WINDOW_EDGES = WindowEdges;
+
+  // Period unit ticks in one minute
+  static constexpr uint64_t TICKS_PER_MINUTE = 60ULL * TimeUnit::den / TimeUnit::num;
+
+  // RPM = RPM_PER_EDGE * edgesInWindow / windowSumTicks
+  static constexpr float RPM_PER_EDGE = static_cast<float>(TICKS_PER_MINUTE) / EDGES_PER_REVOLUTION;
+
+  // Captured microseconds -> period unit, applied with a compile-time ratio
+  using FromMicros = std::ratio_divide<std::micro, TimeUnit>;
+};
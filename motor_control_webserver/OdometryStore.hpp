@@ -0,0 +1,215 @@
+#pragma once
+
+#include <nvs.h>
+#include <esp_system.h>
+#include <esp_log.h>
+#include <cstring>
+#include "esp_timer.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/*
+  Persists the odometry of every registered calculator to NVS.
+
+  Flash wear is bounded by batching instead of writing on every change:
+  - a motor is written once it moved SAVE_MIN_REVOLUTIONS since its last save, but never more
+    often than SAVE_MIN_INTERVAL_MS,
+  - any smaller change is written after SAVE_MAX_INTERVAL_MS,
+  - requestSave() (odometry reset) writes on the next wake-up of the task,
+  - flush() runs from the esp_restart() shutdown hook so a software restart loses nothing.
+  At most one write per motor per minute, a power cut loses at most the last batch.
+
+  All NVS writes happen in the store task or the shutdown hook.
+  Calculator must provide getOdometryEdges(), restoreOdometry() and EDGES_PER_REVOLUTION.
+*/
+template <typename Calculator, size_t MaxMotors>
+class OdometryStore {
+private:
+  static constexpr const char *NVS_NAMESPACE = "odometry";
+  static constexpr size_t KEY_LENGTH = 16;   // NVS keys are at most 15 characters
+
+  static constexpr uint32_t CHECK_INTERVAL_MS = 10000;
+  static constexpr uint32_t SAVE_MIN_INTERVAL_MS = 60000;
+  static constexpr uint32_t SAVE_MAX_INTERVAL_MS = 600000;
+  static constexpr uint64_t SAVE_MIN_REVOLUTIONS = 100;
+
+  Calculator *calculators[MaxMotors];
+  char keys[MaxMotors][KEY_LENGTH];
+  uint64_t savedEdges[MaxMotors];
+  uint32_t lastSaveMs[MaxMotors];
+  uint8_t motorCount;
+
+  nvs_handle_t nvsHandle;
+  bool opened;
+  TaskHandle_t storeTaskHandle;
+
+  // esp_register_shutdown_handler() takes a plain function
+  static OdometryStore *shutdownInstance;
+
+  void save(uint8_t index, uint32_t nowMs);
+  void saveDue(bool force);
+
+public:
+  OdometryStore();
+
+  // Registers a calculator under an NVS key before begin(), false when full
+  bool add(Calculator &calculator, const char *key);
+
+  // Restores the saved odometry into every calculator and starts the store task
+  void begin(TaskHandle_t &, const BaseType_t app_cpu = 1);
+
+  // Writes every changed counter now
+  void flush();
+
+  // Asks the store task to write changed counters on its next pass, used after a reset
+  void requestSave();
+
+  // FreeRTOS
+  static void odometryStoreTask(void *);
+  static void shutdownHandler();
+};
+
+template <typename Calculator, size_t MaxMotors>
+OdometryStore<Calculator, MaxMotors> *OdometryStore<Calculator, MaxMotors>::shutdownInstance = nullptr;
+
+template <typename Calculator, size_t MaxMotors>
+OdometryStore<Calculator, MaxMotors>::OdometryStore() :
+motorCount(0),
+nvsHandle(0),
+opened(false),
+storeTaskHandle(nullptr)
+{
+  memset(calculators, 0, sizeof(calculators));
+  memset(keys, 0, sizeof(keys));
+  memset(savedEdges, 0, sizeof(savedEdges));
+  memset(lastSaveMs, 0, sizeof(lastSaveMs));
+}
+
+template <typename Calculator, size_t MaxMotors>
+bool OdometryStore<Calculator, MaxMotors>::add(Calculator &calculator, const char *key) {
+  if (motorCount >= MaxMotors || key == nullptr || strlen(key) >= KEY_LENGTH) {
+    ESP_LOGE("OdometryStore", "Cannot register odometry key %s", key ? key : "(null)");
+    return false;
+  }
+
+  calculators[motorCount] = &calculator;
+  strncpy(keys[motorCount], key, KEY_LENGTH - 1);
+  motorCount++;
+  return true;
+}
+
+template <typename Calculator, size_t MaxMotors>
+void OdometryStore<Calculator, MaxMotors>::begin(TaskHandle_t &taskHandle, const BaseType_t app_cpu) {
+  const char *TAG = "OdometryStore::begin";
+
+  esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvsHandle);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to open NVS namespace %s: %s", NVS_NAMESPACE, esp_err_to_name(err));
+    return;
+  }
+  opened = true;
+
+  const uint32_t nowMs = static_cast<uint32_t>(esp_timer_get_time() / 1000);
+  for (uint8_t i = 0; i < motorCount; i++) {
+    uint64_t edges = 0;
+    err = nvs_get_u64(nvsHandle, keys[i], &edges);
+    if (err == ESP_OK) {
+      calculators[i]->restoreOdometry(edges);
+      ESP_LOGI(TAG, "Restored %s: %llu edges", keys[i], static_cast<unsigned long long>(edges));
+    } else if (err != ESP_ERR_NVS_NOT_FOUND) {
+      ESP_LOGW(TAG, "Failed to read %s: %s", keys[i], esp_err_to_name(err));
+    }
+    savedEdges[i] = edges;
+    lastSaveMs[i] = nowMs;
+  }
+
+  if (taskHandle == nullptr) {
+    BaseType_t result = xTaskCreatePinnedToCore(
+      &odometryStoreTask,
+      "odometryStoreTask",
+      3072,
+      this,
+      1,
+      &taskHandle,
+      app_cpu
+    );
+
+    if (result == pdPASS) {
+      ESP_LOGI(TAG, "Created the odometryStoreTask successfully");
+    } else {
+      ESP_LOGE(TAG, "Failed to create the odometryStoreTask task");
+    }
+  }
+  storeTaskHandle = taskHandle;
+
+  shutdownInstance = this;
+  esp_register_shutdown_handler(&shutdownHandler);
+}
+
+template <typename Calculator, size_t MaxMotors>
+void OdometryStore<Calculator, MaxMotors>::save(uint8_t index, uint32_t nowMs) {
+  const uint64_t edges = calculators[index]->getOdometryEdges();
+
+  esp_err_t err = nvs_set_u64(nvsHandle, keys[index], edges);
+  if (err == ESP_OK) {
+    err = nvs_commit(nvsHandle);
+  }
+  if (err != ESP_OK) {
+    ESP_LOGE("OdometryStore", "Failed to save %s: %s", keys[index], esp_err_to_name(err));
+    return;
+  }
+
+  savedEdges[index] = edges;
+  lastSaveMs[index] = nowMs;
+}
+
+template <typename Calculator, size_t MaxMotors>
+void OdometryStore<Calculator, MaxMotors>::saveDue(bool force) {
+  if (!opened) return;
+
+  const uint32_t nowMs = static_cast<uint32_t>(esp_timer_get_time() / 1000);
+  for (uint8_t i = 0; i < motorCount; i++) {
+    const uint64_t edges = calculators[i]->getOdometryEdges();
+    if (edges == savedEdges[i]) continue;
+
+    const uint32_t sinceSaveMs = nowMs - lastSaveMs[i];
+    const uint64_t movedEdges = (edges > savedEdges[i]) ? edges - savedEdges[i] : 0;
+    const bool wasReset = edges < savedEdges[i];
+    const bool movedFar = movedEdges >= SAVE_MIN_REVOLUTIONS * Calculator::EDGES_PER_REVOLUTION;
+
+    if (force || wasReset ||
+        (movedFar && sinceSaveMs >= SAVE_MIN_INTERVAL_MS) ||
+        sinceSaveMs >= SAVE_MAX_INTERVAL_MS) {
+      save(i, nowMs);
+    }
+  }
+}
+
+template <typename Calculator, size_t MaxMotors>
+void OdometryStore<Calculator, MaxMotors>::flush() {
+  saveDue(true);
+}
+
+template <typename Calculator, size_t MaxMotors>
+void OdometryStore<Calculator, MaxMotors>::requestSave() {
+  if (storeTaskHandle != nullptr) {
+    xTaskNotifyGive(storeTaskHandle);
+  }
+}
+
+template <typename Calculator, size_t MaxMotors>
+void OdometryStore<Calculator, MaxMotors>::odometryStoreTask(void *pvParameters) {
+  OdometryStore *store = static_cast<OdometryStore*>(pvParameters);
+  while (1) {
+    // A notification means a reset happened, saveDue() writes counters that went backwards
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CHECK_INTERVAL_MS));
+    store->saveDue(false);
+  }
+}
+
+template <typename Calculator, size_t MaxMotors>
+void OdometryStore<Calculator, MaxMotors>::shutdownHandler() {
+  if (shutdownInstance != nullptr) {
+    shutdownInstance->flush();
+  }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/*
+  Sliding window over the last N edge periods.
+
+  - push() replaces the oldest period and keeps a running sum, so every edge costs O(1)
+    no matter how long the window is.
+  - Only used from task context, no synchronization needed.
+*/
+template <size_t N>
+class PeriodWindow {
+private:
+  static_assert(N > 0 && N <= 255, "Window length must fit the uint8_t index");
+
+  uint32_t periods[N];
+  uint32_t sum;
+  uint8_t index;
+  uint8_t count;
+
+public:
+  PeriodWindow();
+
+  inline void push(uint32_t period) __attribute__((always_inline));
+  inline void reset() __attribute__((always_inline));
+
+  inline uint32_t getSum() const { return sum; }
+  inline uint8_t getCount() const { return count; }
+  inline bool isFull() const { return count == N; }
+  static constexpr size_t length() { return N; }
+};
+
+template <size_t N>
+PeriodWindow<N>::PeriodWindow() {
+  reset();
+}
+
+template <size_t N>
+void PeriodWindow<N>::push(uint32_t period) {
+  if (count == N) {
+    sum -= periods[index];
+  } else {
+    count = count + 1;
+  }
+
+  periods[index] = period;
+  sum += period;
+  index = (index + 1 == N) ? 0 : index + 1;
+}
+
+template <size_t N>
+void PeriodWindow<N>::reset() {
+  memset(periods, 0, sizeof(periods));
+  sum = 0;
+  index = 0;
+  count = 0;
+}
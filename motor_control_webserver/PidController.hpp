@@ -0,0 +1,128 @@
+#pragma once
+
+/*
+  Discrete PID at a fixed sample time, generic over the number type (float or FixedPoint).
+
+  - Derivative on measurement: a setpoint step does not kick the output, only a change of
+    the measured value does.
+  - Anti-windup by conditional integration: while the output is saturated the integrator
+    does not move further into the saturation, and it is clamped to the output range.
+  - Output clamped to [outputMin, outputMax].
+  - Optional feedforward added to the output, the model's guess of the output for the
+    setpoint. The integrator then only carries the model error and is clamped so that
+    feedforward plus integrator stays within the output range.
+  - ki and kd are per second, scaled by the sample time once in setGains(), update() only
+    multiplies and adds.
+  - reset() makes the next update() continue smoothly from a given output (bumpless switch
+    from open loop).
+
+  Plain arithmetic without any ESP-IDF dependency, run it against a simulated plant on the host.
+*/
+template <typename T>
+class PidController {
+public:
+  struct Gains {
+    T kp;
+    T ki;     // 1/s
+    T kd;     // s
+  };
+
+private:
+  T sampleSeconds;
+  Gains gains;
+  T integralGain;        // ki * sample time
+  T derivativeGain;      // kd / sample time
+  T outputMin;
+  T outputMax;
+
+  T integral;
+  T previousMeasurement;
+  bool hasPrevious;
+  T output;
+
+  static inline T clamp(T value, T low, T high) {
+    return value < low ? low : (value > high ? high : value);
+  }
+
+public:
+  explicit PidController(T sampleSeconds = T(1));
+
+  void setGains(T kp, T ki, T kd);
+  inline const Gains &getGains() const { return gains; }
+
+  void setOutputLimits(T minimum, T maximum);
+
+  // Next update() starts at output with no derivative history, feedforward is the model's
+  // share of that output
+  void reset(T output, T feedforward = T(0));
+
+  T update(T setpoint, T measurement, T feedforward = T(0));
+
+  inline T getOutput() const { return output; }
+  inline T getIntegral() const { return integral; }
+};
+
+template <typename T>
+PidController<T>::PidController(T sampleSeconds) :
+sampleSeconds(sampleSeconds),
+gains{T(0), T(0), T(0)},
+integralGain(T(0)),
+derivativeGain(T(0)),
+outputMin(T(0)),
+outputMax(T(1)),
+integral(T(0)),
+previousMeasurement(T(0)),
+hasPrevious(false),
+output(T(0))
+{}
+
+template <typename T>
+void PidController<T>::setGains(T kp, T ki, T kd) {
+  gains.kp = kp;
+  gains.ki = ki;
+  gains.kd = kd;
+  integralGain = ki * sampleSeconds;
+  derivativeGain = kd / sampleSeconds;
+}
+
+template <typename T>
+void PidController<T>::setOutputLimits(T minimum, T maximum) {
+  if (maximum < minimum) return;
+  outputMin = minimum;
+  outputMax = maximum;
+  // The feedforward is not known here, update() tightens this to the range left beside it
+  integral = clamp(integral, outputMin - outputMax, outputMax - outputMin);
+  output = clamp(output, outputMin, outputMax);
+}
+
+template <typename T>
+void PidController<T>::reset(T output, T feedforward) {
+  this->output = clamp(output, outputMin, outputMax);
+  integral = this->output - feedforward;
+  hasPrevious = false;
+}
+
+template <typename T>
+T PidController<T>::update(T setpoint, T measurement, T feedforward) {
+  const T error = setpoint - measurement;
+  const T proportional = gains.kp * error;
+
+  T derivative = T(0);
+  if (hasPrevious) {
+    derivative = -(derivativeGain * (measurement - previousMeasurement));
+  }
+  previousMeasurement = measurement;
+  hasPrevious = true;
+
+  // Integrate only while that does not push further into a saturated output
+  const T candidate = integral + integralGain * error;
+  const T unclamped = feedforward + proportional + candidate + derivative;
+  const bool windingUp = (unclamped > outputMax && error > T(0)) ||
+                         (unclamped < outputMin && error < T(0));
+  if (!windingUp) {
+    integral = clamp(candidate, outputMin - feedforward, outputMax - feedforward);
+  }
+
+  output = clamp(feedforward + proportional + integral + derivative, outputMin, outputMax);
+  return output;
+}
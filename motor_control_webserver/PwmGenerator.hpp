@@ -1,60 +1,202 @@
 #pragma once
 
 #include "driver/ledc.h"
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
+#include "soc/soc_caps.h"
+#include "LedcAllocator.hpp"
 #include "esp_log.h"
+#include <atomic>
+#include <cmath>
+
+/*
+  LEDC PWM output for one motor.
+
+  - No task polls the channel: setPwm() commits a new duty right away with one
+    ledc_set_duty() + ledc_update_duty(), the hardware latches it at the next PWM period.
+  - An unchanged duty is not committed. getCommitCount() counts the commits.
+  - rampTo()/slewTo() hand a ramp to the LEDC fade engine, the hardware steps the duty with
+    no CPU involved. The fade end interrupt calls the ramp done callback (ISR context).
+  - setPwm() during a ramp stops the fade first, so an immediate duty (emergency stop) wins.
+  - Resolution: AUTO_RESOLUTION takes the most duty bits the LEDC clock divides down to the
+    requested frequency (9 bits at 100 kHz), an explicit resolution is capped at that.
+    setDuty() takes a normalized float, setDutyQ16() a fixed-point duty (65536 = 100%), both
+    at full resolution. The 0-255 API maps onto the top 8 bits, 255 stays 255/256.
+  - Timer and channel come from LedcAllocator, generators with the same frequency and
+    resolution share a timer. The timer-sharing constructor asks for that explicitly,
+    PwmGroup commits such channels together. Without a free channel the output stays off.
+*/
+
+template <size_t MaxChannels> class PwmGroup;
 
 class PwmGenerator {
+  public:
+  // Called from the LEDC fade interrupt with the duty the ramp ended at, keep it short
+  using RampDoneCallback = void (*)(uint8_t duty, void *arg);
+
+  // Resolution argument asking for the highest one the frequency allows
+  static constexpr ledc_timer_bit_t AUTO_RESOLUTION = LEDC_TIMER_BIT_MAX;
+
+  // APB clock, what LEDC_AUTO_CLK runs the timers from
+  static constexpr uint32_t SOURCE_CLOCK_HZ = 80000000;
+  static constexpr uint8_t MAX_RESOLUTION_BITS = SOC_LEDC_TIMER_BIT_WIDTH;
+
   private:
   gpio_num_t pwmPin;
   uint32_t frequency;
   ledc_timer_bit_t resolution;
+  ledc_mode_t speedMode;
   ledc_timer_t timer;
   ledc_channel_t channel;
-  uint8_t dutyCycle;
-  static uint8_t timerCounter;
-  static uint8_t channelCounter;
+  uint32_t dutyCycle;                 // In counts of the timer resolution, 1 << resolution is 100%
+  std::atomic<uint32_t> commitCount;
+  std::atomic<bool> ramping;
+  std::atomic<uint32_t> rampCount;
+  RampDoneCallback rampDoneCallback;
+  void *rampDoneArg;
+  static bool fadeInstalled;
+
+  template <size_t MaxChannels> friend class PwmGroup;
 
   public:
-  PwmGenerator(gpio_num_t=GPIO_NUM_NC, uint32_t=100000, ledc_timer_bit_t=LEDC_TIMER_8_BIT);
-  void begin(TaskHandle_t &, const BaseType_t app_cpu = 1);
-  inline void updatePWM();
+  PwmGenerator(gpio_num_t=GPIO_NUM_NC, uint32_t=100000, ledc_timer_bit_t=AUTO_RESOLUTION);
+  // A channel on timerOwner's timer, constructed after it
+  PwmGenerator(gpio_num_t, const PwmGenerator &timerOwner);
+  void begin();
   
   inline uint8_t getPwm();
   inline void setPwm(uint8_t pwmValue);
 
-  // freeRTOS task
-  static void pwmTask(void* pvParameters);
+  // Full resolution duty, clamped to [0, 1]
+  inline void setDuty(float duty);
+  inline float getDuty() const;
+  inline void setDutyQ16(uint32_t duty);
+
+  // Most duty bits the LEDC clock allows at frequency, 0 when the frequency is out of reach
+  static constexpr uint8_t maxResolutionBits(uint32_t frequency);
+
+  inline uint8_t getResolutionBits() const { return static_cast<uint8_t>(resolution); }
+  // Frequency the timer actually runs at, the divider is not always exact
+  inline uint32_t getFrequency() const;
+
+  // Ramps linearly from the present output to pwmValue in rampMs, 0 is an immediate setPwm()
+  bool rampTo(uint8_t pwmValue, uint32_t rampMs);
+  // Same, with the ramp time following from a maximum slope in duty steps per second
+  bool slewTo(uint8_t pwmValue, uint32_t dutyPerSecond);
+
+  // Duty on the pin right now, differs from getPwm() (the target) while ramping
+  inline uint8_t getOutputDuty() const;
+  inline bool isRamping() const { return ramping.load(std::memory_order_relaxed); }
+  inline uint32_t getRampCount() const { return rampCount.load(std::memory_order_relaxed); }
+
+  // Set before the first ramp, arg is passed through
+  void setRampDoneCallback(RampDoneCallback callback, void *arg);
+
+  // Number of duty commits to the LEDC since boot, unchanged values are not committed
+  inline uint32_t getCommitCount() const { return commitCount.load(std::memory_order_relaxed); }
+
+  private:
+  void attach(esp_err_t allocated, const LedcAllocator::Channel &allocation);
+
+  inline void commitDuty();
+  inline void commitCounts(uint32_t counts);
+  inline void stopRamp();
+
+  // Split commit for PwmGroup: stage writes the duty register, latch applies it at the
+  // next period. stageCounts() is false when counts is already the output, force stages it
+  // anyway (a stopped fade left the output short of dutyCycle).
+  inline bool stageCounts(uint32_t counts, bool force = false);
+  inline void latchDuty();
+  bool startFade(uint32_t counts, uint32_t rampMs);
+
+  inline uint32_t toCounts(uint8_t pwmValue) const;
+  inline uint32_t dutyToCounts(float duty) const;
+  inline uint8_t fromCounts(uint32_t counts) const;
+
+  // LEDC fade end interrupt
+  static bool fadeEndCallback(const ledc_cb_param_t *param, void *userArg);
 };
 
-uint8_t PwmGenerator::timerCounter = 0;
-uint8_t PwmGenerator::channelCounter = 0;
+bool PwmGenerator::fadeInstalled = false;
 
 PwmGenerator::PwmGenerator(gpio_num_t pwmPin, uint32_t frequency, ledc_timer_bit_t resolution) :
 pwmPin(pwmPin),
 frequency(frequency),
 resolution(resolution),
-dutyCycle(0)
+speedMode(LEDC_HIGH_SPEED_MODE),
+timer(LEDC_TIMER_0),
+channel(LEDC_CHANNEL_0),
+dutyCycle(0),
+commitCount(0),
+ramping(false),
+rampCount(0),
+rampDoneCallback(nullptr),
+rampDoneArg(nullptr)
 {
-  // Auto-assign timer and channel to avoid conflicts
-  timer = static_cast<ledc_timer_t>(timerCounter++);
-  channel = static_cast<ledc_channel_t>(channelCounter++);
+  const uint8_t maxBits = maxResolutionBits(frequency);
+  if (resolution == AUTO_RESOLUTION || resolution > maxBits) {
+    if (resolution != AUTO_RESOLUTION) {
+      ESP_LOGW("PwmGenerator", "%d-bit duty not possible at %u Hz, using %d bits", resolution, static_cast<unsigned>(frequency), maxBits);
+    }
+    this->resolution = static_cast<ledc_timer_bit_t>(maxBits);
+  }
 
   if (pwmPin == GPIO_NUM_NC) return; // Skip initialization if pin not configured
 
-  ledc_timer_config_t ledc_timer = {
-    .speed_mode = LEDC_HIGH_SPEED_MODE,
-    .duty_resolution = resolution,
-    .timer_num = timer,
-    .freq_hz = frequency,
-    .clk_cfg = LEDC_AUTO_CLK
-  };
-  ESP_ERROR_CHECK(ledc_timer_config(&ledc_timer));
+  if (maxBits == 0) {
+    ESP_LOGE("PwmGenerator", "PWM frequency %u Hz is above the LEDC clock", static_cast<unsigned>(frequency));
+    this->pwmPin = GPIO_NUM_NC;
+    return;
+  }
+
+  LedcAllocator::Channel allocation;
+  attach(LedcAllocator::allocate(frequency, this->resolution, allocation), allocation);
+}
+
+PwmGenerator::PwmGenerator(gpio_num_t pwmPin, const PwmGenerator &timerOwner) :
+pwmPin(pwmPin),
+frequency(timerOwner.frequency),
+resolution(timerOwner.resolution),
+speedMode(LEDC_HIGH_SPEED_MODE),
+timer(LEDC_TIMER_0),
+channel(LEDC_CHANNEL_0),
+dutyCycle(0),
+commitCount(0),
+ramping(false),
+rampCount(0),
+rampDoneCallback(nullptr),
+rampDoneArg(nullptr)
+{
+  if (pwmPin == GPIO_NUM_NC) return; // Skip initialization if pin not configured
+
+  if (resolution == 0) {
+    ESP_LOGE("PwmGenerator", "PWM frequency %u Hz is above the LEDC clock", static_cast<unsigned>(frequency));
+    this->pwmPin = GPIO_NUM_NC;
+    return;
+  }
+
+  // An unconfigured owner holds no timer to share
+  LedcAllocator::Channel allocation;
+  if (timerOwner.pwmPin == GPIO_NUM_NC) {
+    attach(LedcAllocator::allocate(frequency, resolution, allocation), allocation);
+  } else {
+    const LedcAllocator::Channel sibling = { timerOwner.speedMode, timerOwner.timer, timerOwner.channel };
+    attach(LedcAllocator::allocateOnTimer(sibling, allocation), allocation);
+  }
+}
+
+void PwmGenerator::attach(esp_err_t allocated, const LedcAllocator::Channel &allocation) {
+  if (allocated != ESP_OK) {
+    ESP_LOGE("PwmGenerator", "No LEDC channel for GPIO %d, PWM output disabled", pwmPin);
+    pwmPin = GPIO_NUM_NC;
+    return;
+  }
+
+  speedMode = allocation.mode;
+  timer = allocation.timer;
+  channel = allocation.channel;
 
   ledc_channel_config_t ledc_channel = {
     .gpio_num = pwmPin,
-    .speed_mode = LEDC_HIGH_SPEED_MODE,
+    .speed_mode = speedMode,
     .channel = channel,
     .intr_type = LEDC_INTR_DISABLE,
     .timer_sel = timer,
@@ -67,46 +209,168 @@ dutyCycle(0)
   ESP_ERROR_CHECK(ledc_channel_config(&ledc_channel));
 }
 
-void PwmGenerator::begin(TaskHandle_t &taskHandle, const BaseType_t app_cpu) {
+void PwmGenerator::begin() {
   if (pwmPin == GPIO_NUM_NC) return; // Skip if pin not configured
 
-  if (taskHandle == nullptr) {
-    BaseType_t result = xTaskCreatePinnedToCore(
-      &pwmTask,
-      "pwmTask",
-      configMINIMAL_STACK_SIZE,
-      this,
-      1,
-      &taskHandle,
-      app_cpu
-    );
-
-    if (result != pdPASS) {
-      ESP_LOGE("PwmGenerator::begin", "Failed to create PWM task");
+  // Known output from the start, whatever the channel held before
+  commitDuty();
+
+  // One fade service for all channels
+  if (!fadeInstalled) {
+    esp_err_t err = ledc_fade_func_install(0);
+    if (err != ESP_OK) {
+      ESP_LOGE("PwmGenerator::begin", "Failed to install the LEDC fade service: %s", esp_err_to_name(err));
+      return;
     }
+    fadeInstalled = true;
   }
+
+  ledc_cbs_t callbacks = {
+    .fade_cb = &fadeEndCallback
+  };
+  ESP_ERROR_CHECK(ledc_cb_register(speedMode, channel, &callbacks, this));
 }
 
-void PwmGenerator::updatePWM() {
-  if (pwmPin == GPIO_NUM_NC) return;
-  ledc_update_duty(LEDC_HIGH_SPEED_MODE, channel);
+void PwmGenerator::setRampDoneCallback(RampDoneCallback callback, void *arg) {
+  rampDoneArg = arg;
+  rampDoneCallback = callback;
+}
+
+constexpr uint8_t PwmGenerator::maxResolutionBits(uint32_t frequency) {
+  // The timer divider must stay >= 1: frequency << bits <= source clock
+  uint8_t bits = 0;
+  while (bits < MAX_RESOLUTION_BITS && (static_cast<uint64_t>(frequency) << (bits + 1)) <= SOURCE_CLOCK_HZ) {
+    bits++;
+  }
+  return frequency == 0 ? 0 : bits;
+}
+
+uint32_t PwmGenerator::toCounts(uint8_t pwmValue) const {
+  return resolution >= 8 ? static_cast<uint32_t>(pwmValue) << (resolution - 8) : pwmValue >> (8 - resolution);
+}
+
+uint8_t PwmGenerator::fromCounts(uint32_t counts) const {
+  const uint32_t value = resolution >= 8 ? counts >> (resolution - 8) : counts << (8 - resolution);
+  return value > 255 ? 255 : static_cast<uint8_t>(value);
+}
+
+uint32_t PwmGenerator::getFrequency() const {
+  if (pwmPin == GPIO_NUM_NC) return frequency;
+  return ledc_get_freq(speedMode, timer);
+}
+
+void PwmGenerator::commitDuty() {
+  ledc_set_duty(speedMode, channel, dutyCycle);
+  ledc_update_duty(speedMode, channel);
+  commitCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PwmGenerator::stopRamp() {
+  if (!ramping.load(std::memory_order_relaxed)) return;
+  ledc_fade_stop(speedMode, channel);
+  ramping.store(false, std::memory_order_relaxed);
 }
 
 uint8_t PwmGenerator::getPwm() {
-    return dutyCycle;
+    return fromCounts(dutyCycle);
+}
+
+uint8_t PwmGenerator::getOutputDuty() const {
+  if (pwmPin == GPIO_NUM_NC) return fromCounts(dutyCycle);
+  return fromCounts(ledc_get_duty(speedMode, channel));
+}
+
+void PwmGenerator::commitCounts(uint32_t counts) {
+  if (stageCounts(counts)) {
+    latchDuty();
+  }
+}
+
+bool PwmGenerator::stageCounts(uint32_t counts, bool force) {
+  if (pwmPin == GPIO_NUM_NC) return false;
+  if (counts == dutyCycle && !force && !isRamping()) return false;
+
+  stopRamp();
+  dutyCycle = counts;
+  ledc_set_duty(speedMode, channel, dutyCycle);
+  return true;
+}
+
+void PwmGenerator::latchDuty() {
+  ledc_update_duty(speedMode, channel);
+  commitCount.fetch_add(1, std::memory_order_relaxed);
 }
 
 void PwmGenerator::setPwm(uint8_t pwmValue) {
-  if (pwmPin == GPIO_NUM_NC) return;
-  dutyCycle = pwmValue;
-  ledc_set_duty(LEDC_HIGH_SPEED_MODE, channel, dutyCycle);
-  updatePWM();
+  commitCounts(toCounts(pwmValue));
 }
 
-void PwmGenerator::pwmTask(void* pvParameters) {
-  PwmGenerator* instance = static_cast<PwmGenerator*>(pvParameters);
-  while (true) {
-    instance->updatePWM();
-    vTaskDelay(pdMS_TO_TICKS(10));
+uint32_t PwmGenerator::dutyToCounts(float duty) const {
+  if (!(duty > 0.0f)) duty = 0.0f;   // NaN included
+  if (duty > 1.0f) duty = 1.0f;
+  return static_cast<uint32_t>(lroundf(duty * (1UL << resolution)));
+}
+
+void PwmGenerator::setDuty(float duty) {
+  commitCounts(dutyToCounts(duty));
+}
+
+float PwmGenerator::getDuty() const {
+  return static_cast<float>(dutyCycle) / (1UL << resolution);
+}
+
+void PwmGenerator::setDutyQ16(uint32_t duty) {
+  if (duty > 65536) duty = 65536;
+  commitCounts(static_cast<uint32_t>((static_cast<uint64_t>(duty) << resolution) + 32768) >> 16);
+}
+
+bool PwmGenerator::rampTo(uint8_t pwmValue, uint32_t rampMs) {
+  if (pwmPin == GPIO_NUM_NC) return false;
+  const uint32_t counts = toCounts(pwmValue);
+  if (!fadeInstalled || rampMs == 0 || counts == ledc_get_duty(speedMode, channel)) {
+    setPwm(pwmValue);
+    return true;
+  }
+
+  // A new ramp starts from wherever the running one got to
+  stopRamp();
+  return startFade(counts, rampMs);
+}
+
+bool PwmGenerator::startFade(uint32_t counts, uint32_t rampMs) {
+  dutyCycle = counts;
+  ramping.store(true, std::memory_order_relaxed);
+
+  esp_err_t err = ledc_set_fade_time_and_start(speedMode, channel, counts, rampMs, LEDC_FADE_NO_WAIT);
+  if (err != ESP_OK) {
+    ESP_LOGW("PwmGenerator", "Fade failed (%s), setting the duty directly", esp_err_to_name(err));
+    ramping.store(false, std::memory_order_relaxed);
+    commitDuty();
+    return false;
+  }
+  commitCount.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+bool PwmGenerator::slewTo(uint8_t pwmValue, uint32_t dutyPerSecond) {
+  if (dutyPerSecond == 0) {
+    setPwm(pwmValue);
+    return true;
+  }
+
+  const uint8_t output = getOutputDuty();
+  const uint32_t steps = (pwmValue > output) ? pwmValue - output : output - pwmValue;
+  return rampTo(pwmValue, (steps * 1000 + dutyPerSecond - 1) / dutyPerSecond);
+}
+
+bool PwmGenerator::fadeEndCallback(const ledc_cb_param_t *param, void *userArg) {
+  PwmGenerator *instance = static_cast<PwmGenerator*>(userArg);
+  if (param->event != LEDC_FADE_END_EVT) return false;
+
+  instance->ramping.store(false, std::memory_order_relaxed);
+  instance->rampCount.fetch_add(1, std::memory_order_relaxed);
+  if (instance->rampDoneCallback != nullptr) {
+    instance->rampDoneCallback(instance->fromCounts(param->duty), instance->rampDoneArg);
   }
+  return false;
 }
\ No newline at end of file
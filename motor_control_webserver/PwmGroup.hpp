@@ -0,0 +1,220 @@
+#pragma once
+
+#include "PwmGenerator.hpp"
+#include "esp_log.h"
+#include <atomic>
+#include <cstring>
+
+/*
+  Commits new duties to several PwmGenerator channels on one LEDC timer as one operation.
+
+  - The channels share the timer counter (hpoint 0), their periods are phase aligned.
+  - A commit stops running ramps, stages every channel first and then latches them back to
+    back with ledc_update_duty(). Each channel takes its new duty at the first timer
+    overflow after its own latch, and the timer never stops: no period is stretched or
+    skipped, and every channel switches cleanly at a period boundary.
+  - The latches are not atomic. Each ledc_update_duty() takes the driver spinlock, so the
+    two are a few microseconds apart with the timer running. At 100 kHz (10 us period) an
+    overflow can fall between them, so a channel may switch one period after the other.
+    The skew is at most one PWM period per commit.
+  - Ramps start the same way, one fade after the other, so the same skew applies to their
+    start. With equal fade times the channels arrive within a period of each other.
+  - Channels on different timers are still committed, one after the other, but
+    isSynchronized() is false.
+
+  Commit from one task only, the stage/latch sequence is not locked.
+*/
+template <size_t MaxChannels>
+class PwmGroup {
+private:
+  PwmGenerator *generators[MaxChannels];
+  uint8_t channelCount;
+  bool synchronized;
+  std::atomic<uint32_t> commitCount;
+
+  void commit(const uint32_t *counts);
+  bool startFades(const uint32_t *counts, uint32_t rampMs);
+
+public:
+  PwmGroup();
+
+  // Adds a channel before begin(), false when full
+  bool add(PwmGenerator &generator);
+
+  // Checks that the channels share one timer
+  void begin();
+
+  // Same duty on every channel
+  void setPwm(uint8_t pwmValue);
+  // One value per channel, in add() order
+  void setPwms(const uint8_t *pwmValues);
+  void setDuties(const float *duties);
+
+  // Phase aligned ramps of every channel, see PwmGenerator::rampTo()/slewTo()
+  bool rampTo(uint8_t pwmValue, uint32_t rampMs);
+  bool slewTo(uint8_t pwmValue, uint32_t dutyPerSecond);
+
+  inline bool isSynchronized() const { return synchronized; }
+  inline uint8_t getChannelCount() const { return channelCount; }
+  inline float getDuty(uint8_t index) const { return generators[index]->getDuty(); }
+
+  // Group commits since boot, each one latches every changed channel back to back (at most
+  // one PWM period apart)
+  inline uint32_t getCommitCount() const { return commitCount.load(std::memory_order_relaxed); }
+};
+
+template <size_t MaxChannels>
+PwmGroup<MaxChannels>::PwmGroup() :
+channelCount(0),
+synchronized(false),
+commitCount(0)
+{
+  memset(generators, 0, sizeof(generators));
+}
+
+template <size_t MaxChannels>
+bool PwmGroup<MaxChannels>::add(PwmGenerator &generator) {
+  if (channelCount >= MaxChannels) {
+    ESP_LOGE("PwmGroup", "Cannot add more than %d channels", static_cast<int>(MaxChannels));
+    return false;
+  }
+
+  generators[channelCount++] = &generator;
+  return true;
+}
+
+template <size_t MaxChannels>
+void PwmGroup<MaxChannels>::begin() {
+  const char *TAG = "PwmGroup::begin";
+
+  synchronized = channelCount > 0;
+  for (uint8_t i = 0; i < channelCount; i++) {
+    if (generators[i]->pwmPin == GPIO_NUM_NC ||
+        generators[i]->speedMode != generators[0]->speedMode ||
+        generators[i]->timer != generators[0]->timer) {
+      synchronized = false;
+    }
+  }
+
+  if (synchronized) {
+    ESP_LOGI(TAG, "%d channels phase aligned on LEDC timer %d", channelCount, generators[0]->timer);
+  } else {
+    ESP_LOGW(TAG, "Channels do not share one timer, duties are committed one after the other");
+  }
+}
+
+template <size_t MaxChannels>
+void PwmGroup<MaxChannels>::commit(const uint32_t *counts) {
+  bool changed = false;
+  for (uint8_t i = 0; i < channelCount; i++) {
+    if (counts[i] != generators[i]->dutyCycle || generators[i]->isRamping()) {
+      changed = true;
+    }
+  }
+  if (!changed) return;
+
+  // Stopping a fade waits for its end interrupt, which needs the timer running. A stopped
+  // fade leaves the output part-way while dutyCycle already holds its target, so those
+  // channels are staged even when counts equals that target.
+  bool wasRamping[MaxChannels];
+  for (uint8_t i = 0; i < channelCount; i++) {
+    wasRamping[i] = generators[i]->isRamping();
+    generators[i]->stopRamp();
+  }
+
+  bool staged[MaxChannels];
+  for (uint8_t i = 0; i < channelCount; i++) {
+    staged[i] = generators[i]->stageCounts(counts[i], wasRamping[i]);
+  }
+  for (uint8_t i = 0; i < channelCount; i++) {
+    if (staged[i]) {
+      generators[i]->latchDuty();
+    }
+  }
+  commitCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+template <size_t MaxChannels>
+void PwmGroup<MaxChannels>::setPwm(uint8_t pwmValue) {
+  uint32_t counts[MaxChannels];
+  for (uint8_t i = 0; i < channelCount; i++) {
+    counts[i] = generators[i]->toCounts(pwmValue);
+  }
+  commit(counts);
+}
+
+template <size_t MaxChannels>
+void PwmGroup<MaxChannels>::setPwms(const uint8_t *pwmValues) {
+  uint32_t counts[MaxChannels];
+  for (uint8_t i = 0; i < channelCount; i++) {
+    counts[i] = generators[i]->toCounts(pwmValues[i]);
+  }
+  commit(counts);
+}
+
+template <size_t MaxChannels>
+void PwmGroup<MaxChannels>::setDuties(const float *duties) {
+  uint32_t counts[MaxChannels];
+  for (uint8_t i = 0; i < channelCount; i++) {
+    counts[i] = generators[i]->dutyToCounts(duties[i]);
+  }
+  commit(counts);
+}
+
+template <size_t MaxChannels>
+bool PwmGroup<MaxChannels>::startFades(const uint32_t *counts, uint32_t rampMs) {
+  for (uint8_t i = 0; i < channelCount; i++) {
+    generators[i]->stopRamp();
+  }
+
+  bool started = true;
+  for (uint8_t i = 0; i < channelCount; i++) {
+    PwmGenerator *generator = generators[i];
+    if (generator->pwmPin == GPIO_NUM_NC) continue;
+
+    if (counts[i] == ledc_get_duty(generator->speedMode, generator->channel)) {
+      // Already there, only the target needs to agree
+      if (generator->stageCounts(counts[i])) {
+        generator->latchDuty();
+      }
+    } else if (!generator->startFade(counts[i], rampMs)) {
+      started = false;
+    }
+  }
+  commitCount.fetch_add(1, std::memory_order_relaxed);
+  return started;
+}
+
+template <size_t MaxChannels>
+bool PwmGroup<MaxChannels>::rampTo(uint8_t pwmValue, uint32_t rampMs) {
+  uint32_t counts[MaxChannels];
+  for (uint8_t i = 0; i < channelCount; i++) {
+    counts[i] = generators[i]->toCounts(pwmValue);
+  }
+
+  if (!PwmGenerator::fadeInstalled || rampMs == 0) {
+    commit(counts);
+    return true;
+  }
+  return startFades(counts, rampMs);
+}
+
+template <size_t MaxChannels>
+bool PwmGroup<MaxChannels>::slewTo(uint8_t pwmValue, uint32_t dutyPerSecond) {
+  if (dutyPerSecond == 0) {
+    setPwm(pwmValue);
+    return true;
+  }
+
+  // The channel furthest away sets the time, every channel arrives together
+  uint32_t steps = 0;
+  for (uint8_t i = 0; i < channelCount; i++) {
+    const uint8_t output = generators[i]->getOutputDuty();
+    const uint32_t distance = (pwmValue > output) ? pwmValue - output : output - pwmValue;
+    if (distance > steps) steps = distance;
+  }
+  return rampTo(pwmValue, (steps * 1000 + dutyPerSecond - 1) / dutyPerSecond);
+}
+
+// Both motor channels on one LEDC timer
+using MotorPwmGroup = PwmGroup<2>;
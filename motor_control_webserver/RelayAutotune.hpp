@@ -0,0 +1,306 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+/*
+  Relay-feedback (Astrom-Hagglund) tuning of one speed loop.
+
+  - Settling: the speed loop holds the setpoint with its present gains. Once the speed has
+    stayed within SETTLE_TOLERANCE for SETTLE_MS, the mean duty of that window becomes the
+    relay bias.
+  - Relay: the duty switches between bias - amplitude and bias + amplitude whenever the speed
+    leaves the hysteresis band around the setpoint. The loop oscillates at its ultimate period.
+    The first WARMUP_CYCLES cycles are skipped and the next MEASURE_CYCLES are averaged.
+  - Ultimate gain Ku = 4 d / (pi sqrt(a^2 - h^2)) for relay amplitude d, speed amplitude a
+    and hysteresis h. The gains follow from Ku and the ultimate period Tu by the chosen rule.
+  - Bounded: the duty never leaves [0, maxDuty]. Exceeding the overspeed limit or the time
+    limit ends the run with an error status. The caller drives zero duty after any end.
+
+  Speeds are in the units of the speed loop (normalized by its maxRpm), so Ku is directly a
+  proportional gain of that loop.
+
+  Plain arithmetic without any ESP-IDF dependency, feed it a simulated plant on the host.
+  Only used from task context, no synchronization needed.
+*/
+class RelayAutotune {
+public:
+  enum class Status : uint8_t {
+    IDLE,
+    SETTLING,
+    RELAY,
+    DONE,
+    TIMED_OUT,
+    OVERSPEED,
+    NO_OSCILLATION,
+    ABORTED
+  };
+
+  enum class Rule : uint8_t {
+    ZIEGLER_NICHOLS_PI,
+    ZIEGLER_NICHOLS_PID,
+    TYREUS_LUYBEN_PI        // Less overshoot, slower recovery
+  };
+
+  struct Config {
+    float setpoint;         // Normalized speed
+    float amplitude;        // Relay step, duty
+    float hysteresis;       // Normalized speed
+    float overspeed;        // Normalized speed that aborts the run
+    float maxDuty;
+    uint32_t timeoutMs;
+    Rule rule;
+  };
+
+  struct Gains {
+    float kp;
+    float ki;               // 1/s
+    float kd;               // s
+  };
+
+  static constexpr float SETTLE_TOLERANCE = 0.05f;   // Of the setpoint
+  static constexpr uint32_t SETTLE_MS = 1000;
+  static constexpr uint8_t WARMUP_CYCLES = 1;
+  static constexpr uint8_t MEASURE_CYCLES = 4;
+
+private:
+  Config config;
+  Status status;
+  uint32_t sampleMs;
+  uint32_t elapsedMs;
+
+  // Settling
+  uint32_t settledMs;
+  float dutySum;
+  uint32_t dutySamples;
+
+  // Relay
+  float bias;
+  float high;
+  float low;
+  bool driveHigh;
+  uint8_t cycles;
+  uint32_t cycleStartMs;
+  float cycleMax;
+  float cycleMin;
+  float periodSum;
+  float amplitudeSum;
+
+  float ultimateGain;
+  float ultimatePeriod;
+  Gains gains;
+
+  void startRelay();
+  void completeCycle();
+  void finish();
+
+public:
+  RelayAutotune();
+
+  // Begins a run, update() is then due every sampleMs
+  void start(const Config &config, uint32_t sampleMs);
+  void abort();
+
+  // Next sample: the measured speed and the duty the speed loop would command, returns the duty
+  float update(float speed, float loopDuty);
+
+  inline Status getStatus() const { return status; }
+  inline bool isRunning() const { return status == Status::SETTLING || status == Status::RELAY; }
+
+  // Valid in DONE
+  inline float getUltimateGain() const { return ultimateGain; }
+  inline float getUltimatePeriod() const { return ultimatePeriod; }
+  inline const Gains &getGains() const { return gains; }
+
+  static const char *statusName(Status status);
+  static const char *ruleName(Rule rule);
+  static bool parseRule(const char *name, Rule &rule);
+};
+
+RelayAutotune::RelayAutotune() :
+config{0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0, Rule::TYREUS_LUYBEN_PI},
+status(Status::IDLE),
+sampleMs(1),
+elapsedMs(0),
+settledMs(0),
+dutySum(0.0f),
+dutySamples(0),
+bias(0.0f),
+high(0.0f),
+low(0.0f),
+driveHigh(false),
+cycles(0),
+cycleStartMs(0),
+cycleMax(0.0f),
+cycleMin(0.0f),
+periodSum(0.0f),
+amplitudeSum(0.0f),
+ultimateGain(0.0f),
+ultimatePeriod(0.0f),
+gains{0.0f, 0.0f, 0.0f}
+{}
+
+void RelayAutotune::start(const Config &config, uint32_t sampleMs) {
+  this->config = config;
+  this->sampleMs = sampleMs > 0 ? sampleMs : 1;
+  elapsedMs = 0;
+  settledMs = 0;
+  dutySum = 0.0f;
+  dutySamples = 0;
+  ultimateGain = 0.0f;
+  ultimatePeriod = 0.0f;
+  gains = Gains{0.0f, 0.0f, 0.0f};
+  status = Status::SETTLING;
+}
+
+void RelayAutotune::abort() {
+  if (isRunning()) {
+    status = Status::ABORTED;
+  }
+}
+
+float RelayAutotune::update(float speed, float loopDuty) {
+  if (!isRunning()) return 0.0f;
+
+  elapsedMs += sampleMs;
+  if (speed > config.overspeed) {
+    status = Status::OVERSPEED;
+    return 0.0f;
+  }
+  if (elapsedMs > config.timeoutMs) {
+    status = Status::TIMED_OUT;
+    return 0.0f;
+  }
+
+  if (status == Status::SETTLING) {
+    const float duty = loopDuty < config.maxDuty ? loopDuty : config.maxDuty;
+    if (fabsf(speed - config.setpoint) <= config.setpoint * SETTLE_TOLERANCE) {
+      settledMs += sampleMs;
+      dutySum += duty;
+      dutySamples++;
+      if (settledMs >= SETTLE_MS) {
+        startRelay();
+      }
+    } else {
+      settledMs = 0;
+      dutySum = 0.0f;
+      dutySamples = 0;
+    }
+    return duty;
+  }
+
+  if (speed > cycleMax) cycleMax = speed;
+  if (speed < cycleMin) cycleMin = speed;
+
+  if (driveHigh && speed > config.setpoint + config.hysteresis) {
+    driveHigh = false;
+  } else if (!driveHigh && speed < config.setpoint - config.hysteresis) {
+    driveHigh = true;
+    completeCycle();
+  }
+  return driveHigh ? high : low;
+}
+
+void RelayAutotune::startRelay() {
+  bias = dutySum / dutySamples;
+  high = bias + config.amplitude;
+  low = bias - config.amplitude;
+  if (high > config.maxDuty) high = config.maxDuty;
+  if (low < 0.0f) low = 0.0f;
+
+  // Settled at the setpoint, start by pushing above it
+  driveHigh = true;
+  cycles = 0;
+  cycleStartMs = elapsedMs;
+  cycleMax = config.setpoint;
+  cycleMin = config.setpoint;
+  periodSum = 0.0f;
+  amplitudeSum = 0.0f;
+  status = Status::RELAY;
+}
+
+void RelayAutotune::completeCycle() {
+  // A cycle runs from one switch to high to the next, the first one starts at the relay start
+  if (cycles >= WARMUP_CYCLES) {
+    periodSum += (elapsedMs - cycleStartMs) / 1000.0f;
+    amplitudeSum += (cycleMax - cycleMin) / 2.0f;
+  }
+  cycles++;
+  cycleStartMs = elapsedMs;
+  cycleMax = config.setpoint;
+  cycleMin = config.setpoint;
+
+  if (cycles >= WARMUP_CYCLES + MEASURE_CYCLES) {
+    finish();
+  }
+}
+
+void RelayAutotune::finish() {
+  const float period = periodSum / MEASURE_CYCLES;
+  const float amplitude = amplitudeSum / MEASURE_CYCLES;
+  const float relayAmplitude = (high - low) / 2.0f;
+  const float squared = amplitude * amplitude - config.hysteresis * config.hysteresis;
+  if (!(squared > 0.0f) || !(period > 0.0f) || !(relayAmplitude > 0.0f)) {
+    status = Status::NO_OSCILLATION;
+    return;
+  }
+
+  ultimateGain = 4.0f * relayAmplitude / (static_cast<float>(M_PI) * sqrtf(squared));
+  ultimatePeriod = period;
+
+  switch (config.rule) {
+    case Rule::ZIEGLER_NICHOLS_PI:
+      gains.kp = 0.45f * ultimateGain;
+      gains.ki = gains.kp / (period / 1.2f);
+      gains.kd = 0.0f;
+      break;
+    case Rule::ZIEGLER_NICHOLS_PID:
+      gains.kp = 0.6f * ultimateGain;
+      gains.ki = gains.kp / (period / 2.0f);
+      gains.kd = gains.kp * period / 8.0f;
+      break;
+    default:
+      gains.kp = ultimateGain / 3.2f;
+      gains.ki = gains.kp / (2.2f * period);
+      gains.kd = 0.0f;
+      break;
+  }
+  status = Status::DONE;
+}
+
+const char *RelayAutotune::statusName(Status status) {
+  switch (status) {
+    case Status::SETTLING: return "settling";
+    case Status::RELAY: return "relay";
+    case Status::DONE: return "done";
+    case Status::TIMED_OUT: return "timed_out";
+    case Status::OVERSPEED: return "overspeed";
+    case Status::NO_OSCILLATION: return "no_oscillation";
+    case Status::ABORTED: return "aborted";
+    default: return "idle";
+  }
+}
+
+const char *RelayAutotune::ruleName(Rule rule) {
+  switch (rule) {
+    case Rule::ZIEGLER_NICHOLS_PI: return "ziegler_nichols_pi";
+    case Rule::ZIEGLER_NICHOLS_PID: return "ziegler_nichols_pid";
+    default: return "tyreus_luyben_pi";
+  }
+}
+
+bool RelayAutotune::parseRule(const char *name, Rule &rule) {
+  if (name == nullptr) {
+    return false;
+  } else if (strcmp(name, "ziegler_nichols_pi") == 0) {
+    rule = Rule::ZIEGLER_NICHOLS_PI;
+  } else if (strcmp(name, "ziegler_nichols_pid") == 0) {
+    rule = Rule::ZIEGLER_NICHOLS_PID;
+  } else if (strcmp(name, "tyreus_luyben_pi") == 0) {
+    rule = Rule::TYREUS_LUYBEN_PI;
+  } else {
+    return false;
+  }
+  return true;
+}
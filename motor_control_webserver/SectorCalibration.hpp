@@ -0,0 +1,312 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/*
+  Per-sector period correction for uneven magnet spacing and Hall placement.
+
+  Every edge period of a revolution belongs to one of Sectors sectors. At constant speed a
+  sector spans correction[sector] times the mean period, so period / correction[sector] is
+  the period an evenly spaced motor would have produced and one edge is enough for a speed.
+
+  - Learning: startLearning() collects whole revolutions, normalizes each one by its own
+    duration (slow speed changes cancel) and averages them. Revolutions deviating more than
+    STEADY_TOLERANCE from the previous one are not steady and are skipped.
+  - Phase: after a restart or lost edges the sector of the next edge is unknown. One
+    revolution of periods is correlated against the table at every rotation and the best
+    match is taken once its correlation exceeds LOCK_CORRELATION. Until then periods pass
+    through uncorrected. While locked the correlation keeps running once per revolution:
+    a slip (a lost or extra edge the filter let through) shows up as another best rotation
+    on two revolutions in a row and moves the sector.
+  - The sector order assumes one direction of rotation.
+
+  Plain arithmetic without any ESP-IDF dependency, feed it simulated periods on the host.
+  Only used from task context, no synchronization needed.
+*/
+template <size_t Sectors>
+class SectorCalibration {
+public:
+  enum class Status : uint8_t {
+    UNCALIBRATED,
+    LEARNING,
+    SEARCHING,
+    LOCKED
+  };
+
+  static constexpr float STEADY_TOLERANCE = 0.02f;
+  static constexpr float LOCK_CORRELATION = 0.6f;
+
+  // A table outside these bounds is a bad learn or a corrupt blob
+  static constexpr float MIN_CORRECTION = 0.5f;
+  static constexpr float MAX_CORRECTION = 1.5f;
+
+private:
+  static_assert(Sectors >= 2 && Sectors <= 255, "The sector index is uint8_t");
+
+  static constexpr int16_t NO_SHIFT = -1;
+  static constexpr uint16_t LEARN_CHECK_REVOLUTIONS = 4;
+
+  float correction[Sectors];
+  bool calibrated;
+  bool locked;
+  uint8_t sector;
+
+  // The revolution in progress, periods[0] belongs to the sector the revolution started at
+  uint32_t periods[Sectors];
+  uint8_t collected;
+  int16_t pendingShift;
+
+  bool learning;
+  uint16_t targetRevolutions;
+  uint16_t learnedRevolutions;
+  float sums[Sectors];
+  uint32_t previousRevolutionMicros;
+
+  inline void completeRevolution() __attribute__((always_inline));
+  inline void learnRevolution(uint32_t revolutionMicros) __attribute__((always_inline));
+  inline void trackPhase(uint32_t revolutionMicros) __attribute__((always_inline));
+  inline int16_t bestRotation(uint32_t revolutionMicros, const float *reference) const __attribute__((always_inline));
+  inline void restartLearning() __attribute__((always_inline));
+
+public:
+  SectorCalibration();
+
+  // Next edge period, returns it corrected for its sector once calibrated and locked
+  inline float apply(uint32_t periodMicros) __attribute__((always_inline));
+
+  // Edges went missing or the estimate restarted, the sector of the next edge is unknown
+  inline void breakPhase() __attribute__((always_inline));
+
+  void startLearning(uint16_t revolutions);
+
+  // Installs a stored table, false (and uncalibrated) when it is out of bounds
+  bool setTable(const float *table);
+  inline const float *getTable() const { return correction; }
+
+  Status getStatus() const;
+  inline uint16_t getLearnedRevolutions() const { return learnedRevolutions; }
+
+  static const char *statusName(Status status);
+};
+
+template <size_t Sectors>
+SectorCalibration<Sectors>::SectorCalibration() :
+calibrated(false),
+locked(false),
+sector(0),
+collected(0),
+pendingShift(NO_SHIFT),
+learning(false),
+targetRevolutions(0),
+learnedRevolutions(0),
+previousRevolutionMicros(0)
+{
+  for (size_t i = 0; i < Sectors; i++) {
+    correction[i] = 1.0f;
+  }
+  memset(periods, 0, sizeof(periods));
+  memset(sums, 0, sizeof(sums));
+}
+
+template <size_t Sectors>
+float SectorCalibration<Sectors>::apply(uint32_t periodMicros) {
+  const float corrected = (calibrated && locked && !learning)
+    ? periodMicros / correction[sector]
+    : static_cast<float>(periodMicros);
+
+  periods[collected] = periodMicros;
+  collected = collected + 1;
+  sector = (sector + 1 == Sectors) ? 0 : sector + 1;
+
+  if (collected == Sectors) {
+    completeRevolution();
+    collected = 0;
+  }
+  return corrected;
+}
+
+template <size_t Sectors>
+void SectorCalibration<Sectors>::breakPhase() {
+  locked = false;
+  sector = 0;
+  collected = 0;
+  pendingShift = NO_SHIFT;
+  previousRevolutionMicros = 0;
+
+  if (learning) {
+    restartLearning();
+  }
+}
+
+template <size_t Sectors>
+void SectorCalibration<Sectors>::startLearning(uint16_t revolutions) {
+  learning = true;
+  targetRevolutions = revolutions > 0 ? revolutions : 1;
+  restartLearning();
+}
+
+template <size_t Sectors>
+void SectorCalibration<Sectors>::restartLearning() {
+  // The learned table defines its own sector 0 at the first collected edge
+  memset(sums, 0, sizeof(sums));
+  learnedRevolutions = 0;
+  sector = 0;
+  collected = 0;
+  previousRevolutionMicros = 0;
+  locked = true;
+}
+
+template <size_t Sectors>
+void SectorCalibration<Sectors>::completeRevolution() {
+  if (!learning && !calibrated) return;
+
+  uint32_t revolutionMicros = 0;
+  for (size_t i = 0; i < Sectors; i++) {
+    revolutionMicros += periods[i];
+  }
+  if (revolutionMicros == 0) return;
+
+  if (learning) {
+    learnRevolution(revolutionMicros);
+  } else {
+    trackPhase(revolutionMicros);
+  }
+}
+
+template <size_t Sectors>
+void SectorCalibration<Sectors>::learnRevolution(uint32_t revolutionMicros) {
+  const uint32_t previous = previousRevolutionMicros;
+  previousRevolutionMicros = revolutionMicros;
+
+  // The first revolution has nothing to compare with, an unsteady one is not averaged
+  if (previous == 0) return;
+  const float change = (static_cast<float>(revolutionMicros) - previous) / previous;
+  if (change > STEADY_TOLERANCE || change < -STEADY_TOLERANCE) return;
+
+  // An edge slipped through the filter once a few revolutions agree on the pattern:
+  // the frame moved, start over rather than averaging two frames
+  if (learnedRevolutions >= LEARN_CHECK_REVOLUTIONS) {
+    float average[Sectors];
+    for (size_t i = 0; i < Sectors; i++) {
+      average[i] = sums[i] / learnedRevolutions;
+    }
+    const int16_t shift = bestRotation(revolutionMicros, average);
+    if (shift != NO_SHIFT && shift != sector) {
+      restartLearning();
+      return;
+    }
+  }
+
+  // periods[i] belongs to sector i, the revolution started when sector wrapped to 0
+  const float meanPeriod = static_cast<float>(revolutionMicros) / Sectors;
+  for (size_t i = 0; i < Sectors; i++) {
+    sums[i] += periods[i] / meanPeriod;
+  }
+  learnedRevolutions = learnedRevolutions + 1;
+  if (learnedRevolutions < targetRevolutions) return;
+
+  float table[Sectors];
+  for (size_t i = 0; i < Sectors; i++) {
+    table[i] = sums[i] / learnedRevolutions;
+  }
+  learning = false;
+  if (setTable(table)) {
+    // Same frame as the learned revolutions, the next edge is sector 0 again
+    locked = true;
+    sector = 0;
+  }
+}
+
+template <size_t Sectors>
+int16_t SectorCalibration<Sectors>::bestRotation(uint32_t revolutionMicros, const float *reference) const {
+  const float meanPeriod = static_cast<float>(revolutionMicros) / Sectors;
+
+  // Pearson correlation of the revolution against every rotation of the reference.
+  // The reference has mean 1, its deviation energy is the same for every rotation.
+  float ratios[Sectors];
+  float ratioEnergy = 0.0f;
+  float referenceEnergy = 0.0f;
+  for (size_t i = 0; i < Sectors; i++) {
+    ratios[i] = periods[i] / meanPeriod - 1.0f;
+    ratioEnergy += ratios[i] * ratios[i];
+    referenceEnergy += (reference[i] - 1.0f) * (reference[i] - 1.0f);
+  }
+  if (ratioEnergy <= 0.0f || referenceEnergy <= 0.0f) return NO_SHIFT;
+
+  float bestDot = 0.0f;
+  int16_t bestShift = NO_SHIFT;
+  for (size_t shift = 0; shift < Sectors; shift++) {
+    float dot = 0.0f;
+    for (size_t i = 0; i < Sectors; i++) {
+      dot += ratios[i] * (reference[(i + shift) % Sectors] - 1.0f);
+    }
+    if (bestShift == NO_SHIFT || dot > bestDot) {
+      bestDot = dot;
+      bestShift = shift;
+    }
+  }
+
+  if (bestDot / sqrtf(ratioEnergy * referenceEnergy) < LOCK_CORRELATION) return NO_SHIFT;
+  return bestShift;
+}
+
+template <size_t Sectors>
+void SectorCalibration<Sectors>::trackPhase(uint32_t revolutionMicros) {
+  const int16_t shift = bestRotation(revolutionMicros, correction);
+  if (shift == NO_SHIFT) return;
+
+  // periods[i] is table sector (i + shift), the next edge follows periods[Sectors - 1].
+  // A whole revolution later the sector counter is back where the buffer started.
+  if (locked && shift == sector) {
+    pendingShift = NO_SHIFT;
+    return;
+  }
+  if (locked && shift != pendingShift) {
+    pendingShift = shift;
+    return;
+  }
+
+  sector = shift;
+  locked = true;
+  pendingShift = NO_SHIFT;
+}
+
+template <size_t Sectors>
+bool SectorCalibration<Sectors>::setTable(const float *table) {
+  float sum = 0.0f;
+  for (size_t i = 0; i < Sectors; i++) {
+    if (!(table[i] >= MIN_CORRECTION && table[i] <= MAX_CORRECTION)) {
+      calibrated = false;
+      return false;
+    }
+    sum += table[i];
+  }
+
+  // Normalized to mean 1 so a whole revolution keeps its duration
+  const float mean = sum / Sectors;
+  for (size_t i = 0; i < Sectors; i++) {
+    correction[i] = table[i] / mean;
+  }
+  calibrated = true;
+  return true;
+}
+
+template <size_t Sectors>
+typename SectorCalibration<Sectors>::Status SectorCalibration<Sectors>::getStatus() const {
+  if (learning) return Status::LEARNING;
+  if (!calibrated) return Status::UNCALIBRATED;
+  return locked ? Status::LOCKED : Status::SEARCHING;
+}
+
+template <size_t Sectors>
+const char *SectorCalibration<Sectors>::statusName(Status status) {
+  switch (status) {
+    case Status::LEARNING: return "learning";
+    case Status::SEARCHING: return "searching";
+    case Status::LOCKED: return "locked";
+    default: return "uncalibrated";
+  }
+}
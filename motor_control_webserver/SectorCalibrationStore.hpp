@@ -0,0 +1,143 @@
+#pragma once
+
+#include <nvs.h>
+#include <esp_log.h>
+#include <cstring>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/*
+  Persists the per-sector correction table of every registered calculator to NVS.
+
+  - begin() loads the stored tables, before the speed sensors start so no edge sees a
+    half-installed table.
+  - A table is only written when a learning run completes, one blob per motor. The store
+    task polls the calculators for a finished table, the speed task never touches flash.
+
+  Calculator must provide loadSectorTable(), takeSectorTable() and EDGES_PER_REVOLUTION.
+*/
+template <typename Calculator, size_t MaxMotors>
+class SectorCalibrationStore {
+private:
+  static constexpr const char *NVS_NAMESPACE = "sector_cal";
+  static constexpr size_t KEY_LENGTH = 16;   // NVS keys are at most 15 characters
+  static constexpr uint32_t CHECK_INTERVAL_MS = 1000;
+
+  Calculator *calculators[MaxMotors];
+  char keys[MaxMotors][KEY_LENGTH];
+  uint8_t motorCount;
+
+  nvs_handle_t nvsHandle;
+  bool opened;
+
+  void saveLearned();
+
+public:
+  SectorCalibrationStore();
+
+  // Registers a calculator under an NVS key before begin(), false when full
+  bool add(Calculator &calculator, const char *key);
+
+  // Loads the stored tables into every calculator and starts the store task
+  void begin(TaskHandle_t &, const BaseType_t app_cpu = 1);
+
+  // FreeRTOS
+  static void sectorCalibrationStoreTask(void *);
+};
+
+template <typename Calculator, size_t MaxMotors>
+SectorCalibrationStore<Calculator, MaxMotors>::SectorCalibrationStore() :
+motorCount(0),
+nvsHandle(0),
+opened(false)
+{
+  memset(calculators, 0, sizeof(calculators));
+  memset(keys, 0, sizeof(keys));
+}
+
+template <typename Calculator, size_t MaxMotors>
+bool SectorCalibrationStore<Calculator, MaxMotors>::add(Calculator &calculator, const char *key) {
+  if (motorCount >= MaxMotors || key == nullptr || strlen(key) >= KEY_LENGTH) {
+    ESP_LOGE("SectorCalibrationStore", "Cannot register sector table key %s", key ? key : "(null)");
+    return false;
+  }
+
+  calculators[motorCount] = &calculator;
+  strncpy(keys[motorCount], key, KEY_LENGTH - 1);
+  motorCount++;
+  return true;
+}
+
+template <typename Calculator, size_t MaxMotors>
+void SectorCalibrationStore<Calculator, MaxMotors>::begin(TaskHandle_t &taskHandle, const BaseType_t app_cpu) {
+  const char *TAG = "SectorCalibrationStore::begin";
+
+  esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvsHandle);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to open NVS namespace %s: %s", NVS_NAMESPACE, esp_err_to_name(err));
+    return;
+  }
+  opened = true;
+
+  for (uint8_t i = 0; i < motorCount; i++) {
+    float table[Calculator::EDGES_PER_REVOLUTION];
+    size_t length = sizeof(table);
+    err = nvs_get_blob(nvsHandle, keys[i], table, &length);
+    if (err == ESP_OK && length == sizeof(table)) {
+      if (calculators[i]->loadSectorTable(table)) {
+        ESP_LOGI(TAG, "Loaded sector table %s", keys[i]);
+      } else {
+        ESP_LOGW(TAG, "Sector table %s out of bounds, ignored", keys[i]);
+      }
+    } else if (err != ESP_ERR_NVS_NOT_FOUND) {
+      ESP_LOGW(TAG, "Failed to read %s: %s", keys[i], esp_err_to_name(err));
+    }
+  }
+
+  if (taskHandle == nullptr) {
+    BaseType_t result = xTaskCreatePinnedToCore(
+      &sectorCalibrationStoreTask,
+      "sectorCalStoreTask",
+      3072,
+      this,
+      1,
+      &taskHandle,
+      app_cpu
+    );
+
+    if (result == pdPASS) {
+      ESP_LOGI(TAG, "Created the sectorCalibrationStoreTask successfully");
+    } else {
+      ESP_LOGE(TAG, "Failed to create the sectorCalibrationStoreTask task");
+    }
+  }
+}
+
+template <typename Calculator, size_t MaxMotors>
+void SectorCalibrationStore<Calculator, MaxMotors>::saveLearned() {
+  if (!opened) return;
+
+  for (uint8_t i = 0; i < motorCount; i++) {
+    float table[Calculator::EDGES_PER_REVOLUTION];
+    if (!calculators[i]->takeSectorTable(table)) continue;
+
+    esp_err_t err = nvs_set_blob(nvsHandle, keys[i], table, sizeof(table));
+    if (err == ESP_OK) {
+      err = nvs_commit(nvsHandle);
+    }
+    if (err != ESP_OK) {
+      ESP_LOGE("SectorCalibrationStore", "Failed to save %s: %s", keys[i], esp_err_to_name(err));
+    } else {
+      ESP_LOGI("SectorCalibrationStore", "Saved sector table %s", keys[i]);
+    }
+  }
+}
+
+template <typename Calculator, size_t MaxMotors>
+void SectorCalibrationStore<Calculator, MaxMotors>::sectorCalibrationStoreTask(void *pvParameters) {
+  SectorCalibrationStore *store = static_cast<SectorCalibrationStore*>(pvParameters);
+  while (1) {
+    vTaskDelay(pdMS_TO_TICKS(CHECK_INTERVAL_MS));
+    store->saveLearned();
+  }
+}
@@ -0,0 +1,808 @@
+#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include "PidController.hpp"
+#include "RelayAutotune.hpp"
+#include "FeedforwardTable.hpp"
+#include "PwmGroup.hpp"
+#include "HallDiagnostics.hpp"
+
+/*
+  Closed-loop speed control: one PID per motor from the RPM estimate to the PWM duty.
+
+  - Runs every CONTROL_PERIOD_MS in its own task. Every period it reads the speed of each
+    calculator, updates its PID and commits all duties together through the PwmGroup.
+  - The PID works on speeds normalized by maxRpm and on duty as a fraction (0..1), so gains
+    stay around 1 and the loop runs the same in float or FixedPoint (template argument T).
+  - setSpeed() closes the loop, bumpless from the present duty. disable() opens it and
+    leaves the duty to the caller. Once disable() returns the task commits nothing more.
+  - Modes are exclusive: open loop, closed loop, autotune or feedforward sweep. Starting one
+    aborts whichever ran before.
+  - A zero setpoint drives zero duty and clears the integrator instead of regulating.
+  - A NO_FEEDBACK fault opens the loop at zero duty: without edges the integrator would
+    run the motor up to the output limit.
+  - Synchronization of the motors (setSyncMode()):
+    - INDEPENDENT: every loop only sees its own speed.
+    - CROSS_COUPLED: each loop also sees how far its tracking error is from the mean of all,
+      weighted by the coupling gain. A motor held back by load is pushed harder and the
+      others ease off until it has caught up.
+    - MASTER_SLAVE: motor 0 follows the setpoint, the others follow the measured speed of
+      motor 0 (scaled by the ratio of their setpoints). A loaded slave does not slow the
+      master.
+  - The sync error is the spread of the tracking errors in percent of the highest setpoint,
+    |rpm1 - rpm2| / rpm for two motors at the same setpoint. Live and peak since setSpeed().
+  - startAutotune() runs a RelayAutotune on one or every motor in place of the loop, the
+    other motors stay at zero duty. A motor that finishes drops to zero duty and takes the
+    tuned gains, takeTunedGains() hands them over for storage once. disable() aborts it.
+  - Feedforward: with a calibrated FeedforwardTable the PID output is added to the table's
+    duty for the speed the motor should run at, a step starts at the right duty at once
+    and the integrator only corrects the model error. startFeedforwardSweep() learns the
+    tables the same way as an autotune run, setOpenLoopSpeed() drives a speed from the table
+    alone.
+
+  Calculator must provide getSpeedRpm(), getFaults() and setDriveDuty().
+  The sweep records motor currents through the CurrentReader, 0 A without one.
+*/
+template <typename Calculator, size_t Motors, typename T = float>
+class SpeedController {
+public:
+  static constexpr uint32_t CONTROL_PERIOD_MS = 20;
+
+  // Conservative defaults, duty fraction per normalized speed error
+  static constexpr float DEFAULT_KP = 0.6f;
+  static constexpr float DEFAULT_KI = 1.5f;
+  static constexpr float DEFAULT_KD = 0.0f;
+  static constexpr float DEFAULT_COUPLING_GAIN = 1.0f;
+  static constexpr float MAX_COUPLING_GAIN = 10.0f;
+
+  static constexpr uint8_t ALL_MOTORS = 0xFF;
+  static constexpr float AUTOTUNE_HYSTERESIS_RPM = 5.0f;     // Above the speed estimate noise
+  static constexpr float AUTOTUNE_OVERSPEED = 1.5f;          // Of the autotune setpoint
+  static constexpr uint32_t AUTOTUNE_MAX_TIMEOUT_MS = 60000;
+
+  enum class Mode : uint8_t {
+    OPEN_LOOP,
+    CLOSED_LOOP,
+    AUTOTUNE,
+    FEEDFORWARD_SWEEP
+  };
+
+  enum class SyncMode : uint8_t {
+    INDEPENDENT,
+    CROSS_COUPLED,
+    MASTER_SLAVE
+  };
+
+  using Pid = PidController<T>;
+
+  // Current of a motor (0-based) in Amps
+  typedef float (*CurrentReader)(uint8_t motor);
+
+private:
+  Calculator *calculators[Motors];
+  uint8_t motorCount;
+  PwmGroup<Motors> &output;
+  const float maxRpm;
+
+  Pid pids[Motors];
+  float setpoints[Motors];
+  float maxDuty;
+  Mode mode;
+  RelayAutotune tuners[Motors];
+  FeedforwardTable feedforward[Motors];
+  bool feedforwardEnabled;
+  CurrentReader currentReader;
+  SyncMode syncMode;
+  float couplingGain;
+
+  std::atomic<Mode> reportedMode;            // Mirrors mode for lock-free readers
+  std::atomic<float> reportedDuties[Motors];
+  std::atomic<float> reportedSetpoints[Motors];
+  std::atomic<float> syncError;
+  std::atomic<float> peakSyncError;
+  std::atomic<bool> tunedPending[Motors];
+  std::atomic<bool> tablePending[Motors];
+
+  SemaphoreHandle_t mutex;
+
+  void step();
+  void setMode(Mode mode);
+  void stopRuns();
+  void closeLoop();
+  float feedforwardFor(uint8_t motor, float rpm) const;
+  float updateSyncError(const float *speeds);
+  void stepLoop(const float *speeds, float *duties);
+  void stepAutotune(const float *speeds, float *duties);
+  void stepSweep(const float *speeds, float *duties);
+
+public:
+  SpeedController(PwmGroup<Motors> &output, float maxRpm);
+
+  // Registers a motor before begin(), in the order of the PwmGroup channels
+  bool add(Calculator &calculator);
+
+  void begin(TaskHandle_t &, const BaseType_t app_cpu = 1);
+
+  // Closes the loop on every motor, or on one (0-based) with the others keeping theirs
+  void setSpeed(float rpm);
+  void setSpeed(uint8_t motor, float rpm);
+
+  // Opens the loop, the duty stays where it is until the caller sets one
+  void disable();
+  inline bool isEnabled() const { return getMode() == Mode::CLOSED_LOOP; }
+  inline Mode getMode() const { return reportedMode.load(std::memory_order_relaxed); }
+
+  // Same gains for every motor, or for one
+  void setGains(float kp, float ki, float kd);
+  void setGains(uint8_t motor, float kp, float ki, float kd);
+  typename Pid::Gains getGains(uint8_t motor = 0);
+
+  // Highest duty (0..1) the loop may command
+  void setMaxDuty(float duty);
+  inline float getMaxDuty() const { return maxDuty; }
+
+  inline float getSetpoint(uint8_t motor) const { return reportedSetpoints[motor].load(std::memory_order_relaxed); }
+  inline float getDuty(uint8_t motor) const { return reportedDuties[motor].load(std::memory_order_relaxed); }
+
+  // Synchronization of the motors, takes effect on the next period
+  void setSyncMode(SyncMode mode);
+  void setCouplingGain(float gain);
+  inline SyncMode getSyncMode() const { return syncMode; }
+  inline float getCouplingGain() const { return couplingGain; }
+
+  // Percent of the highest setpoint, 0 while the loop is open
+  inline float getSyncError() const { return syncError.load(std::memory_order_relaxed); }
+  inline float getPeakSyncError() const { return peakSyncError.load(std::memory_order_relaxed); }
+
+  // Relay autotune at rpm on one motor (0-based) or ALL_MOTORS, false when it cannot start
+  bool startAutotune(uint8_t motor, float rpm, float amplitude, RelayAutotune::Rule rule, uint32_t timeoutMs);
+  inline bool isTuning() const { return getMode() == Mode::AUTOTUNE; }
+  inline RelayAutotune::Status getAutotuneStatus(uint8_t motor) const { return tuners[motor].getStatus(); }
+  inline float getUltimateGain(uint8_t motor) const { return tuners[motor].getUltimateGain(); }
+  inline float getUltimatePeriod(uint8_t motor) const { return tuners[motor].getUltimatePeriod(); }
+
+  // Gains of a finished autotune, true once per run
+  bool takeTunedGains(uint8_t motor, RelayAutotune::Gains &gains);
+
+  void setCurrentReader(CurrentReader reader) { currentReader = reader; }
+
+  // Duty sweep of one motor (0-based) or ALL_MOTORS up to the max duty, capped at
+  // FeedforwardTable::MAX_SWEEP_DUTY, false when it cannot start
+  bool startFeedforwardSweep(uint8_t motor);
+  inline FeedforwardTable::Status getFeedforwardStatus(uint8_t motor) const { return feedforward[motor].getStatus(); }
+
+  // Copies the installed table, false without one
+  bool getFeedforwardTable(uint8_t motor, FeedforwardTable::Point *points);
+  // Installs a stored table, false when it is invalid
+  bool setFeedforwardTable(uint8_t motor, const FeedforwardTable::Point *points);
+  // Table of a finished sweep, true once per sweep
+  bool takeFeedforwardTable(uint8_t motor, FeedforwardTable::Point *points);
+
+  // Feedforward in the loop, on by default, without effect until a table is installed
+  void setFeedforwardEnabled(bool enable);
+  inline bool isFeedforwardEnabled() const { return feedforwardEnabled; }
+
+  // Opens the loop and sets the table's duty for rpm on one motor or ALL_MOTORS at once,
+  // false when a selected motor has no table
+  bool setOpenLoopSpeed(uint8_t motor, float rpm);
+
+  static const char *modeName(Mode mode);
+  static const char *syncModeName(SyncMode mode);
+  static bool parseSyncMode(const char *name, SyncMode &mode);
+
+  // FreeRTOS
+  static void speedControllerTask(void *);
+};
+
+template <typename Calculator, size_t Motors, typename T>
+SpeedController<Calculator, Motors, T>::SpeedController(PwmGroup<Motors> &output, float maxRpm) :
+motorCount(0),
+output(output),
+maxRpm(maxRpm),
+maxDuty(1.0f),
+mode(Mode::OPEN_LOOP),
+feedforwardEnabled(true),
+currentReader(nullptr),
+syncMode(SyncMode::CROSS_COUPLED),
+couplingGain(DEFAULT_COUPLING_GAIN),
+reportedMode(Mode::OPEN_LOOP),
+syncError(0.0f),
+peakSyncError(0.0f),
+mutex(nullptr)
+{
+  memset(calculators, 0, sizeof(calculators));
+  for (size_t i = 0; i < Motors; i++) {
+    pids[i] = Pid(T(CONTROL_PERIOD_MS / 1000.0f));
+    pids[i].setGains(T(DEFAULT_KP), T(DEFAULT_KI), T(DEFAULT_KD));
+    setpoints[i] = 0.0f;
+    reportedDuties[i].store(0.0f, std::memory_order_relaxed);
+    reportedSetpoints[i].store(0.0f, std::memory_order_relaxed);
+    tunedPending[i].store(false, std::memory_order_relaxed);
+    tablePending[i].store(false, std::memory_order_relaxed);
+  }
+}
+
+template <typename Calculator, size_t Motors, typename T>
+bool SpeedController<Calculator, Motors, T>::add(Calculator &calculator) {
+  if (motorCount >= Motors) {
+    ESP_LOGE("SpeedController", "Cannot control more than %d motors", static_cast<int>(Motors));
+    return false;
+  }
+
+  calculators[motorCount++] = &calculator;
+  return true;
+}
+
+template <typename Calculator, size_t Motors, typename T>
+void SpeedController<Calculator, Motors, T>::begin(TaskHandle_t &taskHandle, const BaseType_t app_cpu) {
+  const char *TAG = "SpeedController::begin";
+
+  mutex = xSemaphoreCreateMutex();
+  if (mutex == nullptr) {
+    ESP_LOGE(TAG, "Failed to create the speed controller mutex");
+    return;
+  }
+
+  if (taskHandle == nullptr) {
+    BaseType_t result = xTaskCreatePinnedToCore(
+      &speedControllerTask,
+      "speedControllerTask",
+      3072,
+      this,
+      2,
+      &taskHandle,
+      app_cpu
+    );
+
+    if (result == pdPASS) {
+      ESP_LOGI(TAG, "Created the speedControllerTask successfully");
+    } else {
+      ESP_LOGE(TAG, "Failed to create the speedControllerTask task");
+    }
+  }
+}
+
+template <typename Calculator, size_t Motors, typename T>
+void SpeedController<Calculator, Motors, T>::setMode(Mode mode) {
+  this->mode = mode;
+  reportedMode.store(mode, std::memory_order_relaxed);
+}
+
+template <typename Calculator, size_t Motors, typename T>
+void SpeedController<Calculator, Motors, T>::stopRuns() {
+  for (uint8_t i = 0; i < motorCount; i++) {
+    tuners[i].abort();
+    feedforward[i].abort();
+  }
+}
+
+template <typename Calculator, size_t Motors, typename T>
+float SpeedController<Calculator, Motors, T>::feedforwardFor(uint8_t motor, float rpm) const {
+  return feedforwardEnabled ? feedforward[motor].dutyFor(rpm) : 0.0f;
+}
+
+template <typename Calculator, size_t Motors, typename T>
+void SpeedController<Calculator, Motors, T>::closeLoop() {
+  if (mode == Mode::CLOSED_LOOP) return;
+  stopRuns();
+
+  // Bumpless: every PID continues from the duty the motor has now, the table explains the
+  // share of it that the present speed needs
+  for (uint8_t i = 0; i < motorCount; i++) {
+    pids[i].reset(T(output.getDuty(i)), T(feedforwardFor(i, calculators[i]->getSpeedRpm())));
+  }
+  setMode(Mode::CLOSED_LOOP);
+}
+
+template <typename Calculator, size_t Motors, typename T>
+void SpeedController<Calculator, Motors, T>::setSpeed(float rpm) {
+  if (mutex == nullptr) return;
+  if (!(rpm > 0.0f)) rpm = 0.0f;
+
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  for (uint8_t i = 0; i < motorCount; i++) {
+    setpoints[i] = rpm;
+    reportedSetpoints[i].store(rpm, std::memory_order_relaxed);
+  }
+  peakSyncError.store(0.0f, std::memory_order_relaxed);
+  closeLoop();
+  xSemaphoreGive(mutex);
+}
+
+template <typename Calculator, size_t Motors, typename T>
+void SpeedController<Calculator, Motors, T>::setSpeed(uint8_t motor, float rpm) {
+  if (mutex == nullptr || motor >= motorCount) return;
+  if (!(rpm > 0.0f)) rpm = 0.0f;
+
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  setpoints[motor] = rpm;
+  reportedSetpoints[motor].store(rpm, std::memory_order_relaxed);
+  peakSyncError.store(0.0f, std::memory_order_relaxed);
+  closeLoop();
+  xSemaphoreGive(mutex);
+}
+
+template <typename Calculator, size_t Motors, typename T>
+void SpeedController<Calculator, Motors, T>::disable() {
+  if (mutex == nullptr) return;
+
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  stopRuns();
+  setMode(Mode::OPEN_LOOP);
+  for (uint8_t i = 0; i < motorCount; i++) {
+    setpoints[i] = 0.0f;
+    reportedSetpoints[i].store(0.0f, std::memory_order_relaxed);
+  }
+  syncError.store(0.0f, std::memory_order_relaxed);
+  xSemaphoreGive(mutex);
+}
+
+template <typename Calculator, size_t Motors, typename T>
+void SpeedController<Calculator, Motors, T>::setGains(float kp, float ki, float kd) {
+  if (mutex == nullptr) return;
+  if (kp < 0.0f || ki < 0.0f || kd < 0.0f) return;
+
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  for (uint8_t i = 0; i < Motors; i++) {
+    pids[i].setGains(T(kp), T(ki), T(kd));
+  }
+  xSemaphoreGive(mutex);
+  ESP_LOGI("SpeedController", "Gains set: kp=%.3f ki=%.3f kd=%.3f", kp, ki, kd);
+}
+
+template <typename Calculator, size_t Motors, typename T>
+void SpeedController<Calculator, Motors, T>::setGains(uint8_t motor, float kp, float ki, float kd) {
+  if (mutex == nullptr || motor >= Motors) return;
+  if (kp < 0.0f || ki < 0.0f || kd < 0.0f) return;
+
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  pids[motor].setGains(T(kp), T(ki), T(kd));
+  xSemaphoreGive(mutex);
+  ESP_LOGI("SpeedController", "Motor %d gains set: kp=%.3f ki=%.3f kd=%.3f", motor + 1, kp, ki, kd);
+}
+
+template <typename Calculator, size_t Motors, typename T>
+typename SpeedController<Calculator, Motors, T>::Pid::Gains SpeedController<Calculator, Motors, T>::getGains(uint8_t motor) {
+  if (motor >= Motors) motor = 0;
+  if (mutex == nullptr) return pids[motor].getGains();
+
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  const typename Pid::Gains gains = pids[motor].getGains();
+  xSemaphoreGive(mutex);
+  return gains;
+}
+
+template <typename Calculator, size_t Motors, typename T>
+void SpeedController<Calculator, Motors, T>::setMaxDuty(float duty) {
+  if (mutex == nullptr) return;
+  if (!(duty > 0.0f)) duty = 0.0f;
+  if (duty > 1.0f) duty = 1.0f;
+
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  maxDuty = duty;
+  for (uint8_t i = 0; i < Motors; i++) {
+    pids[i].setOutputLimits(T(0), T(duty));
+  }
+  xSemaphoreGive(mutex);
+}
+
+template <typename Calculator, size_t Motors, typename T>
+void SpeedController<Calculator, Motors, T>::setSyncMode(SyncMode mode) {
+  if (mutex == nullptr) return;
+
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  syncMode = mode;
+  peakSyncError.store(0.0f, std::memory_order_relaxed);
+  xSemaphoreGive(mutex);
+  ESP_LOGI("SpeedController", "Sync mode set: %s", syncModeName(mode));
+}
+
+template <typename Calculator, size_t Motors, typename T>
+void SpeedController<Calculator, Motors, T>::setCouplingGain(float gain) {
+  if (mutex == nullptr) return;
+  if (!(gain >= 0.0f)) return;
+  if (gain > MAX_COUPLING_GAIN) gain = MAX_COUPLING_GAIN;
+
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  couplingGain = gain;
+  xSemaphoreGive(mutex);
+  ESP_LOGI("SpeedController", "Coupling gain set: %.3f", gain);
+}
+
+template <typename Calculator, size_t Motors, typename T>
+bool SpeedController<Calculator, Motors, T>::startAutotune(uint8_t motor, float rpm, float amplitude, RelayAutotune::Rule rule, uint32_t timeoutMs) {
+  const char *TAG = "SpeedController::startAutotune";
+  if (mutex == nullptr || motorCount == 0) return false;
+  if (motor != ALL_MOTORS && motor >= motorCount) return false;
+  if (!(rpm > 0.0f) || rpm > maxRpm) return false;
+  if (!(amplitude > 0.0f)) return false;
+  if (timeoutMs == 0 || timeoutMs > AUTOTUNE_MAX_TIMEOUT_MS) timeoutMs = AUTOTUNE_MAX_TIMEOUT_MS;
+
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  const RelayAutotune::Config config = {
+    .setpoint = rpm / maxRpm,
+    .amplitude = amplitude,
+    .hysteresis = AUTOTUNE_HYSTERESIS_RPM / maxRpm,
+    .overspeed = rpm * AUTOTUNE_OVERSPEED / maxRpm,
+    .maxDuty = maxDuty,
+    .timeoutMs = timeoutMs,
+    .rule = rule
+  };
+
+  stopRuns();
+  for (uint8_t i = 0; i < motorCount; i++) {
+    const bool selected = motor == ALL_MOTORS || motor == i;
+    setpoints[i] = selected ? rpm : 0.0f;
+    reportedSetpoints[i].store(setpoints[i], std::memory_order_relaxed);
+    tunedPending[i].store(false, std::memory_order_relaxed);
+    if (selected) {
+      pids[i].reset(T(output.getDuty(i)), T(feedforwardFor(i, calculators[i]->getSpeedRpm())));
+      tuners[i].start(config, CONTROL_PERIOD_MS);
+    }
+  }
+  setMode(Mode::AUTOTUNE);
+  syncError.store(0.0f, std::memory_order_relaxed);
+  xSemaphoreGive(mutex);
+
+  ESP_LOGI(TAG, "Relay autotune of %s at %.0f rpm, +-%.2f duty, %s",
+           motor == ALL_MOTORS ? "every motor" : "one motor", rpm, amplitude, RelayAutotune::ruleName(rule));
+  return true;
+}
+
+template <typename Calculator, size_t Motors, typename T>
+bool SpeedController<Calculator, Motors, T>::takeTunedGains(uint8_t motor, RelayAutotune::Gains &gains) {
+  if (motor >= Motors || !tunedPending[motor].exchange(false, std::memory_order_acquire)) return false;
+
+  const typename Pid::Gains tuned = getGains(motor);
+  gains.kp = static_cast<float>(tuned.kp);
+  gains.ki = static_cast<float>(tuned.ki);
+  gains.kd = static_cast<float>(tuned.kd);
+  return true;
+}
+
+template <typename Calculator, size_t Motors, typename T>
+void SpeedController<Calculator, Motors, T>::stepAutotune(const float *speeds, float *duties) {
+  bool anyRunning = false;
+  for (uint8_t i = 0; i < motorCount; i++) {
+    if (!tuners[i].isRunning()) {
+      duties[i] = 0.0f;
+      continue;
+    }
+
+    // The loop keeps the setpoint while settling, the relay takes over after that
+    const T measurement = T(speeds[i] / maxRpm);
+    const T feedforwardDuty = T(feedforwardFor(i, setpoints[i]));
+    const float loopDuty = static_cast<float>(pids[i].update(T(setpoints[i] / maxRpm), measurement, feedforwardDuty));
+    duties[i] = tuners[i].update(speeds[i] / maxRpm, loopDuty);
+
+    if (tuners[i].isRunning()) {
+      anyRunning = true;
+      continue;
+    }
+
+    duties[i] = 0.0f;
+    setpoints[i] = 0.0f;
+    reportedSetpoints[i].store(0.0f, std::memory_order_relaxed);
+    if (tuners[i].getStatus() == RelayAutotune::Status::DONE) {
+      const RelayAutotune::Gains &tuned = tuners[i].getGains();
+      pids[i].setGains(T(tuned.kp), T(tuned.ki), T(tuned.kd));
+      pids[i].reset(T(0));
+      tunedPending[i].store(true, std::memory_order_release);
+      ESP_LOGI("SpeedController", "Motor %d tuned: Ku=%.3f Tu=%.3f s, kp=%.3f ki=%.3f kd=%.3f", i + 1,
+               tuners[i].getUltimateGain(), tuners[i].getUltimatePeriod(), tuned.kp, tuned.ki, tuned.kd);
+    } else {
+      ESP_LOGE("SpeedController", "Motor %d autotune ended: %s", i + 1,
+               RelayAutotune::statusName(tuners[i].getStatus()));
+    }
+  }
+
+  if (!anyRunning) {
+    setMode(Mode::OPEN_LOOP);
+  }
+}
+
+template <typename Calculator, size_t Motors, typename T>
+bool SpeedController<Calculator, Motors, T>::startFeedforwardSweep(uint8_t motor) {
+  if (mutex == nullptr || motorCount == 0) return false;
+  if (motor != ALL_MOTORS && motor >= motorCount) return false;
+
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  if (!(maxDuty > 0.0f)) {
+    xSemaphoreGive(mutex);
+    return false;
+  }
+
+  const float sweepDuty = maxDuty < FeedforwardTable::MAX_SWEEP_DUTY ? maxDuty : FeedforwardTable::MAX_SWEEP_DUTY;
+  stopRuns();
+  for (uint8_t i = 0; i < motorCount; i++) {
+    setpoints[i] = 0.0f;
+    reportedSetpoints[i].store(0.0f, std::memory_order_relaxed);
+    tablePending[i].store(false, std::memory_order_relaxed);
+    if (motor == ALL_MOTORS || motor == i) {
+      feedforward[i].startSweep(sweepDuty, CONTROL_PERIOD_MS);
+    }
+  }
+  setMode(Mode::FEEDFORWARD_SWEEP);
+  syncError.store(0.0f, std::memory_order_relaxed);
+  xSemaphoreGive(mutex);
+
+  ESP_LOGI("SpeedController", "Feedforward sweep of %s up to %.2f duty",
+           motor == ALL_MOTORS ? "every motor" : "one motor", sweepDuty);
+  return true;
+}
+
+template <typename Calculator, size_t Motors, typename T>
+void SpeedController<Calculator, Motors, T>::stepSweep(const float *speeds, float *duties) {
+  bool anySweeping = false;
+  for (uint8_t i = 0; i < motorCount; i++) {
+    if (!feedforward[i].isSweeping()) {
+      duties[i] = 0.0f;
+      continue;
+    }
+
+    const float current = currentReader != nullptr ? currentReader(i) : 0.0f;
+    duties[i] = feedforward[i].update(speeds[i], current);
+    if (feedforward[i].isSweeping()) {
+      anySweeping = true;
+      continue;
+    }
+
+    duties[i] = 0.0f;
+    if (feedforward[i].getStatus() == FeedforwardTable::Status::READY) {
+      tablePending[i].store(true, std::memory_order_release);
+      ESP_LOGI("SpeedController", "Motor %d feedforward table calibrated, %.0f rpm at %.2f duty", i + 1,
+               feedforward[i].getTable()[FeedforwardTable::POINTS - 1].rpm,
+               feedforward[i].getTable()[FeedforwardTable::POINTS - 1].duty);
+    } else {
+      ESP_LOGE("SpeedController", "Motor %d feedforward sweep failed, the motor did not turn", i + 1);
+    }
+  }
+
+  if (!anySweeping) {
+    setMode(Mode::OPEN_LOOP);
+  }
+}
+
+template <typename Calculator, size_t Motors, typename T>
+bool SpeedController<Calculator, Motors, T>::getFeedforwardTable(uint8_t motor, FeedforwardTable::Point *points) {
+  if (mutex == nullptr || motor >= Motors) return false;
+
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  const bool ready = feedforward[motor].isReady();
+  if (ready) {
+    memcpy(points, feedforward[motor].getTable(), sizeof(FeedforwardTable::Point) * FeedforwardTable::POINTS);
+  }
+  xSemaphoreGive(mutex);
+  return ready;
+}
+
+template <typename Calculator, size_t Motors, typename T>
+bool SpeedController<Calculator, Motors, T>::setFeedforwardTable(uint8_t motor, const FeedforwardTable::Point *points) {
+  if (mutex == nullptr || motor >= Motors) return false;
+
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  const bool installed = feedforward[motor].setTable(points);
+  xSemaphoreGive(mutex);
+  return installed;
+}
+
+template <typename Calculator, size_t Motors, typename T>
+bool SpeedController<Calculator, Motors, T>::takeFeedforwardTable(uint8_t motor, FeedforwardTable::Point *points) {
+  if (motor >= Motors || !tablePending[motor].exchange(false, std::memory_order_acquire)) return false;
+  return getFeedforwardTable(motor, points);
+}
+
+template <typename Calculator, size_t Motors, typename T>
+void SpeedController<Calculator, Motors, T>::setFeedforwardEnabled(bool enable) {
+  if (mutex == nullptr) return;
+
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  if (enable != feedforwardEnabled && mode == Mode::CLOSED_LOOP) {
+    // Move the table's share into or out of the integrator, the duty does not jump
+    for (uint8_t i = 0; i < motorCount; i++) {
+      const float share = enable ? feedforward[i].dutyFor(calculators[i]->getSpeedRpm()) : 0.0f;
+      pids[i].reset(pids[i].getOutput(), T(share));
+    }
+  }
+  feedforwardEnabled = enable;
+  xSemaphoreGive(mutex);
+  ESP_LOGI("SpeedController", "Feedforward %s", enable ? "enabled" : "disabled");
+}
+
+template <typename Calculator, size_t Motors, typename T>
+bool SpeedController<Calculator, Motors, T>::setOpenLoopSpeed(uint8_t motor, float rpm) {
+  if (mutex == nullptr || motorCount == 0) return false;
+  if (motor != ALL_MOTORS && motor >= motorCount) return false;
+  if (!(rpm > 0.0f)) rpm = 0.0f;
+
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  for (uint8_t i = 0; i < motorCount; i++) {
+    if ((motor == ALL_MOTORS || motor == i) && !feedforward[i].isReady()) {
+      xSemaphoreGive(mutex);
+      return false;
+    }
+  }
+
+  stopRuns();
+  setMode(Mode::OPEN_LOOP);
+
+  float duties[Motors];
+  for (uint8_t i = 0; i < output.getChannelCount(); i++) {
+    duties[i] = output.getDuty(i);
+  }
+  for (uint8_t i = 0; i < motorCount; i++) {
+    setpoints[i] = 0.0f;
+    reportedSetpoints[i].store(0.0f, std::memory_order_relaxed);
+    if (motor == ALL_MOTORS || motor == i) {
+      const float duty = feedforward[i].dutyFor(rpm);
+      duties[i] = duty < maxDuty ? duty : maxDuty;
+    }
+  }
+
+  output.setDuties(duties);
+  for (uint8_t i = 0; i < motorCount; i++) {
+    calculators[i]->setDriveDuty(static_cast<uint8_t>(duties[i] * 255.0f + 0.5f));
+    reportedDuties[i].store(duties[i], std::memory_order_relaxed);
+  }
+  syncError.store(0.0f, std::memory_order_relaxed);
+  xSemaphoreGive(mutex);
+  return true;
+}
+
+template <typename Calculator, size_t Motors, typename T>
+float SpeedController<Calculator, Motors, T>::updateSyncError(const float *speeds) {
+  float highestSetpoint = 0.0f;
+  float lowestError = 0.0f;
+  float highestError = 0.0f;
+  for (uint8_t i = 0; i < motorCount; i++) {
+    const float error = setpoints[i] - speeds[i];
+    if (i == 0 || error < lowestError) lowestError = error;
+    if (i == 0 || error > highestError) highestError = error;
+    if (setpoints[i] > highestSetpoint) highestSetpoint = setpoints[i];
+  }
+
+  const float percent = (motorCount > 1 && highestSetpoint > 0.0f) ?
+                        (highestError - lowestError) / highestSetpoint * 100.0f : 0.0f;
+  syncError.store(percent, std::memory_order_relaxed);
+  if (percent > peakSyncError.load(std::memory_order_relaxed)) {
+    peakSyncError.store(percent, std::memory_order_relaxed);
+  }
+  return percent;
+}
+
+template <typename Calculator, size_t Motors, typename T>
+void SpeedController<Calculator, Motors, T>::stepLoop(const float *speeds, float *duties) {
+  updateSyncError(speeds);
+
+  float meanError = 0.0f;
+  for (uint8_t i = 0; i < motorCount; i++) {
+    meanError += setpoints[i] - speeds[i];
+  }
+  meanError /= motorCount;
+
+  for (uint8_t i = 0; i < motorCount; i++) {
+    if (setpoints[i] <= 0.0f) {
+      pids[i].reset(T(0));
+      duties[i] = 0.0f;
+      continue;
+    }
+
+    // The PID sees the coupled error through its setpoint, its derivative stays on the speed.
+    // The feedforward follows the speed the motor should run at.
+    float reference = setpoints[i];
+    float target = setpoints[i];
+    if (syncMode == SyncMode::CROSS_COUPLED) {
+      const float error = setpoints[i] - speeds[i];
+      target = speeds[i] + error + couplingGain * (error - meanError);
+    } else if (syncMode == SyncMode::MASTER_SLAVE && i > 0 && setpoints[0] > 0.0f) {
+      reference = speeds[0] * setpoints[i] / setpoints[0];
+      target = reference;
+    }
+
+    const T setpoint = T(target / maxRpm);
+    const T measurement = T(speeds[i] / maxRpm);
+    duties[i] = static_cast<float>(pids[i].update(setpoint, measurement, T(feedforwardFor(i, reference))));
+  }
+}
+
+template <typename Calculator, size_t Motors, typename T>
+void SpeedController<Calculator, Motors, T>::step() {
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  if (mode == Mode::OPEN_LOOP) {
+    xSemaphoreGive(mutex);
+    return;
+  }
+
+  // Channels without a registered motor keep their duty
+  float duties[Motors];
+  for (uint8_t i = motorCount; i < output.getChannelCount(); i++) {
+    duties[i] = output.getDuty(i);
+  }
+
+  // One reading per motor, every loop and the sync error see the same speeds
+  float speeds[Motors];
+  bool lostFeedback = false;
+  for (uint8_t i = 0; i < motorCount; i++) {
+    speeds[i] = calculators[i]->getSpeedRpm();
+    if (calculators[i]->getFaults() & HallDiagnostics::NO_FEEDBACK) {
+      lostFeedback = true;
+    }
+  }
+
+  if (mode == Mode::AUTOTUNE) {
+    stepAutotune(speeds, duties);
+  } else if (mode == Mode::FEEDFORWARD_SWEEP) {
+    stepSweep(speeds, duties);
+  } else {
+    stepLoop(speeds, duties);
+  }
+
+  if (lostFeedback) {
+    ESP_LOGE("SpeedController", "Hall feedback lost, speed loop opened at zero duty");
+    stopRuns();
+    setMode(Mode::OPEN_LOOP);
+    for (uint8_t i = 0; i < motorCount; i++) {
+      duties[i] = 0.0f;
+      setpoints[i] = 0.0f;
+      reportedSetpoints[i].store(0.0f, std::memory_order_relaxed);
+    }
+    syncError.store(0.0f, std::memory_order_relaxed);
+  }
+
+  output.setDuties(duties);
+  for (uint8_t i = 0; i < motorCount; i++) {
+    calculators[i]->setDriveDuty(static_cast<uint8_t>(duties[i] * 255.0f + 0.5f));
+    reportedDuties[i].store(duties[i], std::memory_order_relaxed);
+  }
+  xSemaphoreGive(mutex);
+}
+
+template <typename Calculator, size_t Motors, typename T>
+void SpeedController<Calculator, Motors, T>::speedControllerTask(void *pvParameters) {
+  SpeedController *controller = static_cast<SpeedController*>(pvParameters);
+  TickType_t lastWake = xTaskGetTickCount();
+  while (1) {
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(CONTROL_PERIOD_MS));
+    controller->step();
+  }
+}
+
+template <typename Calculator, size_t Motors, typename T>
+const char *SpeedController<Calculator, Motors, T>::modeName(Mode mode) {
+  switch (mode) {
+    case Mode::CLOSED_LOOP: return "closed_loop";
+    case Mode::AUTOTUNE: return "autotune";
+    case Mode::FEEDFORWARD_SWEEP: return "feedforward_sweep";
+    default: return "open_loop";
+  }
+}
+
+template <typename Calculator, size_t Motors, typename T>
+const char *SpeedController<Calculator, Motors, T>::syncModeName(SyncMode mode) {
+  switch (mode) {
+    case SyncMode::CROSS_COUPLED: return "cross_coupled";
+    case SyncMode::MASTER_SLAVE: return "master_slave";
+    default: return "independent";
+  }
+}
+
+template <typename Calculator, size_t Motors, typename T>
+bool SpeedController<Calculator, Motors, T>::parseSyncMode(const char *name, SyncMode &mode) {
+  if (name == nullptr) {
+    return false;
+  } else if (strcmp(name, "independent") == 0) {
+    mode = SyncMode::INDEPENDENT;
+  } else if (strcmp(name, "cross_coupled") == 0) {
+    mode = SyncMode::CROSS_COUPLED;
+  } else if (strcmp(name, "master_slave") == 0) {
+    mode = SyncMode::MASTER_SLAVE;
+  } else {
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <nvs.h>
+#include <esp_log.h>
+#include <cstdio>
+#include <cstring>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "RelayAutotune.hpp"
+#include "FeedforwardTable.hpp"
+
+/*
+  Persists the speed loop calibration of every motor to NVS: the autotuned gains and the
+  feedforward table.
+
+  - begin() loads both into the controller, after the controller's begin().
+  - Each is only written when its run completes (autotune or feedforward sweep), one blob per
+    motor and kind, the table under the motor key with FEEDFORWARD_SUFFIX. The store task
+    polls the controller, the control task never touches flash.
+  - Gains set by hand through the API are not stored, a restart returns to the tuned ones.
+
+  Controller must provide takeTunedGains(), setGains(motor, kp, ki, kd),
+  takeFeedforwardTable() and setFeedforwardTable().
+*/
+template <typename Controller, size_t MaxMotors>
+class SpeedGainStore {
+private:
+  static constexpr const char *NVS_NAMESPACE = "speed_gains";
+  static constexpr size_t KEY_LENGTH = 16;   // NVS keys are at most 15 characters
+  static constexpr const char *FEEDFORWARD_SUFFIX = "_ff";
+  static constexpr uint32_t CHECK_INTERVAL_MS = 1000;
+
+  // Tuned gains outside these are a corrupt blob
+  static constexpr float MAX_GAIN = 100.0f;
+
+  Controller &controller;
+  char keys[MaxMotors][KEY_LENGTH];
+  char tableKeys[MaxMotors][KEY_LENGTH];
+  uint8_t motorCount;
+
+  nvs_handle_t nvsHandle;
+  bool opened;
+
+  static bool valid(const RelayAutotune::Gains &gains);
+  void loadTable(uint8_t motor);
+  void save(const char *key, const void *value, size_t length);
+  void saveTuned();
+
+public:
+  explicit SpeedGainStore(Controller &controller);
+
+  // Registers the next motor of the controller under an NVS key before begin(), false when full
+  bool add(const char *key);
+
+  // Loads the stored gains and tables into the controller and starts the store task
+  void begin(TaskHandle_t &, const BaseType_t app_cpu = 1);
+
+  // FreeRTOS
+  static void speedGainStoreTask(void *);
+};
+
+template <typename Controller, size_t MaxMotors>
+SpeedGainStore<Controller, MaxMotors>::SpeedGainStore(Controller &controller) :
+controller(controller),
+motorCount(0),
+nvsHandle(0),
+opened(false)
+{
+  memset(keys, 0, sizeof(keys));
+  memset(tableKeys, 0, sizeof(tableKeys));
+}
+
+template <typename Controller, size_t MaxMotors>
+bool SpeedGainStore<Controller, MaxMotors>::add(const char *key) {
+  if (motorCount >= MaxMotors || key == nullptr || strlen(key) + strlen(FEEDFORWARD_SUFFIX) >= KEY_LENGTH) {
+    ESP_LOGE("SpeedGainStore", "Cannot register gain key %s", key ? key : "(null)");
+    return false;
+  }
+
+  strncpy(keys[motorCount], key, KEY_LENGTH - 1);
+  snprintf(tableKeys[motorCount], KEY_LENGTH, "%s%s", key, FEEDFORWARD_SUFFIX);
+  motorCount++;
+  return true;
+}
+
+template <typename Controller, size_t MaxMotors>
+bool SpeedGainStore<Controller, MaxMotors>::valid(const RelayAutotune::Gains &gains) {
+  return gains.kp >= 0.0f && gains.kp <= MAX_GAIN &&
+         gains.ki >= 0.0f && gains.ki <= MAX_GAIN &&
+         gains.kd >= 0.0f && gains.kd <= MAX_GAIN;
+}
+
+template <typename Controller, size_t MaxMotors>
+void SpeedGainStore<Controller, MaxMotors>::begin(TaskHandle_t &taskHandle, const BaseType_t app_cpu) {
+  const char *TAG = "SpeedGainStore::begin";
+
+  esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvsHandle);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to open NVS namespace %s: %s", NVS_NAMESPACE, esp_err_to_name(err));
+    return;
+  }
+  opened = true;
+
+  for (uint8_t i = 0; i < motorCount; i++) {
+    RelayAutotune::Gains gains;
+    size_t length = sizeof(gains);
+    err = nvs_get_blob(nvsHandle, keys[i], &gains, &length);
+    if (err == ESP_OK && length == sizeof(gains)) {
+      if (valid(gains)) {
+        controller.setGains(i, gains.kp, gains.ki, gains.kd);
+        ESP_LOGI(TAG, "Loaded gains %s", keys[i]);
+      } else {
+        ESP_LOGW(TAG, "Gains %s out of bounds, ignored", keys[i]);
+      }
+    } else if (err != ESP_ERR_NVS_NOT_FOUND) {
+      ESP_LOGW(TAG, "Failed to read %s: %s", keys[i], esp_err_to_name(err));
+    }
+    loadTable(i);
+  }
+
+  if (taskHandle == nullptr) {
+    BaseType_t result = xTaskCreatePinnedToCore(
+      &speedGainStoreTask,
+      "speedGainStoreTask",
+      3072,
+      this,
+      1,
+      &taskHandle,
+      app_cpu
+    );
+
+    if (result == pdPASS) {
+      ESP_LOGI(TAG, "Created the speedGainStoreTask successfully");
+    } else {
+      ESP_LOGE(TAG, "Failed to create the speedGainStoreTask task");
+    }
+  }
+}
+
+template <typename Controller, size_t MaxMotors>
+void SpeedGainStore<Controller, MaxMotors>::loadTable(uint8_t motor) {
+  const char *TAG = "SpeedGainStore::begin";
+
+  FeedforwardTable::Point table[FeedforwardTable::POINTS];
+  size_t length = sizeof(table);
+  esp_err_t err = nvs_get_blob(nvsHandle, tableKeys[motor], table, &length);
+  if (err == ESP_OK && length == sizeof(table)) {
+    if (controller.setFeedforwardTable(motor, table)) {
+      ESP_LOGI(TAG, "Loaded feedforward table %s", tableKeys[motor]);
+    } else {
+      ESP_LOGW(TAG, "Feedforward table %s invalid, ignored", tableKeys[motor]);
+    }
+  } else if (err != ESP_ERR_NVS_NOT_FOUND) {
+    ESP_LOGW(TAG, "Failed to read %s: %s", tableKeys[motor], esp_err_to_name(err));
+  }
+}
+
+template <typename Controller, size_t MaxMotors>
+void SpeedGainStore<Controller, MaxMotors>::save(const char *key, const void *value, size_t length) {
+  esp_err_t err = nvs_set_blob(nvsHandle, key, value, length);
+  if (err == ESP_OK) {
+    err = nvs_commit(nvsHandle);
+  }
+  if (err != ESP_OK) {
+    ESP_LOGE("SpeedGainStore", "Failed to save %s: %s", key, esp_err_to_name(err));
+  } else {
+    ESP_LOGI("SpeedGainStore", "Saved %s", key);
+  }
+}
+
+template <typename Controller, size_t MaxMotors>
+void SpeedGainStore<Controller, MaxMotors>::saveTuned() {
+  if (!opened) return;
+
+  for (uint8_t i = 0; i < motorCount; i++) {
+    RelayAutotune::Gains gains;
+    if (controller.takeTunedGains(i, gains)) {
+      save(keys[i], &gains, sizeof(gains));
+    }
+
+    FeedforwardTable::Point table[FeedforwardTable::POINTS];
+    if (controller.takeFeedforwardTable(i, table)) {
+      save(tableKeys[i], table, sizeof(table));
+    }
+  }
+}
+
+template <typename Controller, size_t MaxMotors>
+void SpeedGainStore<Controller, MaxMotors>::speedGainStoreTask(void *pvParameters) {
+  SpeedGainStore *store = static_cast<SpeedGainStore*>(pvParameters);
+  while (1) {
+    vTaskDelay(pdMS_TO_TICKS(CHECK_INTERVAL_MS));
+    store->saveTuned();
+  }
+}
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <driver/gpio.h>
+#include <hal/gpio_ll.h>
+#include <soc/gpio_struct.h>
+#include <esp_log.h>
+#include "esp_timer.h"
+#include "EdgeClock.hpp"
+#include "CaptureBackend.hpp"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/*
+  Owns the feedback inputs of every speed sensor.
+
+  - One raw GPIO interrupt (gpio_isr_register) for all GPIO_ISR channels instead of one
+    gpio_isr_handler_add trampoline per pin. The ISR reads the status registers once, takes
+    one timestamp and walks the pending bits through a struct-of-arrays dispatch table.
+  - One task services every calculator in a single pass instead of one task per motor.
+  - MCPWM capture channels keep their own capture callback but notify the same task.
+
+  The raw interrupt replaces the gpio ISR service, no other code may call
+  gpio_install_isr_service() once the bank is running.
+  Calculator must provide attach(), calculateValuesInternal(), motorSpeed(),
+  getIdleTimeoutTicks(), getFeedBackPin() and getCaptureBackend().
+*/
+template <typename Calculator, size_t MaxChannels>
+class SpeedSensorBank {
+private:
+  static_assert(MaxChannels > 0 && MaxChannels <= 16, "Bank holds between 1 and 16 channels");
+
+  static constexpr uint32_t IDLE_TIMEOUT_MS = 100;
+  static constexpr int8_t NO_CHANNEL = -1;
+
+  // Dispatch table, struct-of-arrays: the ISR only walks dispatchMask and channelOfPin
+  Calculator *calculators[MaxChannels];
+  gpio_num_t pins[MaxChannels];
+  uint8_t channelCount;
+  uint64_t dispatchMask;
+  int8_t channelOfPin[GPIO_NUM_MAX];
+
+  gpio_isr_handle_t isrHandle;
+
+#ifdef SPEED_ISR_PROFILING
+  IsrCycleProfile isrProfile;
+  static constexpr uint32_t PROFILE_REPORT_US = 5000000;
+#endif
+
+public:
+  SpeedSensorBank();
+
+  // Registers a calculator before begin(), false when the bank is full or the pin is taken
+  bool add(Calculator &calculator);
+  void begin(TaskHandle_t &, const BaseType_t app_cpu = 1);
+
+  inline uint8_t getChannelCount() const { return channelCount; }
+
+  // FreeRTOS
+  static void speedSensorTask(void *);
+  static void staticDispatchIsr(void *);
+};
+
+template <typename Calculator, size_t MaxChannels>
+SpeedSensorBank<Calculator, MaxChannels>::SpeedSensorBank() :
+channelCount(0),
+dispatchMask(0),
+isrHandle(nullptr)
+{
+  for (size_t i = 0; i < MaxChannels; i++) {
+    calculators[i] = nullptr;
+    pins[i] = GPIO_NUM_NC;
+  }
+  for (size_t pin = 0; pin < GPIO_NUM_MAX; pin++) {
+    channelOfPin[pin] = NO_CHANNEL;
+  }
+}
+
+template <typename Calculator, size_t MaxChannels>
+bool SpeedSensorBank<Calculator, MaxChannels>::add(Calculator &calculator) {
+  const char *TAG = "SpeedSensorBank::add";
+  const gpio_num_t pin = calculator.getFeedBackPin();
+
+  if (pin == GPIO_NUM_NC) return false; // Skip if pin not configured
+
+  if (channelCount >= MaxChannels) {
+    ESP_LOGE(TAG, "No free channel for GPIO %d", pin);
+    return false;
+  }
+  if (channelOfPin[pin] != NO_CHANNEL) {
+    ESP_LOGE(TAG, "GPIO %d already belongs to channel %d", pin, channelOfPin[pin]);
+    return false;
+  }
+
+  calculators[channelCount] = &calculator;
+  pins[channelCount] = pin;
+  channelOfPin[pin] = channelCount;
+  channelCount++;
+  return true;
+}
+
+template <typename Calculator, size_t MaxChannels>
+void SpeedSensorBank<Calculator, MaxChannels>::begin(TaskHandle_t &taskHandle, const BaseType_t app_cpu) {
+  const char *TAG = "SpeedSensorBank::begin";
+
+  if (channelCount == 0) return;
+
+  // The task has to exist before the first edge tries to notify it
+  if (taskHandle == nullptr) {
+    BaseType_t result = xTaskCreatePinnedToCore(
+      &speedSensorTask,
+      "speedSensorTask",
+      3072,
+      this,
+      1,
+      &taskHandle,
+      app_cpu
+    );
+
+    if (result == pdPASS) {
+      ESP_LOGI(TAG, "Created the speedSensorTask successfully for %d channels", channelCount);
+    } else {
+      ESP_LOGE(TAG, "Failed to create the speedSensorTask task");
+      return;
+    }
+  }
+
+  for (uint8_t channel = 0; channel < channelCount; channel++) {
+    Calculator *calculator = calculators[channel];
+    if (!calculator->attach(taskHandle)) continue;
+
+    // MCPWM channels have their own capture callback, the rest go through the shared ISR
+    if (calculator->getCaptureBackend() == CaptureBackend::GPIO_ISR) {
+      dispatchMask |= (1ULL << pins[channel]);
+    }
+  }
+
+  if (dispatchMask != 0) {
+    // Registered from this task, the interrupt is routed to the core running setup()
+    ESP_ERROR_CHECK(gpio_isr_register(staticDispatchIsr, this, 0, &isrHandle));
+  }
+}
+
+template <typename Calculator, size_t MaxChannels>
+void IRAM_ATTR SpeedSensorBank<Calculator, MaxChannels>::staticDispatchIsr(void *args) {
+#ifdef SPEED_ISR_PROFILING
+  const uint32_t startCycles = esp_cpu_get_cycle_count();
+#endif
+
+  SpeedSensorBank *bank = static_cast<SpeedSensorBank*>(args);
+
+  // One timestamp for every edge served by this interrupt
+  const uint32_t timeStamp = EdgeClock::now();
+  const uint32_t core = xPortGetCoreID();
+
+  uint32_t statusLow = 0;
+  uint32_t statusHigh = 0;
+  gpio_ll_get_intr_status(&GPIO, core, &statusLow);
+  gpio_ll_get_intr_status_high(&GPIO, core, &statusHigh);
+
+  // Clear before dispatching, an edge arriving meanwhile raises the interrupt again
+  gpio_ll_clear_intr_status(&GPIO, statusLow);
+  gpio_ll_clear_intr_status_high(&GPIO, statusHigh);
+
+  uint64_t pending = ((static_cast<uint64_t>(statusHigh) << 32) | statusLow) & bank->dispatchMask;
+  BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+  while (pending != 0) {
+    const uint8_t pin = __builtin_ctzll(pending);
+    pending &= pending - 1;
+
+    if (bank->calculators[bank->channelOfPin[pin]]->calculateValuesInternal(timeStamp) == pdTRUE) {
+      higherPriorityTaskWoken = pdTRUE;
+    }
+  }
+
+#ifdef SPEED_ISR_PROFILING
+  bank->isrProfile.record(esp_cpu_get_cycle_count() - startCycles);
+#endif
+
+  if (higherPriorityTaskWoken == pdTRUE) {
+    portYIELD_FROM_ISR();
+  }
+}
+
+template <typename Calculator, size_t MaxChannels>
+void SpeedSensorBank<Calculator, MaxChannels>::speedSensorTask(void *pvParameters) {
+  SpeedSensorBank *bank = static_cast<SpeedSensorBank*>(pvParameters);
+#ifdef SPEED_ISR_PROFILING
+  uint32_t lastProfileReport = static_cast<uint32_t>(esp_timer_get_time());
+#endif
+  while (1) {
+    // Woken by any channel, every channel is serviced in one pass.
+    // Without edges the task sleeps until the channel with the shortest standstill check is due.
+    TickType_t timeout = pdMS_TO_TICKS(IDLE_TIMEOUT_MS);
+    for (uint8_t channel = 0; channel < bank->channelCount; channel++) {
+      const TickType_t channelTimeout = bank->calculators[channel]->getIdleTimeoutTicks();
+      if (channelTimeout < timeout) {
+        timeout = channelTimeout;
+      }
+    }
+
+    ulTaskNotifyTake(pdTRUE, timeout);
+    for (uint8_t channel = 0; channel < bank->channelCount; channel++) {
+      bank->calculators[channel]->motorSpeed();
+    }
+
+#ifdef SPEED_ISR_PROFILING
+    if (static_cast<uint32_t>(esp_timer_get_time()) - lastProfileReport > PROFILE_REPORT_US) {
+      lastProfileReport = static_cast<uint32_t>(esp_timer_get_time());
+      bank->isrProfile.report("staticDispatchIsr");
+    }
+#endif
+  }
+}
@@ -2,9 +2,16 @@
 
 // Object Instantiation
 PwmGenerator motorPWM1(motorPwmPin1, frequency, resolution);
-PwmGenerator motorPWM2(motorPwmPin2, frequency, resolution);
-BLDCPulseCalculator motorPulse1(feedBackPin1, motorId1);
-BLDCPulseCalculator motorPulse2(feedBackPin2, motorId2);
+PwmGenerator motorPWM2(motorPwmPin2, motorPWM1);   // Shares the motor 1 timer, phase aligned
+MotorPwmGroup motorPWMGroup;
+MotorPulseCalculator motorPulse1(feedBackPin1, motorId1, speedCaptureBackend);
+MotorPulseCalculator motorPulse2(feedBackPin2, motorId2, speedCaptureBackend);
+MotorSpeedSensorBank speedSensors;
+MotorOdometryStore odometryStore;
+EdgeRecorder edgeRecorder;
+MotorSectorCalibrationStore sectorCalibrationStore;
+MotorSpeedController motorSpeedController(motorPWMGroup, maxMotorRpm);
+MotorSpeedGainStore speedGainStore(motorSpeedController);
 MotorDirection direction;
 DoorLock doorLock(doorLock1Pin, doorLock2Pin, doorLock3Pin, doorLock4Pin);
 UARTCurrentSensor currentSensor;
@@ -14,10 +21,11 @@ DataCollector dataCollector;
 ControlInterface controlInterface;
 
 // Task Handles
-TaskHandle_t motor1SpeedTaskHandle = nullptr;
-TaskHandle_t motor2SpeedTaskHandle = nullptr;
-TaskHandle_t motor1PWMTaskHandle = nullptr;
-TaskHandle_t motor2PWMTaskHandle = nullptr;
+TaskHandle_t speedSensorTaskHandle = nullptr;
+TaskHandle_t odometryStoreTaskHandle = nullptr;
+TaskHandle_t sectorCalibrationStoreTaskHandle = nullptr;
+TaskHandle_t speedControllerTaskHandle = nullptr;
+TaskHandle_t speedGainStoreTaskHandle = nullptr;
 TaskHandle_t currentSensorTaskHandle = nullptr;
 TaskHandle_t dataCollectorTaskHandle = nullptr;
 TaskHandle_t webSocketTaskHandle = nullptr;
@@ -48,11 +56,14 @@ void addMotorControlAPI() {
             }
             
             // Process motor control commands
+            // Slider moves ramp at the configured slope, "ramp_ms" overrides it
+            if (doc.containsKey("ramp_slope")) {
+                controlInterface.setRampSlope(doc["ramp_slope"].as<uint32_t>());
+            }
             if (doc.containsKey("pwm")) {
                 uint8_t pwm = doc["pwm"];
-                motorPWM1.setPwm(pwm);
-                motorPWM2.setPwm(pwm);
-                currentPWM = pwm;
+                int32_t rampMs = doc["ramp_ms"] | -1;
+                controlInterface.setPWM(pwm, rampMs);
             }
             
             if (doc.containsKey("lights")) {
@@ -81,6 +92,306 @@ void addMotorControlAPI() {
         }
     });
     
+    // Odometry reset endpoint - {"motor": 1|2}, both motors without a body
+    server->on("/api/motor/odometry/reset", HTTP_POST, [server]() {
+        uint8_t motor = 0;
+        if (server->hasArg("plain")) {
+            DynamicJsonDocument doc(256);
+            DeserializationError error = deserializeJson(doc, server->arg("plain"));
+            
+            if (error) {
+                server->sendHeader("Access-Control-Allow-Origin", "*");
+                server->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
+                return;
+            }
+            motor = doc["motor"] | 0;
+        }
+        
+        if (motor > 2) {
+            server->sendHeader("Access-Control-Allow-Origin", "*");
+            server->send(400, "application/json", "{\"error\":\"Unknown motor\"}");
+            return;
+        }
+        
+        if (motor == 0 || motor == 1) motorPulse1.resetOdometry();
+        if (motor == 0 || motor == 2) motorPulse2.resetOdometry();
+        odometryStore.requestSave();
+        
+        server->sendHeader("Access-Control-Allow-Origin", "*");
+        server->send(200, "application/json", "{\"status\":\"ok\"}");
+    });
+    
+    // Closed-loop speed - {"rpm": n} for both motors or with "motor": 1|2 for one,
+    // {"kp", "ki", "kd"} retunes, {"sync": "independent"|"cross_coupled"|"master_slave"} and
+    // {"coupling_gain": k} set the synchronization, {"enabled": false} opens the loop.
+    // A PWM command opens it too. {"rpm": n, "open_loop": true} sets the duty from the
+    // feedforward table instead, {"feedforward": bool} switches the table in the loop.
+    server->on("/api/motor/speed", HTTP_POST, [server]() {
+        if (!server->hasArg("plain")) {
+            server->sendHeader("Access-Control-Allow-Origin", "*");
+            server->send(400, "application/json", "{\"error\":\"No data received\"}");
+            return;
+        }
+        
+        DynamicJsonDocument doc(256);
+        DeserializationError error = deserializeJson(doc, server->arg("plain"));
+        uint8_t motor = doc["motor"] | 0;
+        if (error || motor > 2) {
+            server->sendHeader("Access-Control-Allow-Origin", "*");
+            server->send(400, "application/json", "{\"error\":\"Invalid speed request\"}");
+            return;
+        }
+        
+        if (doc.containsKey("kp") || doc.containsKey("ki") || doc.containsKey("kd")) {
+            MotorSpeedController::Pid::Gains gains = motorSpeedController.getGains();
+            float kp = gains.kp;
+            float ki = gains.ki;
+            float kd = gains.kd;
+            motorSpeedController.setGains(doc["kp"] | kp, doc["ki"] | ki, doc["kd"] | kd);
+        }
+        
+        if (doc.containsKey("sync")) {
+            MotorSpeedController::SyncMode mode;
+            if (!MotorSpeedController::parseSyncMode(doc["sync"].as<const char*>(), mode)) {
+                server->sendHeader("Access-Control-Allow-Origin", "*");
+                server->send(400, "application/json", "{\"error\":\"Unknown sync mode\"}");
+                return;
+            }
+            motorSpeedController.setSyncMode(mode);
+        }
+        
+        if (doc.containsKey("coupling_gain")) {
+            motorSpeedController.setCouplingGain(doc["coupling_gain"].as<float>());
+        }
+        
+        if (doc.containsKey("feedforward")) {
+            motorSpeedController.setFeedforwardEnabled(doc["feedforward"].as<bool>());
+        }
+        
+        if (doc.containsKey("rpm") && (doc["open_loop"] | false)) {
+            uint8_t target = motor == 0 ? MotorSpeedController::ALL_MOTORS : static_cast<uint8_t>(motor - 1);
+            if (!motorSpeedController.setOpenLoopSpeed(target, doc["rpm"].as<float>())) {
+                server->sendHeader("Access-Control-Allow-Origin", "*");
+                server->send(409, "application/json", "{\"error\":\"No feedforward table\"}");
+                return;
+            }
+        } else if (doc.containsKey("rpm")) {
+            float rpm = doc["rpm"].as<float>();
+            if (motor == 0) {
+                motorSpeedController.setSpeed(rpm);
+            } else {
+                motorSpeedController.setSpeed(static_cast<uint8_t>(motor - 1), rpm);
+            }
+        } else if (doc.containsKey("enabled") && !doc["enabled"].as<bool>()) {
+            motorSpeedController.disable();
+        }
+        
+        server->sendHeader("Access-Control-Allow-Origin", "*");
+        server->send(200, "application/json", String("{\"status\":\"") + MotorSpeedController::modeName(motorSpeedController.getMode()) + "\"}");
+    });
+    
+    // Relay autotune - {"rpm": n}, optional "motor": 1|2 (both without), "amplitude" (duty),
+    // "timeout_ms" and "rule". Tuned gains are applied and saved to NVS once it completes.
+    server->on("/api/motor/autotune", HTTP_POST, [server]() {
+        DynamicJsonDocument doc(256);
+        if (!server->hasArg("plain") || deserializeJson(doc, server->arg("plain")) || !doc.containsKey("rpm")) {
+            server->sendHeader("Access-Control-Allow-Origin", "*");
+            server->send(400, "application/json", "{\"error\":\"Invalid autotune request\"}");
+            return;
+        }
+        
+        uint8_t motor = doc["motor"] | 0;
+        float rpm = doc["rpm"].as<float>();
+        float amplitude = doc["amplitude"] | autotuneAmplitude;
+        uint32_t timeoutMs = doc["timeout_ms"] | autotuneTimeoutMs;
+        RelayAutotune::Rule rule = RelayAutotune::Rule::TYREUS_LUYBEN_PI;
+        if (motor > 2 || (doc.containsKey("rule") && !RelayAutotune::parseRule(doc["rule"].as<const char*>(), rule))) {
+            server->sendHeader("Access-Control-Allow-Origin", "*");
+            server->send(400, "application/json", "{\"error\":\"Invalid autotune request\"}");
+            return;
+        }
+        
+        uint8_t target = motor == 0 ? MotorSpeedController::ALL_MOTORS : static_cast<uint8_t>(motor - 1);
+        if (!motorSpeedController.startAutotune(target, rpm, amplitude, rule, timeoutMs)) {
+            server->sendHeader("Access-Control-Allow-Origin", "*");
+            server->send(409, "application/json", "{\"error\":\"Autotune could not start\"}");
+            return;
+        }
+        
+        server->sendHeader("Access-Control-Allow-Origin", "*");
+        server->send(200, "application/json", "{\"status\":\"started\"}");
+    });
+    
+    // Sector calibration - {"motor": 1|2, "revolutions": n}, both motors without a motor.
+    // Run it at a steady speed, the learned table is saved to NVS once complete.
+    server->on("/api/motor/calibration/sectors", HTTP_POST, [server]() {
+        uint8_t motor = 0;
+        uint16_t revolutions = sectorCalibrationRevolutions;
+        if (server->hasArg("plain")) {
+            DynamicJsonDocument doc(256);
+            DeserializationError error = deserializeJson(doc, server->arg("plain"));
+            
+            if (error) {
+                server->sendHeader("Access-Control-Allow-Origin", "*");
+                server->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
+                return;
+            }
+            motor = doc["motor"] | 0;
+            revolutions = doc["revolutions"] | revolutions;
+        }
+        
+        if (motor > 2) {
+            server->sendHeader("Access-Control-Allow-Origin", "*");
+            server->send(400, "application/json", "{\"error\":\"Unknown motor\"}");
+            return;
+        }
+        
+        if (motor == 0 || motor == 1) motorPulse1.startSectorCalibration(revolutions);
+        if (motor == 0 || motor == 2) motorPulse2.startSectorCalibration(revolutions);
+        
+        server->sendHeader("Access-Control-Allow-Origin", "*");
+        server->send(200, "application/json", "{\"status\":\"learning\"}");
+    });
+    
+    // Feedforward sweep - {"motor": 1|2}, both motors without a motor. Ramps up to the loop's max
+    // duty (at most 90 %) and steps down from there, the motors must be free to turn. The tables
+    // are saved to NVS once complete.
+    server->on("/api/motor/calibration/feedforward", HTTP_POST, [server]() {
+        uint8_t motor = 0;
+        if (server->hasArg("plain")) {
+            DynamicJsonDocument doc(256);
+            DeserializationError error = deserializeJson(doc, server->arg("plain"));
+            
+            if (error) {
+                server->sendHeader("Access-Control-Allow-Origin", "*");
+                server->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
+                return;
+            }
+            motor = doc["motor"] | 0;
+        }
+        
+        if (motor > 2) {
+            server->sendHeader("Access-Control-Allow-Origin", "*");
+            server->send(400, "application/json", "{\"error\":\"Unknown motor\"}");
+            return;
+        }
+        
+        uint8_t target = motor == 0 ? MotorSpeedController::ALL_MOTORS : static_cast<uint8_t>(motor - 1);
+        server->sendHeader("Access-Control-Allow-Origin", "*");
+        if (!motorSpeedController.startFeedforwardSweep(target)) {
+            server->send(409, "application/json", "{\"error\":\"Sweep could not start\"}");
+            return;
+        }
+        server->send(200, "application/json", "{\"status\":\"sweeping\"}");
+    });
+    
+    // Installed feedforward tables, duty/rpm/current per point in ascending duty
+    server->on("/api/motor/calibration/feedforward", HTTP_GET, [server]() {
+        DynamicJsonDocument doc(4096);
+        for (uint8_t motor = 0; motor < 2; motor++) {
+            JsonObject entry = doc.createNestedObject(motor == 0 ? "motor1" : "motor2");
+            entry["status"] = FeedforwardTable::statusName(motorSpeedController.getFeedforwardStatus(motor));
+            
+            FeedforwardTable::Point table[FeedforwardTable::POINTS];
+            if (!motorSpeedController.getFeedforwardTable(motor, table)) continue;
+            
+            JsonArray points = entry.createNestedArray("points");
+            for (uint8_t i = 0; i < FeedforwardTable::POINTS; i++) {
+                JsonObject point = points.createNestedObject();
+                point["duty"] = table[i].duty;
+                point["rpm"] = table[i].rpm;
+                point["current"] = table[i].current;
+            }
+        }
+        String response;
+        serializeJson(doc, response);
+        
+        server->sendHeader("Access-Control-Allow-Origin", "*");
+        server->send(200, "application/json", response);
+    });
+    
+    // Clears the latched Hall faults, the ones still active stay latched
+    server->on("/api/motor/diagnostics/clear", HTTP_POST, [server]() {
+        motorPulse1.clearFaults();
+        motorPulse2.clearFaults();
+        server->sendHeader("Access-Control-Allow-Origin", "*");
+        server->send(200, "application/json", "{\"status\":\"ok\"}");
+    });
+    
+    // Raw edge capture - {"trigger": "manual"|"speed_above"|"speed_difference", "threshold": rpm, "duration_ms": n}
+    server->on("/api/capture/arm", HTTP_POST, [server]() {
+        EdgeRecorder::Trigger trigger = EdgeRecorder::Trigger::MANUAL;
+        float threshold = 0.0f;
+        uint32_t durationMs = EdgeRecorder::DEFAULT_DURATION_MS;
+        if (server->hasArg("plain")) {
+            DynamicJsonDocument doc(256);
+            DeserializationError error = deserializeJson(doc, server->arg("plain"));
+            
+            if (error || !EdgeRecorder::parseTrigger(doc["trigger"] | "manual", trigger)) {
+                server->sendHeader("Access-Control-Allow-Origin", "*");
+                server->send(400, "application/json", "{\"error\":\"Invalid capture request\"}");
+                return;
+            }
+            threshold = doc["threshold"] | 0.0f;
+            durationMs = doc["duration_ms"] | durationMs;
+        }
+        
+        server->sendHeader("Access-Control-Allow-Origin", "*");
+        if (!edgeRecorder.arm(trigger, threshold, durationMs)) {
+            server->send(409, "application/json", "{\"error\":\"Capture busy or unavailable\"}");
+            return;
+        }
+        server->send(200, "application/json", "{\"status\":\"armed\"}");
+    });
+    
+    server->on("/api/capture/stop", HTTP_POST, [server]() {
+        edgeRecorder.stop();
+        server->sendHeader("Access-Control-Allow-Origin", "*");
+        server->send(200, "application/json", "{\"status\":\"ok\"}");
+    });
+    
+    server->on("/api/capture/status", HTTP_GET, [server]() {
+        DynamicJsonDocument doc(512);
+        doc["state"] = EdgeRecorder::stateName(edgeRecorder.getState());
+        doc["capacity"] = edgeRecorder.getEdgesPerChannel();
+        doc["psram"] = edgeRecorder.isInPsram();
+        JsonArray edges = doc.createNestedArray("edges");
+        for (uint8_t channel = 0; channel < edgeRecorder.getChannelCount(); channel++) {
+            edges.add(edgeRecorder.getEdgeCount(channel));
+        }
+        String response;
+        serializeJson(doc, response);
+        
+        server->sendHeader("Access-Control-Allow-Origin", "*");
+        server->send(200, "application/json", response);
+    });
+    
+    // Binary download of a finished capture, layout in EdgeRecorder.hpp
+    server->on("/api/capture/download", HTTP_GET, [server]() {
+        server->sendHeader("Access-Control-Allow-Origin", "*");
+        if (edgeRecorder.getState() != EdgeRecorder::State::DONE) {
+            server->send(409, "application/json", "{\"error\":\"No finished capture\"}");
+            return;
+        }
+        
+        server->sendHeader("Content-Disposition", "attachment; filename=\"edges.bin\"");
+        server->setContentLength(edgeRecorder.getDownloadSize());
+        server->send(200, "application/octet-stream", "");
+        
+        EdgeRecorder::FileHeader header;
+        edgeRecorder.fillHeader(header);
+        server->sendContent(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (uint8_t channel = 0; channel < edgeRecorder.getChannelCount(); channel++) {
+            EdgeRecorder::ChannelHeader channelHeader;
+            edgeRecorder.fillChannelHeader(channel, channelHeader);
+            server->sendContent(reinterpret_cast<const char*>(&channelHeader), sizeof(channelHeader));
+        }
+        for (uint8_t channel = 0; channel < edgeRecorder.getChannelCount(); channel++) {
+            server->sendContent(reinterpret_cast<const char*>(edgeRecorder.getEdges(channel)),
+                                edgeRecorder.getEdgeCount(channel) * sizeof(uint32_t));
+        }
+    });
+    
     // CORS for motor endpoints
     server->on("/api/motor/status", HTTP_OPTIONS, [server]() {
         server->sendHeader("Access-Control-Allow-Origin", "*");
@@ -95,6 +406,62 @@ void addMotorControlAPI() {
         server->sendHeader("Access-Control-Allow-Headers", "Content-Type");
         server->send(200);
     });
+    
+    server->on("/api/motor/odometry/reset", HTTP_OPTIONS, [server]() {
+        server->sendHeader("Access-Control-Allow-Origin", "*");
+        server->sendHeader("Access-Control-Allow-Methods", "POST, OPTIONS");
+        server->sendHeader("Access-Control-Allow-Headers", "Content-Type");
+        server->send(200);
+    });
+    
+    server->on("/api/motor/speed", HTTP_OPTIONS, [server]() {
+        server->sendHeader("Access-Control-Allow-Origin", "*");
+        server->sendHeader("Access-Control-Allow-Methods", "POST, OPTIONS");
+        server->sendHeader("Access-Control-Allow-Headers", "Content-Type");
+        server->send(200);
+    });
+    
+    server->on("/api/motor/autotune", HTTP_OPTIONS, [server]() {
+        server->sendHeader("Access-Control-Allow-Origin", "*");
+        server->sendHeader("Access-Control-Allow-Methods", "POST, OPTIONS");
+        server->sendHeader("Access-Control-Allow-Headers", "Content-Type");
+        server->send(200);
+    });
+    
+    server->on("/api/motor/calibration/feedforward", HTTP_OPTIONS, [server]() {
+        server->sendHeader("Access-Control-Allow-Origin", "*");
+        server->sendHeader("Access-Control-Allow-Methods", "GET, POST, OPTIONS");
+        server->sendHeader("Access-Control-Allow-Headers", "Content-Type");
+        server->send(200);
+    });
+    
+    server->on("/api/motor/calibration/sectors", HTTP_OPTIONS, [server]() {
+        server->sendHeader("Access-Control-Allow-Origin", "*");
+        server->sendHeader("Access-Control-Allow-Methods", "POST, OPTIONS");
+        server->sendHeader("Access-Control-Allow-Headers", "Content-Type");
+        server->send(200);
+    });
+    
+    server->on("/api/motor/diagnostics/clear", HTTP_OPTIONS, [server]() {
+        server->sendHeader("Access-Control-Allow-Origin", "*");
+        server->sendHeader("Access-Control-Allow-Methods", "POST, OPTIONS");
+        server->sendHeader("Access-Control-Allow-Headers", "Content-Type");
+        server->send(200);
+    });
+    
+    server->on("/api/capture/arm", HTTP_OPTIONS, [server]() {
+        server->sendHeader("Access-Control-Allow-Origin", "*");
+        server->sendHeader("Access-Control-Allow-Methods", "POST, OPTIONS");
+        server->sendHeader("Access-Control-Allow-Headers", "Content-Type");
+        server->send(200);
+    });
+    
+    server->on("/api/capture/stop", HTTP_OPTIONS, [server]() {
+        server->sendHeader("Access-Control-Allow-Origin", "*");
+        server->sendHeader("Access-Control-Allow-Methods", "POST, OPTIONS");
+        server->sendHeader("Access-Control-Allow-Headers", "Content-Type");
+        server->send(200);
+    });
 }
 
 void setup() {
@@ -141,15 +508,40 @@ void setup() {
     Serial.println("✓ Lights GPIO initialized");
     
     // Initialize PWM Generators (Core 0 - Motor Control)
-    motorPWM1.begin(motor1PWMTaskHandle, app_cpu0);
-    motorPWM2.begin(motor2PWMTaskHandle, app_cpu0);
-    Serial.println("✓ PWM generators initialized on Core 0");
+    motorPWM1.begin();
+    motorPWM2.begin();
+    motorPWMGroup.add(motorPWM1);
+    motorPWMGroup.add(motorPWM2);
+    motorPWMGroup.begin();
+    Serial.println("✓ PWM generators initialized");
     
     // Initialize Speed Calculators (Core 1 - Processing)
-    motorPulse1.begin(motor1SpeedTaskHandle, app_cpu1);
-    motorPulse2.begin(motor2SpeedTaskHandle, app_cpu1);
+    motorPulse1.setEdgeRecorder(edgeRecorder);
+    motorPulse2.setEdgeRecorder(edgeRecorder);
+    edgeRecorder.begin();
+    sectorCalibrationStore.add(motorPulse1, "motor1");
+    sectorCalibrationStore.add(motorPulse2, "motor2");
+    sectorCalibrationStore.begin(sectorCalibrationStoreTaskHandle, app_cpu1);
+    speedSensors.add(motorPulse1);
+    speedSensors.add(motorPulse2);
+    speedSensors.begin(speedSensorTaskHandle, app_cpu1);
+    odometryStore.add(motorPulse1, "motor1");
+    odometryStore.add(motorPulse2, "motor2");
+    odometryStore.begin(odometryStoreTaskHandle, app_cpu1);
     Serial.println("✓ Speed calculators initialized on Core 1");
     
+    // Closed-loop speed control, idle until a speed setpoint arrives (Core 0 - Motor Control)
+    motorSpeedController.add(motorPulse1);
+    motorSpeedController.add(motorPulse2);
+    motorSpeedController.setCurrentReader([](uint8_t motor) {
+        return motor == 0 ? currentSensor.getCurrent1() : currentSensor.getCurrent2();
+    });
+    motorSpeedController.begin(speedControllerTaskHandle, app_cpu0);
+    speedGainStore.add("motor1");
+    speedGainStore.add("motor2");
+    speedGainStore.begin(speedGainStoreTaskHandle, app_cpu1);
+    Serial.println("✓ Speed controller initialized on Core 0");
+    
     // Initialize Door Lock System (Core 0 - Hardware Control)
     doorLock.begin();
     Serial.println("✓ Door lock system initialized");
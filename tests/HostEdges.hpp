@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include "esp_timer.h"
+#include "driver/mcpwm_cap.h"
+
+/*
+  Simulated Hall feedback for the speed calculators.
+
+  - hostEdge() raises one edge at a simulated time, through the same ISR entry point the GPIO
+    interrupt uses, then lets the speed task process it.
+  - hostCaptureEdge() does the same through the MCPWM capture callback, with the capture
+    counter at hostMcpwmResolutionHz.
+  - Times are doubles in microseconds so edge streams keep their sub-microsecond phase, the
+    capture sees them at the resolution of the stubbed clock.
+*/
+template <typename Calculator>
+inline void hostEdge(Calculator &calculator, double micros, bool runTask = true) {
+  hostTimeMicros = static_cast<int64_t>(micros);
+  Calculator::staticCalculateValuesWrapper(&calculator);
+  if (runTask) {
+    calculator.motorSpeed();
+  }
+}
+
+inline void hostCaptureEdge(double micros) {
+  hostTimeMicros = static_cast<int64_t>(micros);
+  mcpwm_capture_event_data_t event = {};
+  event.cap_value = static_cast<uint32_t>(static_cast<uint64_t>(micros * (hostMcpwmResolutionHz / 1.0e6)));
+  hostMcpwmCallback(nullptr, &event, hostMcpwmCallbackArg);
+}
+
+template <typename Calculator>
+inline void hostCaptureEdge(Calculator &calculator, double micros, bool runTask = true) {
+  hostCaptureEdge(micros);
+  if (runTask) {
+    calculator.motorSpeed();
+  }
+}
+
+// Edge period in microseconds of a motor with edgesPerRevolution edges at rpm
+inline double hostEdgePeriod(double rpm, uint32_t edgesPerRevolution) {
+  return 60.0e6 / (rpm * edgesPerRevolution);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+  Simulated hub motor for the speed loop tests, and the calculator interface the
+  SpeedController reads it through.
+
+  - First order: the speed settles towards a steady speed with time constant TAU_S. The
+    steady speed is zero below the DEADBAND_DUTY stall duty, linear up to FULL_RPM at full
+    duty, less the load in rpm.
+  - The controller's duties reach it through step(), the test's model of the world between
+    two control periods. getFaults() reports a healthy sensor.
+*/
+struct HostMotor {
+  static constexpr float DEADBAND_DUTY = 0.36f;
+  static constexpr float FULL_RPM = 535.0f;
+  static constexpr float TAU_S = 0.3f;
+
+  float rpm = 0.0f;
+  float load = 0.0f;       // rpm lost at any duty
+
+  float steadyRpm(float duty) const {
+    if (duty < DEADBAND_DUTY) return 0.0f;
+    const float steady = (duty - DEADBAND_DUTY) / (1.0f - DEADBAND_DUTY) * FULL_RPM - load;
+    return steady > 0.0f ? steady : 0.0f;
+  }
+
+  void step(float duty, float seconds) {
+    rpm += (steadyRpm(duty) - rpm) * (seconds / (TAU_S + seconds));
+  }
+
+  // Calculator interface of the SpeedController
+  float getSpeedRpm() const { return rpm; }
+  uint8_t getFaults() const { return 0; }
+  void setDriveDuty(uint8_t) {}
+};
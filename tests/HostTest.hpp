@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+
+/*
+  Checks shared by the host tests.
+
+  - A failed CHECK prints its location and marks the run failed, the test carries on so one
+    run reports every failure. main() returns hostTestResult().
+  - Benchmarks print their figures on stdout, ctest --verbose shows them.
+*/
+inline int hostFailures = 0;
+
+#define CHECK(condition) do {                                                   \
+    if (!(condition)) {                                                         \
+      fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+      hostFailures++;                                                           \
+    }                                                                           \
+  } while (0)
+
+#define CHECK_NEAR(value, expected, tolerance) do {                             \
+    const double value_ = (value);                                              \
+    const double expected_ = (expected);                                        \
+    if (!(std::fabs(value_ - expected_) <= (tolerance))) {                      \
+      fprintf(stderr, "%s:%d: CHECK_NEAR failed: %s = %g, expected %g +- %g\n", \
+              __FILE__, __LINE__, #value, value_, expected_, static_cast<double>(tolerance)); \
+      hostFailures++;                                                           \
+    }                                                                           \
+  } while (0)
+
+inline int hostTestResult(const char *name) {
+  printf("%s: %s\n", name, hostFailures == 0 ? "passed" : "FAILED");
+  return hostFailures == 0 ? 0 : 1;
+}
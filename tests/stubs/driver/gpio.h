@@ -0,0 +1,65 @@
+#pragma once
+
+#include "esp_err.h"
+
+typedef enum {
+  GPIO_NUM_NC = -1,
+  GPIO_NUM_0 = 0, GPIO_NUM_1 = 1, GPIO_NUM_2 = 2, GPIO_NUM_3 = 3, GPIO_NUM_4 = 4, GPIO_NUM_5 = 5, GPIO_NUM_6 = 6, GPIO_NUM_7 = 7, GPIO_NUM_8 = 8, GPIO_NUM_9 = 9, GPIO_NUM_10 = 10, GPIO_NUM_11 = 11, GPIO_NUM_12 = 12, GPIO_NUM_13 = 13, GPIO_NUM_14 = 14, GPIO_NUM_15 = 15, GPIO_NUM_16 = 16, GPIO_NUM_17 = 17, GPIO_NUM_18 = 18, GPIO_NUM_19 = 19, GPIO_NUM_20 = 20, GPIO_NUM_21 = 21, GPIO_NUM_22 = 22, GPIO_NUM_23 = 23, GPIO_NUM_24 = 24, GPIO_NUM_25 = 25, GPIO_NUM_26 = 26, GPIO_NUM_27 = 27, GPIO_NUM_28 = 28, GPIO_NUM_29 = 29, GPIO_NUM_30 = 30, GPIO_NUM_31 = 31, GPIO_NUM_32 = 32, GPIO_NUM_33 = 33, GPIO_NUM_34 = 34, GPIO_NUM_35 = 35, GPIO_NUM_36 = 36, GPIO_NUM_37 = 37, GPIO_NUM_38 = 38, GPIO_NUM_39 = 39,
+  GPIO_NUM_MAX = 40
+} gpio_num_t;
+
+typedef enum { GPIO_MODE_INPUT = 1, GPIO_MODE_OUTPUT = 2 } gpio_mode_t;
+typedef enum { GPIO_PULLUP_DISABLE, GPIO_PULLUP_ENABLE } gpio_pullup_t;
+typedef enum { GPIO_PULLDOWN_DISABLE, GPIO_PULLDOWN_ENABLE } gpio_pulldown_t;
+typedef enum {
+  GPIO_INTR_DISABLE = 0,
+  GPIO_INTR_POSEDGE = 1,
+  GPIO_INTR_NEGEDGE = 2,
+  GPIO_INTR_ANYEDGE = 3,
+  GPIO_INTR_LOW_LEVEL = 4,
+  GPIO_INTR_HIGH_LEVEL = 5
+} gpio_int_type_t;
+
+typedef struct {
+  uint64_t pin_bit_mask;
+  gpio_mode_t mode;
+  gpio_pullup_t pull_up_en;
+  gpio_pulldown_t pull_down_en;
+  gpio_int_type_t intr_type;
+} gpio_config_t;
+
+typedef void (*gpio_isr_t)(void *);
+
+// Pad configuration as the last driver call left it
+struct HostGpioPin {
+  bool pullUp;
+  bool pullDown;
+  gpio_int_type_t intrType;
+  bool intrEnabled;
+  gpio_isr_t handler;
+  void *handlerArg;
+};
+inline HostGpioPin hostGpioPins[GPIO_NUM_MAX] = {};
+
+inline esp_err_t gpio_config(const gpio_config_t *config) {
+  for (int pin = 0; pin < GPIO_NUM_MAX; pin++) {
+    if (!(config->pin_bit_mask & (1ULL << pin))) continue;
+    hostGpioPins[pin].pullUp = config->pull_up_en == GPIO_PULLUP_ENABLE;
+    hostGpioPins[pin].pullDown = config->pull_down_en == GPIO_PULLDOWN_ENABLE;
+    hostGpioPins[pin].intrType = config->intr_type;
+    hostGpioPins[pin].intrEnabled = config->intr_type != GPIO_INTR_DISABLE;
+  }
+  return ESP_OK;
+}
+
+inline esp_err_t gpio_install_isr_service(int) { return ESP_OK; }
+
+inline esp_err_t gpio_isr_handler_add(gpio_num_t pin, gpio_isr_t handler, void *arg) {
+  hostGpioPins[pin].handler = handler;
+  hostGpioPins[pin].handlerArg = arg;
+  return ESP_OK;
+}
+
+inline esp_err_t gpio_intr_enable(gpio_num_t pin) { hostGpioPins[pin].intrEnabled = true; return ESP_OK; }
+inline esp_err_t gpio_intr_disable(gpio_num_t pin) { hostGpioPins[pin].intrEnabled = false; return ESP_OK; }
+inline esp_err_t gpio_set_level(gpio_num_t, uint32_t) { return ESP_OK; }
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "esp_err.h"
+#include "driver/gpio.h"
+
+typedef enum { LEDC_HIGH_SPEED_MODE = 0, LEDC_LOW_SPEED_MODE, LEDC_SPEED_MODE_MAX } ledc_mode_t;
+typedef enum { LEDC_TIMER_0 = 0, LEDC_TIMER_1, LEDC_TIMER_2, LEDC_TIMER_3, LEDC_TIMER_MAX } ledc_timer_t;
+typedef enum {
+  LEDC_CHANNEL_0 = 0, LEDC_CHANNEL_1, LEDC_CHANNEL_2, LEDC_CHANNEL_3,
+  LEDC_CHANNEL_4, LEDC_CHANNEL_5, LEDC_CHANNEL_6, LEDC_CHANNEL_7, LEDC_CHANNEL_MAX
+} ledc_channel_t;
+typedef enum { LEDC_TIMER_1_BIT = 1, LEDC_TIMER_8_BIT = 8, LEDC_TIMER_10_BIT = 10, LEDC_TIMER_20_BIT = 20, LEDC_TIMER_BIT_MAX } ledc_timer_bit_t;
+typedef enum { LEDC_AUTO_CLK = 0 } ledc_clk_cfg_t;
+typedef enum { LEDC_INTR_DISABLE = 0, LEDC_INTR_FADE_END } ledc_intr_type_t;
+typedef enum { LEDC_FADE_NO_WAIT = 0, LEDC_FADE_WAIT_DONE } ledc_fade_mode_t;
+typedef enum { LEDC_FADE_END_EVT } ledc_cb_event_t;
+
+typedef struct {
+  ledc_mode_t speed_mode;
+  ledc_timer_bit_t duty_resolution;
+  ledc_timer_t timer_num;
+  uint32_t freq_hz;
+  ledc_clk_cfg_t clk_cfg;
+  bool deconfigure;
+} ledc_timer_config_t;
+
+typedef struct {
+  int gpio_num;
+  ledc_mode_t speed_mode;
+  ledc_channel_t channel;
+  ledc_intr_type_t intr_type;
+  ledc_timer_t timer_sel;
+  uint32_t duty;
+  int hpoint;
+  struct { unsigned int output_invert : 1; } flags;
+} ledc_channel_config_t;
+
+typedef struct {
+  ledc_cb_event_t event;
+  uint32_t speed_mode;
+  uint32_t channel;
+  uint32_t duty;
+} ledc_cb_param_t;
+
+typedef bool (*ledc_cb_t)(const ledc_cb_param_t *param, void *userArg);
+typedef struct { ledc_cb_t fade_cb; } ledc_cbs_t;
+
+// A duty is staged by ledc_set_duty() and output from ledc_update_duty() on
+struct HostLedcChannel {
+  uint32_t duty;
+  uint32_t staged;
+  uint32_t fadeTarget;
+  bool fading;
+  ledc_cb_t callback;
+  void *callbackArg;
+};
+struct HostLedcTimer {
+  uint32_t frequency;
+  int resolution;
+};
+inline HostLedcChannel hostLedcChannels[LEDC_SPEED_MODE_MAX][LEDC_CHANNEL_MAX] = {};
+inline HostLedcTimer hostLedcTimers[LEDC_SPEED_MODE_MAX][LEDC_TIMER_MAX] = {};
+inline bool hostLedcFadeInstalled = false;
+inline uint32_t hostLedcClockHz = 80000000;
+
+inline esp_err_t ledc_timer_config(const ledc_timer_config_t *config) {
+  if ((static_cast<uint64_t>(config->freq_hz) << config->duty_resolution) > hostLedcClockHz) return ESP_FAIL;
+  hostLedcTimers[config->speed_mode][config->timer_num] = HostLedcTimer{config->freq_hz, config->duty_resolution};
+  return ESP_OK;
+}
+
+inline esp_err_t ledc_channel_config(const ledc_channel_config_t *config) {
+  HostLedcChannel &channel = hostLedcChannels[config->speed_mode][config->channel];
+  channel.duty = channel.staged = config->duty;
+  return ESP_OK;
+}
+
+inline esp_err_t ledc_set_duty(ledc_mode_t mode, ledc_channel_t channel, uint32_t duty) {
+  hostLedcChannels[mode][channel].staged = duty;
+  return ESP_OK;
+}
+
+inline esp_err_t ledc_update_duty(ledc_mode_t mode, ledc_channel_t channel) {
+  hostLedcChannels[mode][channel].duty = hostLedcChannels[mode][channel].staged;
+  return ESP_OK;
+}
+
+inline uint32_t ledc_get_duty(ledc_mode_t mode, ledc_channel_t channel) { return hostLedcChannels[mode][channel].duty; }
+inline uint32_t ledc_get_freq(ledc_mode_t mode, ledc_timer_t timer) { return hostLedcTimers[mode][timer].frequency; }
+
+inline esp_err_t ledc_stop(ledc_mode_t mode, ledc_channel_t channel, uint32_t) {
+  hostLedcChannels[mode][channel].duty = 0;
+  return ESP_OK;
+}
+
+inline esp_err_t ledc_fade_func_install(int) {
+  if (hostLedcFadeInstalled) return ESP_ERR_INVALID_STATE;
+  hostLedcFadeInstalled = true;
+  return ESP_OK;
+}
+
+inline esp_err_t ledc_cb_register(ledc_mode_t mode, ledc_channel_t channel, ledc_cbs_t *callbacks, void *arg) {
+  hostLedcChannels[mode][channel].callback = callbacks->fade_cb;
+  hostLedcChannels[mode][channel].callbackArg = arg;
+  return ESP_OK;
+}
+
+// Fades complete instantly, see hostLedcFinishFade()
+inline esp_err_t ledc_set_fade_time_and_start(ledc_mode_t mode, ledc_channel_t channel, uint32_t target, uint32_t, ledc_fade_mode_t) {
+  if (!hostLedcFadeInstalled) return ESP_ERR_INVALID_STATE;
+  hostLedcChannels[mode][channel].fadeTarget = target;
+  hostLedcChannels[mode][channel].fading = true;
+  return ESP_OK;
+}
+
+inline esp_err_t ledc_fade_stop(ledc_mode_t mode, ledc_channel_t channel) {
+  hostLedcChannels[mode][channel].fading = false;
+  return ESP_OK;
+}
+
+// Ends a running fade at its target and calls the fade callback as the fade ISR would
+inline void hostLedcFinishFade(ledc_mode_t mode, ledc_channel_t channel) {
+  HostLedcChannel &state = hostLedcChannels[mode][channel];
+  if (!state.fading) return;
+  state.fading = false;
+  state.duty = state.staged = state.fadeTarget;
+  if (state.callback != nullptr) {
+    const ledc_cb_param_t param = {LEDC_FADE_END_EVT, static_cast<uint32_t>(mode), static_cast<uint32_t>(channel), state.duty};
+    state.callback(&param, state.callbackArg);
+  }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "esp_err.h"
+#include "driver/gpio.h"
+
+typedef struct mcpwm_cap_timer_t *mcpwm_cap_timer_handle_t;
+typedef struct mcpwm_cap_channel_t *mcpwm_cap_channel_handle_t;
+
+typedef enum { MCPWM_CAPTURE_CLK_SRC_DEFAULT = 0 } mcpwm_capture_clock_source_t;
+typedef enum { MCPWM_CAP_EDGE_POS, MCPWM_CAP_EDGE_NEG } mcpwm_capture_edge_t;
+
+typedef struct {
+  int group_id;
+  mcpwm_capture_clock_source_t clk_src;
+  uint32_t resolution_hz;
+} mcpwm_capture_timer_config_t;
+
+typedef struct {
+  int gpio_num;
+  int intr_priority;
+  uint32_t prescale;
+  struct {
+    uint32_t pos_edge : 1;
+    uint32_t neg_edge : 1;
+    uint32_t pull_up : 1;
+    uint32_t pull_down : 1;
+    uint32_t invert_cap_signal : 1;
+    uint32_t io_loop_back : 1;
+    uint32_t keep_io_conf_at_exit : 1;
+  } flags;
+} mcpwm_capture_channel_config_t;
+
+typedef struct {
+  uint32_t cap_value;
+  mcpwm_capture_edge_t cap_edge;
+} mcpwm_capture_event_data_t;
+
+typedef bool (*mcpwm_capture_event_cb_t)(mcpwm_cap_channel_handle_t, const mcpwm_capture_event_data_t *, void *);
+typedef struct { mcpwm_capture_event_cb_t on_cap; } mcpwm_capture_event_callbacks_t;
+
+// hostMcpwmChannels is how many capture channels the driver can still hand out. The last
+// registered callback is kept so a test can raise captures.
+inline int hostMcpwmChannels = 0;
+inline uint32_t hostMcpwmResolutionHz = 80000000;
+inline bool hostMcpwmChannelEnabled = false;
+inline mcpwm_capture_event_cb_t hostMcpwmCallback = nullptr;
+inline void *hostMcpwmCallbackArg = nullptr;
+
+inline esp_err_t mcpwm_new_capture_timer(const mcpwm_capture_timer_config_t *, mcpwm_cap_timer_handle_t *timer) {
+  *timer = reinterpret_cast<mcpwm_cap_timer_handle_t>(0x1);
+  return ESP_OK;
+}
+inline esp_err_t mcpwm_capture_timer_enable(mcpwm_cap_timer_handle_t) { return ESP_OK; }
+inline esp_err_t mcpwm_capture_timer_start(mcpwm_cap_timer_handle_t) { return ESP_OK; }
+inline esp_err_t mcpwm_capture_timer_get_resolution(mcpwm_cap_timer_handle_t, uint32_t *resolution) {
+  *resolution = hostMcpwmResolutionHz;
+  return ESP_OK;
+}
+
+// The capture channel configures its pin as an input with the requested pulls
+inline esp_err_t mcpwm_new_capture_channel(mcpwm_cap_timer_handle_t, const mcpwm_capture_channel_config_t *config,
+                                           mcpwm_cap_channel_handle_t *channel) {
+  if (hostMcpwmChannels <= 0) return ESP_ERR_NOT_FOUND;
+  hostMcpwmChannels--;
+  gpio_config_t pinConfig = {};
+  pinConfig.pin_bit_mask = 1ULL << config->gpio_num;
+  pinConfig.mode = GPIO_MODE_INPUT;
+  pinConfig.pull_up_en = config->flags.pull_up ? GPIO_PULLUP_ENABLE : GPIO_PULLUP_DISABLE;
+  pinConfig.pull_down_en = config->flags.pull_down ? GPIO_PULLDOWN_ENABLE : GPIO_PULLDOWN_DISABLE;
+  gpio_config(&pinConfig);
+  *channel = reinterpret_cast<mcpwm_cap_channel_handle_t>(0x2);
+  return ESP_OK;
+}
+
+inline esp_err_t mcpwm_capture_channel_register_event_callbacks(mcpwm_cap_channel_handle_t,
+                                                                const mcpwm_capture_event_callbacks_t *callbacks, void *arg) {
+  hostMcpwmCallback = callbacks->on_cap;
+  hostMcpwmCallbackArg = arg;
+  return ESP_OK;
+}
+inline esp_err_t mcpwm_capture_channel_enable(mcpwm_cap_channel_handle_t) { hostMcpwmChannelEnabled = true; return ESP_OK; }
+inline esp_err_t mcpwm_capture_channel_disable(mcpwm_cap_channel_handle_t) { hostMcpwmChannelEnabled = false; return ESP_OK; }
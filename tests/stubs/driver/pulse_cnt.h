@@ -0,0 +1,80 @@
+#pragma once
+
+#include "esp_err.h"
+#include "driver/gpio.h"
+
+typedef struct pcnt_unit_t *pcnt_unit_handle_t;
+typedef struct pcnt_chan_t *pcnt_channel_handle_t;
+
+typedef struct {
+  int low_limit;
+  int high_limit;
+  int intr_priority;
+  struct { uint32_t accum_count : 1; } flags;
+} pcnt_unit_config_t;
+
+typedef struct {
+  int edge_gpio_num;
+  int level_gpio_num;
+  struct { uint32_t invert_edge_input : 1; } flags;
+} pcnt_chan_config_t;
+
+typedef struct { uint32_t max_glitch_ns; } pcnt_glitch_filter_config_t;
+
+typedef enum {
+  PCNT_CHANNEL_EDGE_ACTION_HOLD,
+  PCNT_CHANNEL_EDGE_ACTION_INCREASE,
+  PCNT_CHANNEL_EDGE_ACTION_DECREASE
+} pcnt_channel_edge_action_t;
+
+// One simulated unit. hostPcntUnits is how many the driver can still hand out, the test
+// sets the accumulated count and hostPcntFailAt makes the n-th setup call fail.
+inline int hostPcntUnits = 0;
+inline int hostPcntCount = 0;
+inline bool hostPcntRunning = false;
+inline int hostPcntFailAt = 0;
+inline int hostPcntCalls = 0;
+
+inline esp_err_t hostPcntCall() {
+  return (++hostPcntCalls == hostPcntFailAt) ? ESP_FAIL : ESP_OK;
+}
+
+inline esp_err_t pcnt_new_unit(const pcnt_unit_config_t *, pcnt_unit_handle_t *unit) {
+  if (hostPcntUnits <= 0) return ESP_ERR_NOT_FOUND;
+  hostPcntUnits--;
+  *unit = reinterpret_cast<pcnt_unit_handle_t>(0x1);
+  return ESP_OK;
+}
+
+inline esp_err_t pcnt_del_unit(pcnt_unit_handle_t) { hostPcntUnits++; return ESP_OK; }
+inline esp_err_t pcnt_unit_set_glitch_filter(pcnt_unit_handle_t, const pcnt_glitch_filter_config_t *) { return hostPcntCall(); }
+
+// Like IDF 5, the channel configures its pin: input with pull-up, interrupt off
+inline esp_err_t pcnt_new_channel(pcnt_unit_handle_t, const pcnt_chan_config_t *config, pcnt_channel_handle_t *channel) {
+  const esp_err_t err = hostPcntCall();
+  if (err != ESP_OK) return err;
+  if (config->edge_gpio_num >= 0) {
+    gpio_config_t pinConfig = {};
+    pinConfig.pin_bit_mask = 1ULL << config->edge_gpio_num;
+    pinConfig.mode = GPIO_MODE_INPUT;
+    pinConfig.pull_up_en = GPIO_PULLUP_ENABLE;
+    gpio_config(&pinConfig);
+  }
+  *channel = reinterpret_cast<pcnt_channel_handle_t>(0x2);
+  return ESP_OK;
+}
+
+inline esp_err_t pcnt_del_channel(pcnt_channel_handle_t) { return ESP_OK; }
+inline esp_err_t pcnt_channel_set_edge_action(pcnt_channel_handle_t, pcnt_channel_edge_action_t, pcnt_channel_edge_action_t) { return hostPcntCall(); }
+inline esp_err_t pcnt_unit_add_watch_point(pcnt_unit_handle_t, int) { return hostPcntCall(); }
+inline esp_err_t pcnt_unit_enable(pcnt_unit_handle_t) { return hostPcntCall(); }
+inline esp_err_t pcnt_unit_disable(pcnt_unit_handle_t) { hostPcntRunning = false; return ESP_OK; }
+inline esp_err_t pcnt_unit_clear_count(pcnt_unit_handle_t) { hostPcntCount = 0; return hostPcntCall(); }
+
+inline esp_err_t pcnt_unit_start(pcnt_unit_handle_t) {
+  const esp_err_t err = hostPcntCall();
+  hostPcntRunning = err == ESP_OK;
+  return err;
+}
+
+inline esp_err_t pcnt_unit_get_count(pcnt_unit_handle_t, int *count) { *count = hostPcntCount; return ESP_OK; }
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "esp_timer.h"
+#include "esp_rom_sys.h"
+
+// CCOUNT follows the simulated time and wraps at 32 bits like the real register
+inline uint32_t esp_cpu_get_cycle_count() {
+  return static_cast<uint32_t>(static_cast<uint64_t>(hostTimeMicros) * hostCpuTicksPerMicro);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+// Host stand-ins for ESP-IDF, just enough to build the speed and control headers on a PC.
+// Hardware state lives in host* globals the tests set and inspect.
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+typedef int esp_err_t;
+
+#define ESP_OK                  0
+#define ESP_FAIL                -1
+#define ESP_ERR_NO_MEM          0x101
+#define ESP_ERR_INVALID_ARG     0x102
+#define ESP_ERR_INVALID_STATE   0x103
+#define ESP_ERR_NOT_FOUND       0x105
+
+// Aborts like the target, a test that trips it has found a bug
+#define ESP_ERROR_CHECK(x) do {                                               \
+    esp_err_t err_rc_ = (x);                                                  \
+    if (err_rc_ != ESP_OK) {                                                  \
+      fprintf(stderr, "ESP_ERROR_CHECK failed: %d at %s:%d\n", err_rc_, __FILE__, __LINE__); \
+      abort();                                                                \
+    }                                                                         \
+  } while (0)
+
+inline const char *esp_err_to_name(esp_err_t err) {
+  switch (err) {
+    case ESP_OK: return "ESP_OK";
+    case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+    default: return "ESP_FAIL";
+  }
+}
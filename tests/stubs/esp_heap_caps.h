@@ -0,0 +1,14 @@
+#pragma once
+
+#include "esp_err.h"
+
+#define MALLOC_CAP_8BIT       (1 << 2)
+#define MALLOC_CAP_SPIRAM     (1 << 10)
+#define MALLOC_CAP_INTERNAL   (1 << 11)
+
+inline bool hostHasPsram = false;
+
+inline void *heap_caps_malloc(size_t size, uint32_t caps) {
+  if ((caps & MALLOC_CAP_SPIRAM) && !hostHasPsram) return nullptr;
+  return malloc(size);
+}
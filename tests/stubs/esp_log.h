@@ -0,0 +1,25 @@
+#pragma once
+
+#include "esp_err.h"
+
+// Warnings and errors go to stderr, info and below are format checked but only printed
+// when HOST_VERBOSE_LOG is defined
+#ifdef HOST_VERBOSE_LOG
+#define HOST_LOG_INFO 1
+#else
+#define HOST_LOG_INFO 0
+#endif
+
+#define HOST_LOG(enabled, level, tag, ...) do {                               \
+    if (enabled) {                                                            \
+      fprintf(stderr, "%s (%s): ", level, tag);                               \
+      fprintf(stderr, __VA_ARGS__);                                           \
+      fprintf(stderr, "\n");                                                  \
+    }                                                                         \
+  } while (0)
+
+#define ESP_LOGE(tag, ...) HOST_LOG(1, "E", tag, __VA_ARGS__)
+#define ESP_LOGW(tag, ...) HOST_LOG(1, "W", tag, __VA_ARGS__)
+#define ESP_LOGI(tag, ...) HOST_LOG(HOST_LOG_INFO, "I", tag, __VA_ARGS__)
+#define ESP_LOGD(tag, ...) HOST_LOG(HOST_LOG_INFO, "D", tag, __VA_ARGS__)
+#define ESP_LOGV(tag, ...) HOST_LOG(HOST_LOG_INFO, "V", tag, __VA_ARGS__)
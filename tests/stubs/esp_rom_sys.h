@@ -0,0 +1,7 @@
+#pragma once
+
+#include "esp_err.h"
+
+inline uint32_t hostCpuTicksPerMicro = 240;
+
+inline uint32_t esp_rom_get_cpu_ticks_per_us() { return hostCpuTicksPerMicro; }
@@ -0,0 +1,8 @@
+#pragma once
+
+#include "esp_err.h"
+
+// Simulated time, the tests move it forward
+inline int64_t hostTimeMicros = 0;
+
+inline int64_t esp_timer_get_time() { return hostTimeMicros; }
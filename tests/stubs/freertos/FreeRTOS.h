@@ -0,0 +1,28 @@
+#pragma once
+
+#include "esp_err.h"
+#include "esp_attr.h"
+
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void *TaskHandle_t;
+typedef void *SemaphoreHandle_t;
+
+#define pdPASS                  1
+#define pdFAIL                  0
+#define pdTRUE                  1
+#define pdFALSE                 0
+#define portMAX_DELAY           0xFFFFFFFFu
+#define configTICK_RATE_HZ      1000
+#define portTICK_PERIOD_MS      (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms)       (static_cast<TickType_t>(ms) * configTICK_RATE_HZ / 1000)
+
+// Single threaded host: critical sections only have to compile
+typedef struct { int owner; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED { 0 }
+#define portENTER_CRITICAL(mux)     (void)(mux)
+#define portEXIT_CRITICAL(mux)      (void)(mux)
+#define portENTER_CRITICAL_ISR(mux) (void)(mux)
+#define portEXIT_CRITICAL_ISR(mux)  (void)(mux)
+#define portYIELD_FROM_ISR(...)     do {} while (0)
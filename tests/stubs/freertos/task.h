@@ -0,0 +1,38 @@
+#pragma once
+
+#include "FreeRTOS.h"
+#include "esp_timer.h"
+
+typedef void (*TaskFunction_t)(void *);
+
+// Tasks are never started, a test calls the task function itself. A task blocking in
+// vTaskDelayUntil() advances the simulated time and then runs hostDelayHook, the test's model
+// of the world during the delay. A hook returning false ends the task by throwing HostTaskExit.
+struct HostTaskExit {};
+inline bool (*hostDelayHook)(TickType_t ticks) = nullptr;
+inline TickType_t hostTickCount = 0;
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char *, uint32_t, void *, UBaseType_t,
+                                          TaskHandle_t *handle, BaseType_t) {
+  static int hostTaskCount = 0;
+  if (handle != nullptr) *handle = reinterpret_cast<TaskHandle_t>(static_cast<intptr_t>(++hostTaskCount));
+  return pdPASS;
+}
+
+inline TickType_t xTaskGetTickCount() { return hostTickCount; }
+
+inline void vTaskDelay(TickType_t ticks) {
+  hostTickCount += ticks;
+  hostTimeMicros += static_cast<int64_t>(ticks) * portTICK_PERIOD_MS * 1000;
+}
+
+inline void vTaskDelayUntil(TickType_t *previousWake, TickType_t ticks) {
+  *previousWake += ticks;
+  vTaskDelay(ticks);
+  if (hostDelayHook != nullptr && !hostDelayHook(ticks)) throw HostTaskExit();
+}
+
+inline void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t *higherPriorityTaskWoken) {
+  if (higherPriorityTaskWoken != nullptr) *higherPriorityTaskWoken = pdTRUE;
+}
+inline uint32_t ulTaskNotifyTake(BaseType_t, TickType_t) { return 0; }
@@ -0,0 +1,5 @@
+#pragma once
+
+#define SOC_MCPWM_GROUPS                        2
+#define SOC_MCPWM_CAPTURE_CHANNELS_PER_TIMER    3
+#define SOC_LEDC_TIMER_BIT_WIDTH                20
@@ -0,0 +1,164 @@
+// user-006: the edge filter against noisy Hall streams, and the cost of its two stages
+
+#include <chrono>
+#include <initializer_list>
+#include <memory>
+#include <random>
+#include <vector>
+#include "HostTest.hpp"
+#include "HostEdges.hpp"
+#include "BLDCPulseCalculator.hpp"
+
+namespace {
+
+constexpr uint32_t EDGES = MotorPulseCalculator::EDGES_PER_REVOLUTION;
+
+struct NoisyStream {
+  double ringingProbability;    // 1-3 extra edges within 10 us of a real one
+  double spuriousProbability;   // a lone edge inside the period
+  double spuriousFrom;          // Where it lands, as a fraction of the period
+  double spuriousTo;
+  double missingProbability;    // a real edge that never arrives, costs a window 1/32 until it moves on
+};
+
+struct Result {
+  double filteredError;   // Worst relative error of the calculator
+  double rawError;        // Worst relative error of a one revolution average over every edge
+  uint32_t lockoutRejects;
+  uint32_t outlierRejects;
+};
+
+// 40/60 feedback duty cycle: both-edge periods alternate between 0.8 and 1.2 of the mean
+Result run(double rpm, const NoisyStream &noise, uint32_t seed) {
+  auto calculator = std::make_unique<MotorPulseCalculator>(GPIO_NUM_32, 1);
+  calculator->attach(nullptr);
+
+  std::mt19937 random(seed);
+  std::uniform_real_distribution<double> chance(0.0, 1.0);
+  const double period = hostEdgePeriod(rpm, EDGES);
+
+  std::vector<double> allEdges;
+  Result result = {0.0, 0.0, 0, 0};
+  double time = 1.0e6;
+  for (uint32_t edge = 0; edge < 60 * EDGES; edge++) {
+    time += period * ((edge & 1) ? 0.8 : 1.2);
+    if (chance(random) >= noise.missingProbability) {
+      hostEdge(*calculator, time);
+      allEdges.push_back(time);
+    }
+    if (chance(random) < noise.ringingProbability) {
+      const int bursts = 1 + static_cast<int>(chance(random) * 3);
+      for (int burst = 1; burst <= bursts; burst++) {
+        hostEdge(*calculator, time + 3.0 * burst);
+        allEdges.push_back(time + 3.0 * burst);
+      }
+    }
+    if (chance(random) < noise.spuriousProbability) {
+      const double at = time + period * (noise.spuriousFrom + (noise.spuriousTo - noise.spuriousFrom) * chance(random));
+      hostEdge(*calculator, at);
+      allEdges.push_back(at);
+    }
+
+    if (edge > 4 * EDGES) {
+      result.filteredError = std::fmax(result.filteredError, std::fabs(calculator->getSpeedRpm() - rpm) / rpm);
+      if (allEdges.size() > EDGES) {
+        const double span = allEdges.back() - allEdges[allEdges.size() - 1 - EDGES];
+        const double raw = 60.0e6 / span;
+        result.rawError = std::fmax(result.rawError, std::fabs(raw - rpm) / rpm);
+      }
+    }
+  }
+  result.lockoutRejects = calculator->getEdgeFilter().getLockoutRejectCount();
+  result.outlierRejects = calculator->getEdgeFilter().getOutlierRejectCount();
+  return result;
+}
+
+void testStreams() {
+  // Glitches land inside the lockout, mid-period edges beyond it where no ratio test can
+  // tell them from a real edge: those are only reported, not checked
+  const NoisyStream clean = {0.0, 0.0, 0.0, 0.0, 0.0};
+  const NoisyStream ringing = {0.1, 0.0, 0.0, 0.0, 0.0};
+  const NoisyStream glitch = {0.1, 0.02, 0.05, 0.2, 0.0};
+  const NoisyStream missing = {0.1, 0.02, 0.05, 0.2, 0.005};
+  const NoisyStream midPeriod = {0.0, 0.02, 0.3, 0.7, 0.0};
+
+  printf("%6s %-10s %12s %12s %8s %8s\n", "rpm", "stream", "filtered %", "raw %", "lockout", "outlier");
+  for (double rpm : {300.0, 1500.0, 3000.0}) {
+    const struct { const char *name; NoisyStream noise; double tolerance; } streams[] = {
+      {"clean", clean, 0.001},
+      {"ringing", ringing, 0.001},
+      {"glitch", glitch, 0.001},
+      {"missing", missing, 0.1},
+      {"mid-period", midPeriod, 1.0},
+    };
+    for (const auto &stream : streams) {
+      const Result result = run(rpm, stream.noise, static_cast<uint32_t>(rpm));
+      printf("%6.0f %-10s %12.3f %12.3f %8u %8u\n", rpm, stream.name, result.filteredError * 100.0,
+             result.rawError * 100.0, static_cast<unsigned>(result.lockoutRejects),
+             static_cast<unsigned>(result.outlierRejects));
+      CHECK(result.filteredError < stream.tolerance);
+    }
+  }
+}
+
+void testVerdicts() {
+  EdgeFilter filter;
+  for (int i = 0; i < 5; i++) {
+    CHECK(filter.classifyPeriod(1000) == EdgeFilter::Verdict::ACCEPT);
+  }
+  CHECK(filter.getLockoutMicros() == 250);
+  CHECK(filter.classifyPeriod(200) == EdgeFilter::Verdict::TOO_SHORT);
+  CHECK(filter.classifyPeriod(5000) == EdgeFilter::Verdict::TOO_LONG);
+  CHECK(filter.classifyPeriod(900) == EdgeFilter::Verdict::ACCEPT);
+  CHECK(filter.getOutlierRejectCount() == 2);
+
+  // Lockout in the ISR stage: edges closer than a quarter period never reach the task
+  filter.setTicksPerMicro(1);
+  for (int i = 0; i < 5; i++) filter.classifyPeriod(1000);
+  CHECK(filter.acceptEdge(10000));
+  CHECK(!filter.acceptEdge(10100));
+  CHECK(filter.acceptEdge(10300));
+  CHECK(filter.getLockoutRejectCount() == 1);
+
+  // A real speed change is adopted after a run of rejections
+  EdgeFilter stepped;
+  for (int i = 0; i < 5; i++) stepped.classifyPeriod(1000);
+  int rejected = 0;
+  while (stepped.classifyPeriod(100) != EdgeFilter::Verdict::ACCEPT) rejected++;
+  CHECK(rejected == 4);
+  for (int i = 0; i < 5; i++) stepped.classifyPeriod(100);
+  CHECK(stepped.getLockoutMicros() == 25);
+}
+
+// Host nanoseconds per call of each stage, the ISR stage is one subtraction and compare
+void benchmark() {
+  constexpr uint32_t CALLS = 20000000;
+  EdgeFilter filter;
+  for (int i = 0; i < 5; i++) filter.classifyPeriod(1000);
+
+  uint32_t accepted = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t call = 0; call < CALLS; call++) {
+    accepted += filter.acceptEdge(call * 97) ? 1 : 0;
+  }
+  const double isrNanos = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / CALLS;
+
+  start = std::chrono::steady_clock::now();
+  for (uint32_t call = 0; call < CALLS; call++) {
+    accepted += filter.classifyPeriod(900 + (call & 0xFF)) == EdgeFilter::Verdict::ACCEPT ? 1 : 0;
+  }
+  const double taskNanos = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / CALLS;
+
+  volatile uint32_t sink = accepted;
+  (void)sink;
+  printf("host cost: acceptEdge %.2f ns, classifyPeriod %.2f ns\n", isrNanos, taskNanos);
+}
+
+}  // namespace
+
+int main() {
+  testVerdicts();
+  testStreams();
+  benchmark();
+  return hostTestResult("test_edge_filter");
+}
@@ -0,0 +1,135 @@
+// user-002: the ISR-to-task edge ring under two threads, and the calculator's recovery from
+// an overflowing ring
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include "HostTest.hpp"
+#include "HostEdges.hpp"
+#include "EdgeRingBuffer.hpp"
+#include "BLDCPulseCalculator.hpp"
+
+namespace {
+
+constexpr uint32_t STRESS_EDGES = 1000000;
+
+// Producer retries until there is room: every value arrives once and in order, every
+// refused push is counted
+void testLossless() {
+  static EdgeRingBuffer<uint32_t, 256> ring;
+  uint32_t refused = 0;
+  std::thread producer([&] {
+    for (uint32_t value = 1; value <= STRESS_EDGES; value++) {
+      while (!ring.push(value)) {
+        refused++;
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  uint32_t expected = 1;
+  uint32_t value = 0;
+  bool ordered = true;
+  while (expected <= STRESS_EDGES) {
+    if (ring.pop(value)) {
+      ordered = ordered && value == expected;
+      expected++;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+
+  CHECK(ordered);
+  CHECK(ring.size() == 0);
+  CHECK(ring.getOverflowCount() == refused);
+}
+
+// Producer never waits, like the ISR: drops are counted, whatever arrives is in order
+void testLossy() {
+  static EdgeRingBuffer<uint32_t, 64> ring;
+  std::atomic<bool> done(false);
+  uint32_t pushed = 0;
+  std::thread producer([&] {
+    for (uint32_t value = 1; value <= STRESS_EDGES; value++) {
+      pushed += ring.push(value) ? 1 : 0;
+      if ((value & 0xFF) == 0) {
+        std::this_thread::yield();   // Lets a single core host interleave the consumer
+      }
+    }
+    done.store(true, std::memory_order_release);
+  });
+
+  uint32_t last = 0;
+  uint32_t received = 0;
+  uint32_t value = 0;
+  bool ordered = true;
+  while (!done.load(std::memory_order_acquire) || ring.size() > 0) {
+    if (ring.pop(value)) {
+      ordered = ordered && value > last;
+      last = value;
+      received++;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+
+  printf("lossy stress: %u received, %u dropped of %u\n", static_cast<unsigned>(received),
+         static_cast<unsigned>(ring.getOverflowCount()), static_cast<unsigned>(STRESS_EDGES));
+  CHECK(ordered);
+  CHECK(received == pushed);
+  CHECK(pushed + ring.getOverflowCount() == STRESS_EDGES);
+}
+
+void testFullAndClear() {
+  EdgeRingBuffer<uint32_t, 4> ring;
+  for (uint32_t value = 0; value < 4; value++) {
+    CHECK(ring.push(value));
+  }
+  CHECK(!ring.push(4));
+  CHECK(ring.size() == 4);
+  CHECK(ring.getOverflowCount() == 1);
+
+  uint32_t value = 0;
+  CHECK(ring.pop(value) && value == 0);
+  CHECK(ring.push(5));
+  ring.clear();
+  CHECK(ring.size() == 0);
+  CHECK(!ring.pop(value));
+}
+
+// A starved task: more edges than the ring holds arrive before it runs. The calculator drops
+// the gap and measures again from the next edges.
+void testCalculatorOverflow() {
+  auto calculator = std::make_unique<MotorPulseCalculator>(GPIO_NUM_32, 1);
+  calculator->attach(nullptr);
+
+  const double rpm = 600.0;
+  const double period = hostEdgePeriod(rpm, MotorPulseCalculator::EDGES_PER_REVOLUTION);
+  double time = 1.0e6;
+  for (int edge = 0; edge < 100; edge++, time += period) {
+    hostEdge(*calculator, time);
+  }
+  CHECK_NEAR(calculator->getSpeedRpm(), rpm, 0.5);
+
+  for (int edge = 0; edge < 300; edge++, time += period) {
+    hostEdge(*calculator, time, false);
+  }
+  CHECK(calculator->getOverflowCount() > 0);
+
+  for (int edge = 0; edge < 100; edge++, time += period) {
+    hostEdge(*calculator, time);
+  }
+  CHECK_NEAR(calculator->getSpeedRpm(), rpm, 0.5);
+}
+
+}  // namespace
+
+int main() {
+  testLossless();
+  testLossy();
+  testFullAndClear();
+  testCalculatorOverflow();
+  return hostTestResult("test_edge_ring_buffer");
+}
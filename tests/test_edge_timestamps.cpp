@@ -0,0 +1,68 @@
+// user-001: accuracy of the speed estimate with microsecond edge timestamps, against the
+// millisecond timestamps the calculator used before
+
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include "HostTest.hpp"
+#include "HostEdges.hpp"
+#include "BLDCPulseCalculator.hpp"
+
+namespace {
+
+constexpr uint32_t EDGES = MotorPulseCalculator::EDGES_PER_REVOLUTION;
+constexpr int REVOLUTIONS = 40;
+
+// The old path: esp_timer_get_time() / 1000 per edge, RPM from the one revolution sum
+double millisecondError(double rpm, double phase) {
+  const double period = hostEdgePeriod(rpm, EDGES);
+  double worst = 0.0;
+  for (int revolution = 1; revolution < REVOLUTIONS; revolution++) {
+    const double start = phase + (revolution - 1) * EDGES * period;
+    const double end = phase + revolution * EDGES * period;
+    const int64_t sum = static_cast<int64_t>(end) / 1000 - static_cast<int64_t>(start) / 1000;
+    const double measured = sum > 0 ? 60000.0 / sum : 0.0;
+    worst = std::fmax(worst, std::fabs(measured - rpm) / rpm);
+  }
+  return worst;
+}
+
+// The current path: raw edges through the ISR entry point and the speed task
+double microsecondError(double rpm, double phase) {
+  auto calculator = std::make_unique<MotorPulseCalculator>(GPIO_NUM_32, 1);
+  calculator->attach(nullptr);
+
+  const double period = hostEdgePeriod(rpm, EDGES);
+  double worst = 0.0;
+  for (uint32_t edge = 0; edge < REVOLUTIONS * EDGES; edge++) {
+    hostEdge(*calculator, phase + edge * period);
+    if (edge > 2 * EDGES) {
+      worst = std::fmax(worst, std::fabs(calculator->getSpeedRpm() - rpm) / rpm);
+    }
+  }
+  return worst;
+}
+
+}  // namespace
+
+int main() {
+  printf("%8s %14s %14s\n", "rpm", "ms error %", "us error %");
+  for (double rpm : {100.0, 250.0, 500.0, 1000.0, 1500.0, 2000.0, 3000.0}) {
+    double before = 0.0;
+    double after = 0.0;
+    // The quantization error depends on where the edges fall: speeds just off the nominal
+    // one and a few sub-millisecond phases
+    for (double offset : {1.0, 1.0013, 0.9971, 1.0047}) {
+      for (double phase : {1.0e6, 1.0e6 + 333.3, 1.0e6 + 777.7}) {
+        before = std::fmax(before, millisecondError(rpm * offset, phase));
+        after = std::fmax(after, microsecondError(rpm * offset, phase));
+      }
+    }
+    printf("%8.0f %14.3f %14.4f\n", rpm, before * 100.0, after * 100.0);
+
+    // One microsecond over the shortest window (20 ms at 3000 RPM) is 0.005 %
+    CHECK(after < 0.0002);
+    CHECK(after < before);
+  }
+  return hostTestResult("test_edge_timestamps");
+}
@@ -0,0 +1,157 @@
+// user-008: the period/frequency mode switch, gated counting through PCNT, and the pin
+// configuration left behind by attach()
+
+#include <memory>
+#include "HostTest.hpp"
+#include "HostEdges.hpp"
+#include "BLDCPulseCalculator.hpp"
+
+namespace {
+
+using Mode = MeasurementModeSelector::Mode;
+
+constexpr gpio_num_t PIN = GPIO_NUM_32;
+constexpr uint32_t EDGES = MotorPulseCalculator::EDGES_PER_REVOLUTION;
+constexpr double GATE_US = 100000.0;
+
+std::unique_ptr<MotorPulseCalculator> attached(CaptureBackend backend, int pcntUnits, int mcpwmChannels) {
+  hostPcntUnits = pcntUnits;
+  hostPcntCalls = 0;
+  hostPcntCount = 0;
+  hostMcpwmChannels = mcpwmChannels;
+  hostGpioPins[PIN] = HostGpioPin{};
+  auto calculator = std::make_unique<MotorPulseCalculator>(PIN, 1, backend);
+  calculator->attach(nullptr);
+  return calculator;
+}
+
+// The pull-down and edge interrupt of the capture backend, not the pull-up PCNT leaves behind
+bool captureOwnsPin(CaptureBackend backend) {
+  const HostGpioPin &pin = hostGpioPins[PIN];
+  if (!pin.pullDown || pin.pullUp) return false;
+  if (backend == CaptureBackend::MCPWM_CAPTURE) return hostMcpwmChannelEnabled;
+  return pin.intrType == GPIO_INTR_ANYEDGE && pin.intrEnabled;
+}
+
+bool edgeInterruptEnabled(CaptureBackend backend) {
+  return backend == CaptureBackend::MCPWM_CAPTURE ? hostMcpwmChannelEnabled : hostGpioPins[PIN].intrEnabled;
+}
+
+void testSelector() {
+  MeasurementModeSelector selector(1500.0f, 0.1f, 3);
+  CHECK(selector.getEnterFrequencyRpm() == 1650.0f);
+  CHECK(selector.getLeaveFrequencyRpm() == 1350.0f);
+
+  // Inside the band nothing changes, a dip resets the confirmation
+  CHECK(selector.update(1600.0f) == Mode::PERIOD);
+  CHECK(selector.update(1700.0f) == Mode::PERIOD);
+  CHECK(selector.update(1700.0f) == Mode::PERIOD);
+  CHECK(selector.update(1640.0f) == Mode::PERIOD);
+  CHECK(selector.update(1700.0f) == Mode::PERIOD);
+  CHECK(selector.update(1700.0f) == Mode::PERIOD);
+  CHECK(selector.update(1700.0f) == Mode::FREQUENCY);
+
+  CHECK(selector.update(1400.0f) == Mode::FREQUENCY);
+  CHECK(selector.update(1300.0f) == Mode::FREQUENCY);
+  CHECK(selector.update(1300.0f) == Mode::FREQUENCY);
+  CHECK(selector.update(1300.0f) == Mode::PERIOD);
+}
+
+// Drives the calculator through a speed profile: per-edge interrupts while they are enabled,
+// the PCNT counts every edge either way and the task wakes at least once per gate
+struct Drive {
+  MotorPulseCalculator &calculator;
+  CaptureBackend backend;
+  double time;
+  double nextWake;
+
+  void run(double fromRpm, double toRpm, double micros, double &worstGatedError) {
+    const double end = time + micros;
+    while (time < end) {
+      const double rpm = fromRpm + (toRpm - fromRpm) * (1.0 - (end - time) / micros);
+      const double period = hostEdgePeriod(rpm, EDGES);
+      time += period;
+      hostPcntCount++;
+      if (edgeInterruptEnabled(backend)) {
+        if (backend == CaptureBackend::MCPWM_CAPTURE) {
+          hostCaptureEdge(calculator, time);
+        } else {
+          hostEdge(calculator, time);
+        }
+      }
+      if (time >= nextWake) {
+        hostTimeMicros = static_cast<int64_t>(time);
+        calculator.motorSpeed();
+        nextWake = time + GATE_US;
+        if (calculator.getMeasurementMode() == Mode::FREQUENCY && fromRpm == toRpm) {
+          worstGatedError = std::fmax(worstGatedError, std::fabs(calculator.getSpeedRpm() - rpm) / rpm);
+        }
+      }
+    }
+  }
+};
+
+void testSwitching(CaptureBackend backend, int mcpwmChannels) {
+  auto calculator = attached(backend, 1, mcpwmChannels);
+  CHECK(captureOwnsPin(backend));
+
+  Drive drive = {*calculator, backend, 1.0e6, 0.0};
+  double gatedError = 0.0;
+  drive.run(300.0, 300.0, 1.0e6, gatedError);
+  CHECK(calculator->getMeasurementMode() == Mode::PERIOD);
+
+  drive.run(300.0, 2400.0, 2.0e6, gatedError);
+  drive.run(2400.0, 2400.0, 1.0e6, gatedError);
+  CHECK(calculator->getMeasurementMode() == Mode::FREQUENCY);
+  CHECK(!edgeInterruptEnabled(backend));
+  // A 100 ms gate counts 128 edges at 2400 rpm: a count is worth 0.8 %, the gate edges
+  // fall between pulses
+  CHECK(gatedError < 0.02);
+  CHECK_NEAR(calculator->getSpeedRpm(), 2400.0f, 24.0f);
+
+  drive.run(2400.0, 900.0, 2.0e6, gatedError);
+  drive.run(900.0, 900.0, 1.0e6, gatedError);
+  CHECK(calculator->getMeasurementMode() == Mode::PERIOD);
+  CHECK(captureOwnsPin(backend));
+  CHECK_NEAR(calculator->getSpeedRpm(), 900.0f, 1.0f);
+  printf("%s: worst gated error %.3f %%\n", backend == CaptureBackend::MCPWM_CAPTURE ? "mcpwm" : "gpio",
+         gatedError * 100.0);
+}
+
+// A PCNT failure anywhere in the setup releases the unit and leaves period measurement working
+void testPulseCounterFailure() {
+  for (int failAt = 1; failAt <= 6; failAt++) {
+    hostPcntFailAt = failAt;
+    auto calculator = attached(CaptureBackend::GPIO_ISR, 1, 0);
+    CHECK(hostPcntUnits == 1);
+    CHECK(captureOwnsPin(CaptureBackend::GPIO_ISR));
+
+    Drive drive = {*calculator, CaptureBackend::GPIO_ISR, 1.0e6, 0.0};
+    double gatedError = 0.0;
+    drive.run(2400.0, 2400.0, 1.0e6, gatedError);
+    CHECK(calculator->getMeasurementMode() == Mode::PERIOD);
+    CHECK_NEAR(calculator->getSpeedRpm(), 2400.0f, 1.0f);
+  }
+  hostPcntFailAt = 0;
+}
+
+// Without any PCNT unit the calculator never leaves period measurement
+void testNoPulseCounter() {
+  auto calculator = attached(CaptureBackend::GPIO_ISR, 0, 0);
+  CHECK(captureOwnsPin(CaptureBackend::GPIO_ISR));
+  Drive drive = {*calculator, CaptureBackend::GPIO_ISR, 1.0e6, 0.0};
+  double gatedError = 0.0;
+  drive.run(2400.0, 2400.0, 1.0e6, gatedError);
+  CHECK(calculator->getMeasurementMode() == Mode::PERIOD);
+}
+
+}  // namespace
+
+int main() {
+  testSelector();
+  testSwitching(CaptureBackend::GPIO_ISR, 0);
+  testSwitching(CaptureBackend::MCPWM_CAPTURE, 1);
+  testPulseCounterFailure();
+  testNoPulseCounter();
+  return hostTestResult("test_frequency_mode");
+}
@@ -0,0 +1,100 @@
+// user-016: NO_FEEDBACK as the speed loop sees it, a slow start from standstill against a
+// dead sensor
+
+#include "HostTest.hpp"
+#include "HostMotor.hpp"
+#include "HallDiagnostics.hpp"
+#include "PwmGenerator.hpp"
+#include "PwmGroup.hpp"
+#include "SpeedController.hpp"
+
+namespace {
+
+constexpr float MAX_RPM = 600.0f;
+
+// The simulated motor behind a Hall input judged by the real diagnostics
+struct DiagnosedMotor : HostMotor {
+  HallDiagnostics diagnostics{true};
+  uint8_t driveDuty = 0;
+  bool deadSensor = false;
+
+  float getSpeedRpm() const { return deadSensor ? 0.0f : rpm; }
+  uint8_t getFaults() const { return diagnostics.getActiveFaults(); }
+  void setDriveDuty(uint8_t duty) { driveDuty = duty; }
+};
+
+using Controller = SpeedController<DiagnosedMotor, 1>;
+
+DiagnosedMotor *motor = nullptr;
+PwmGroup<1> *output = nullptr;
+uint32_t stepsLeft = 0;
+float firstEdgeSeconds = 0.0f;
+
+bool stepMotor(TickType_t ticks) {
+  motor->step(output->getDuty(0), ticks * portTICK_PERIOD_MS / 1000.0f);
+  motor->diagnostics.update(static_cast<uint32_t>(hostTimeMicros), motor->getSpeedRpm(), motor->driveDuty);
+  if (firstEdgeSeconds == 0.0f && motor->getSpeedRpm() > 0.0f) {
+    firstEdgeSeconds = hostTimeMicros / 1.0e6f;
+  }
+  return --stepsLeft > 0;
+}
+
+// Runs the loop from standstill at rpm for seconds, returns the controller's mode at the end
+Controller::Mode run(DiagnosedMotor &runMotor, float rpm, float seconds) {
+  PwmGenerator generator(GPIO_NUM_25);
+  generator.begin();
+  PwmGroup<1> group;
+  group.add(generator);
+  group.begin();
+
+  motor = &runMotor;
+  output = &group;
+  hostTimeMicros = 0;
+  firstEdgeSeconds = 0.0f;
+
+  Controller controller(group, MAX_RPM);
+  controller.add(runMotor);
+  TaskHandle_t handle = nullptr;
+  controller.begin(handle, 0);
+  controller.setSpeed(rpm);
+
+  hostDelayHook = stepMotor;
+  stepsLeft = static_cast<uint32_t>(seconds * 1000.0f) / Controller::CONTROL_PERIOD_MS;
+  try {
+    Controller::speedControllerTask(&controller);
+  } catch (const HostTaskExit &) {
+  }
+  hostDelayHook = nullptr;
+  return controller.getMode();
+}
+
+// Without a feedforward table the integrator alone lifts the duty to the breakaway duty,
+// seconds without an edge on a healthy sensor
+void testSlowStart() {
+  DiagnosedMotor healthy;
+  const Controller::Mode mode = run(healthy, 15.0f, 20.0f);
+  printf("15 rpm from standstill: first edge after %.1f s, %.2f rpm at 20 s, latched faults 0x%02x\n",
+         firstEdgeSeconds, healthy.rpm, static_cast<unsigned>(healthy.diagnostics.getLatchedFaults()));
+  CHECK(firstEdgeSeconds > 2.0f);   // Longer than the NO_FEEDBACK timeout
+  CHECK(healthy.diagnostics.getLatchedFaults() == 0);
+  CHECK(mode == Controller::Mode::CLOSED_LOOP);
+  CHECK_NEAR(healthy.rpm, 15.0f, 0.5f);
+}
+
+// A dead sensor still opens the loop at zero duty
+void testDeadSensor() {
+  DiagnosedMotor dead;
+  dead.deadSensor = true;
+  const Controller::Mode mode = run(dead, 300.0f, 10.0f);
+  CHECK(dead.diagnostics.getLatchedFaults() & HallDiagnostics::NO_FEEDBACK);
+  CHECK(mode == Controller::Mode::OPEN_LOOP);
+  CHECK(output->getDuty(0) == 0.0f);
+}
+
+}  // namespace
+
+int main() {
+  testSlowStart();
+  testDeadSensor();
+  return hostTestResult("test_hall_diagnostics");
+}
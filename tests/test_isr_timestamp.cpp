@@ -0,0 +1,160 @@
+// user-011: CCOUNT edge timestamps across the 32-bit wrap, and the host cost of the edge ISR
+// before and after the switch from esp_timer
+
+#include <chrono>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include "HostTest.hpp"
+#include "HostEdges.hpp"
+#include "BLDCPulseCalculator.hpp"
+
+namespace {
+
+constexpr uint32_t EDGES = MotorPulseCalculator::EDGES_PER_REVOLUTION;
+
+// CCOUNT at 240 MHz wraps every 2^32 / 240 us, ~17.9 s
+const double WRAP_US = 4294967296.0 / 240.0;
+
+std::unique_ptr<MotorPulseCalculator> attached() {
+  hostGpioPins[GPIO_NUM_32] = HostGpioPin{};
+  auto calculator = std::make_unique<MotorPulseCalculator>(GPIO_NUM_32, 1);
+  calculator->attach(nullptr);
+  return calculator;
+}
+
+// Runs steady edges through a window around each of the first wraps, returns the worst error
+double runAcrossWraps(MotorPulseCalculator &calculator, double rpm, double &time) {
+  const double period = hostEdgePeriod(rpm, EDGES);
+  double worst = 0.0;
+  for (int wrap = 1; wrap <= 3; wrap++) {
+    const double end = wrap * WRAP_US + 0.5e6;
+    while (time < end) {
+      time += period;
+      hostEdge(calculator, time);
+      if (time > wrap * WRAP_US - 0.5e6) {
+        worst = std::fmax(worst, std::fabs(calculator.getSpeedRpm() - rpm) / rpm);
+      }
+    }
+  }
+  return worst;
+}
+
+void testWrap() {
+  CHECK(hostCpuTicksPerMicro == 240);
+  for (double rpm : {60.0, 600.0, 1400.0}) {
+    auto calculator = attached();
+    double time = 0.0;
+    const double error = runAcrossWraps(*calculator, rpm, time);
+    printf("%6.0f rpm across 3 CCOUNT wraps: worst error %.4f %%\n", rpm, error * 100.0);
+    CHECK(error < 0.001);
+  }
+}
+
+// A stop longer than a whole wrap: the reference edge is dropped, never a period across it
+void testStopLongerThanWrap() {
+  auto calculator = attached();
+  const double period = hostEdgePeriod(600.0, EDGES);
+  double time = 1.0e6;
+  for (int i = 0; i < 4 * static_cast<int>(EDGES); i++) {
+    time += period;
+    hostEdge(*calculator, time);
+  }
+  CHECK_NEAR(calculator->getSpeedRpm(), 600.0f, 0.1f);
+
+  // The stopped wheel puts the phase of the next edge at the same CCOUNT modulo the wrap
+  time += WRAP_US + period;
+  hostTimeMicros = static_cast<int64_t>(time - period);
+  calculator->motorSpeed();
+  CHECK(calculator->getSpeedRpm() == 0.0f);
+
+  float peak = 0.0f;
+  for (int i = 0; i < 2 * static_cast<int>(EDGES); i++) {
+    hostEdge(*calculator, time);
+    peak = std::fmax(peak, calculator->getSpeedRpm());
+    time += period;
+  }
+  CHECK(peak < 601.0f);
+  CHECK_NEAR(calculator->getSpeedRpm(), 600.0f, 0.1f);
+}
+
+// The edge ISR of the original firmware: a 64-bit esp_timer read divided down to milliseconds
+// and the period bookkeeping done in interrupt context
+struct LegacyIsr {
+  volatile uint8_t counter = 0;
+  volatile unsigned long nextTimeStamp = 0;
+  volatile unsigned long timeStamp = 0;
+  volatile uint32_t timePeriodValues[32] = {};
+  volatile uint32_t newTimePeriodValues[16] = {};
+  volatile bool ready = false;
+
+  void calculateValuesInternal() {
+    timeStamp = esp_timer_get_time() / 1000;
+    timePeriodValues[counter] = static_cast<uint32_t>(timeStamp - nextTimeStamp);
+    counter = counter + 1;
+    nextTimeStamp = timeStamp;
+
+    if ((counter % 2) == 0 && counter != 0) {
+      newTimePeriodValues[counter / 2 - 1] = timePeriodValues[counter - 1] + timePeriodValues[counter - 2];
+    }
+
+    if (counter == 32) {
+      counter = 0;
+      ready = true;
+    }
+  }
+
+  static void wrapper(void *args) {
+    static_cast<LegacyIsr *>(args)->calculateValuesInternal();
+  }
+};
+
+// Host nanoseconds per edge of an ISR body. Edges come in revolutions, the speed task drains
+// the ring between them outside the timed part.
+template <typename Isr, typename Task>
+double nanosPerEdge(Isr isr, Task task) {
+  constexpr uint32_t REVOLUTIONS = 200000;
+  const double period = hostEdgePeriod(1000.0, EDGES);
+  double time = 1.0e6;
+  std::chrono::steady_clock::duration spent{};
+  for (uint32_t revolution = 0; revolution < REVOLUTIONS; revolution++) {
+    const auto start = std::chrono::steady_clock::now();
+    for (uint32_t edge = 0; edge < EDGES; edge++) {
+      time += period;
+      hostTimeMicros = static_cast<int64_t>(time);
+      isr();
+    }
+    spent += std::chrono::steady_clock::now() - start;
+    task();
+  }
+  return std::chrono::duration<double, std::nano>(spent).count() / (static_cast<double>(REVOLUTIONS) * EDGES);
+}
+
+void benchmark() {
+  LegacyIsr legacy;
+  const double legacyNanos = nanosPerEdge([&] { LegacyIsr::wrapper(&legacy); }, [] {});
+
+  // The present ISR body fed by esp_timer (the SPEED_ISR_ESP_TIMER_TIMESTAMP build) and by CCOUNT
+  auto timerCalculator = attached();
+  const double timerNanos = nanosPerEdge(
+    [&] { timerCalculator->calculateValuesInternal(static_cast<uint32_t>(esp_timer_get_time())); },
+    [&] { timerCalculator->motorSpeed(); });
+
+  auto cycleCalculator = attached();
+  const double cycleNanos = nanosPerEdge(
+    [&] { MotorPulseCalculator::staticCalculateValuesWrapper(cycleCalculator.get()); },
+    [&] { cycleCalculator->motorSpeed(); });
+
+  CHECK(cycleCalculator->getOverflowCount() == 0);
+  CHECK_NEAR(cycleCalculator->getSpeedRpm(), 1000.0f, 0.1f);
+  printf("host ns per edge: legacy %.2f, esp_timer %.2f, CCOUNT %.2f\n", legacyNanos, timerNanos, cycleNanos);
+}
+
+}  // namespace
+
+int main() {
+  testWrap();
+  testStopLongerThanWrap();
+  benchmark();
+  return hostTestResult("test_isr_timestamp");
+}
@@ -0,0 +1,67 @@
+// user-004: the sliding period window against a brute force sum, and its per-edge cost
+
+#include <chrono>
+#include <deque>
+#include <numeric>
+#include <random>
+#include "HostTest.hpp"
+#include "PeriodWindow.hpp"
+
+namespace {
+
+template <size_t N>
+void testAgainstBruteForce() {
+  PeriodWindow<N> window;
+  std::deque<uint32_t> reference;
+  std::mt19937 random(N);
+  std::uniform_int_distribution<uint32_t> period(100, 200000);
+
+  bool sumsMatch = true;
+  bool countsMatch = true;
+  for (int edge = 0; edge < 5000; edge++) {
+    const uint32_t value = period(random);
+    window.push(value);
+    reference.push_back(value);
+    if (reference.size() > N) reference.pop_front();
+
+    sumsMatch = sumsMatch && window.getSum() == std::accumulate(reference.begin(), reference.end(), 0u);
+    countsMatch = countsMatch && window.getCount() == reference.size() && window.isFull() == (reference.size() == N);
+  }
+  CHECK(sumsMatch);
+  CHECK(countsMatch);
+
+  window.reset();
+  CHECK(window.getSum() == 0);
+  CHECK(window.getCount() == 0);
+  CHECK(!window.isFull());
+}
+
+// Nanoseconds per push, the same for every window length
+template <size_t N>
+double pushCost() {
+  PeriodWindow<N> window;
+  constexpr uint32_t PUSHES = 20000000;
+  const auto start = std::chrono::steady_clock::now();
+  for (uint32_t edge = 0; edge < PUSHES; edge++) {
+    window.push(1000 + (edge & 0xFF));
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  volatile uint32_t sink = window.getSum();
+  (void)sink;
+  return std::chrono::duration<double, std::nano>(elapsed).count() / PUSHES;
+}
+
+}  // namespace
+
+int main() {
+  testAgainstBruteForce<1>();
+  testAgainstBruteForce<5>();
+  testAgainstBruteForce<32>();
+  testAgainstBruteForce<255>();
+
+  const double short8 = pushCost<8>();
+  const double long128 = pushCost<128>();
+  printf("push cost: window 8 %.2f ns, window 128 %.2f ns\n", short8, long128);
+
+  return hostTestResult("test_period_window");
+}
@@ -0,0 +1,213 @@
+// user-022: the PID against a simulated hub motor in float and Q16, its anti-windup and
+// derivative, and the SpeedController loop run through its own task
+
+#include <initializer_list>
+#include "HostTest.hpp"
+#include "HostMotor.hpp"
+#include "FixedPoint.hpp"
+#include "PidController.hpp"
+#include "PwmGenerator.hpp"
+#include "PwmGroup.hpp"
+#include "SpeedController.hpp"
+
+namespace {
+
+constexpr float SAMPLE_S = 0.02f;
+constexpr float MAX_RPM = HostMotor::FULL_RPM;
+constexpr float KP = 0.6f;
+constexpr float KI = 1.5f;
+
+struct Response {
+  float settleSeconds;    // Last time outside 2 % of the setpoint
+  float overshoot;        // Percent of the setpoint
+  float finalRpm;
+};
+
+// Runs the loop in normalized units for seconds, from the motor's present state
+template <typename T>
+Response run(PidController<T> &pid, HostMotor &motor, float rpm, float seconds, float *peakIntegral = nullptr) {
+  Response response = {0.0f, 0.0f, 0.0f};
+  float peak = 0.0f;
+  const int steps = static_cast<int>(seconds / SAMPLE_S);
+  for (int i = 1; i <= steps; i++) {
+    const float duty = static_cast<float>(pid.update(T(rpm / MAX_RPM), T(motor.rpm / MAX_RPM)));
+    motor.step(duty, SAMPLE_S);
+    if (peakIntegral != nullptr) *peakIntegral = std::fmax(*peakIntegral, static_cast<float>(pid.getIntegral()));
+    if (std::fabs(motor.rpm - rpm) > 0.02f * rpm) response.settleSeconds = i * SAMPLE_S;
+    peak = std::fmax(peak, motor.rpm);
+  }
+  response.overshoot = std::fmax(0.0f, (peak - rpm) / rpm * 100.0f);
+  response.finalRpm = motor.rpm;
+  return response;
+}
+
+template <typename T>
+PidController<T> makePid() {
+  PidController<T> pid{T(SAMPLE_S)};
+  pid.setGains(T(KP), T(KI), T(0.0f));
+  pid.setOutputLimits(T(0.0f), T(1.0f));
+  return pid;
+}
+
+template <typename T>
+void testSettling(const char *name) {
+  for (float load : {0.0f, 50.0f}) {
+    PidController<T> pid = makePid<T>();
+    HostMotor motor;
+    motor.load = load;
+    const Response response = run(pid, motor, 300.0f, 6.0f);
+    printf("%-5s load %3.0f rpm: settles in %.2f s, overshoot %.1f %%, final %.2f rpm\n", name, load,
+           response.settleSeconds, response.overshoot, response.finalRpm);
+    CHECK(response.settleSeconds < 3.0f);
+    CHECK(response.overshoot < 5.0f);
+    CHECK_NEAR(response.finalRpm, 300.0f, 1.0f);
+  }
+}
+
+// Q16 follows the float loop within its quantization
+void testFixedPointMatchesFloat() {
+  PidController<float> floatPid = makePid<float>();
+  PidController<Q16> fixedPid = makePid<Q16>();
+  HostMotor floatMotor;
+  HostMotor fixedMotor;
+  float worst = 0.0f;
+  for (int i = 0; i < 300; i++) {
+    const float floatDuty = floatPid.update(300.0f / MAX_RPM, floatMotor.rpm / MAX_RPM);
+    const float fixedDuty = static_cast<float>(fixedPid.update(Q16(300.0f / MAX_RPM), Q16(fixedMotor.rpm / MAX_RPM)));
+    floatMotor.step(floatDuty, SAMPLE_S);
+    fixedMotor.step(fixedDuty, SAMPLE_S);
+    worst = std::fmax(worst, std::fabs(floatDuty - fixedDuty));
+  }
+  printf("Q16 vs float: worst duty difference %.5f\n", worst);
+  CHECK(worst < 0.001f);
+}
+
+// The same loop with plain integration, for the windup comparison
+struct NaivePi {
+  float integral = 0.0f;
+  float update(float setpoint, float measurement) {
+    const float error = setpoint - measurement;
+    integral += KI * SAMPLE_S * error;
+    const float output = KP * error + integral;
+    return output < 0.0f ? 0.0f : (output > 1.0f ? 1.0f : output);
+  }
+};
+
+// Holds an unreachable setpoint, then asks for 300 rpm
+void testAntiWindup() {
+  PidController<float> pid = makePid<float>();
+  HostMotor motor;
+  float peakIntegral = 0.0f;
+  run(pid, motor, 700.0f, 5.0f, &peakIntegral);
+  CHECK(peakIntegral <= 1.0f);
+  const Response recovery = run(pid, motor, 300.0f, 4.0f);
+
+  NaivePi naive;
+  HostMotor naiveMotor;
+  for (int i = 0; i < 250; i++) naiveMotor.step(naive.update(700.0f / MAX_RPM, naiveMotor.rpm / MAX_RPM), SAMPLE_S);
+  const float naiveIntegral = naive.integral;
+  float naiveSettle = 0.0f;
+  for (int i = 1; i <= 1000; i++) {
+    naiveMotor.step(naive.update(300.0f / MAX_RPM, naiveMotor.rpm / MAX_RPM), SAMPLE_S);
+    if (std::fabs(naiveMotor.rpm - 300.0f) > 6.0f) naiveSettle = i * SAMPLE_S;
+  }
+
+  printf("after 5 s saturated: integral %.3f, back at 300 rpm in %.2f s (plain integration %.2f s, integral %.3f)\n",
+         peakIntegral, recovery.settleSeconds, naiveSettle, naiveIntegral);
+  CHECK(recovery.settleSeconds < naiveSettle);
+  CHECK_NEAR(recovery.finalRpm, 300.0f, 1.0f);
+}
+
+void testDerivativeOnMeasurement() {
+  PidController<float> pid{SAMPLE_S};
+  pid.setGains(0.0f, 0.0f, 0.1f);
+  pid.setOutputLimits(-1.0f, 1.0f);
+  pid.update(0.2f, 0.2f);
+  CHECK(pid.update(0.8f, 0.2f) == 0.0f);                      // Setpoint step, no kick
+  CHECK_NEAR(pid.update(0.8f, 0.21f), -0.1f * 0.01f / SAMPLE_S, 1e-6);  // Measurement moves
+
+  // reset() forgets the history, the first update after it has no derivative
+  pid.reset(0.0f);
+  CHECK(pid.update(0.8f, 0.5f) == 0.0f);
+}
+
+void testOutputLimits() {
+  PidController<float> pid = makePid<float>();
+  pid.setOutputLimits(0.0f, 0.5f);
+  for (int i = 0; i < 100; i++) CHECK(pid.update(1.0f, 0.0f) <= 0.5f);
+  CHECK(pid.update(1.0f, 0.0f) == 0.5f);
+  CHECK(pid.update(0.0f, 1.0f) == 0.0f);
+
+  // Bumpless: reset() continues from the given output
+  pid.reset(0.3f);
+  CHECK_NEAR(pid.update(0.5f, 0.5f), 0.3f, 1e-6);
+
+  // Invalid limits are ignored
+  pid.setOutputLimits(0.5f, 0.0f);
+  CHECK(pid.update(1.0f, 0.0f) == 0.5f);
+}
+
+// The whole loop: SpeedController's task with the motors stepped while it waits
+HostMotor taskMotors[2];
+PwmGroup<2> *taskOutput = nullptr;
+uint32_t taskStepsLeft = 0;
+
+bool stepTaskMotors(TickType_t ticks) {
+  const float seconds = ticks * portTICK_PERIOD_MS / 1000.0f;
+  for (uint8_t i = 0; i < 2; i++) {
+    taskMotors[i].step(taskOutput->getDuty(i), seconds);
+  }
+  return --taskStepsLeft > 0;
+}
+
+template <typename T>
+void testControllerTask(const char *name) {
+  PwmGenerator first(GPIO_NUM_25);
+  PwmGenerator second(GPIO_NUM_26, first);
+  first.begin();
+  second.begin();
+  PwmGroup<2> output;
+  output.add(first);
+  output.add(second);
+  output.begin();
+
+  taskMotors[0] = HostMotor{};
+  taskMotors[1] = HostMotor{};
+  taskMotors[1].load = 40.0f;
+  taskOutput = &output;
+
+  SpeedController<HostMotor, 2, T> controller(output, MAX_RPM);
+  controller.add(taskMotors[0]);
+  controller.add(taskMotors[1]);
+  TaskHandle_t handle = nullptr;
+  controller.begin(handle, 0);
+  controller.setSpeed(300.0f);
+
+  hostDelayHook = stepTaskMotors;
+  taskStepsLeft = 5000 / SpeedController<HostMotor, 2, T>::CONTROL_PERIOD_MS;
+  try {
+    SpeedController<HostMotor, 2, T>::speedControllerTask(&controller);
+  } catch (const HostTaskExit &) {
+  }
+  hostDelayHook = nullptr;
+
+  printf("%-5s SpeedController after 5 s: %.2f / %.2f rpm at duty %.3f / %.3f\n", name,
+         taskMotors[0].rpm, taskMotors[1].rpm, controller.getDuty(0), controller.getDuty(1));
+  CHECK_NEAR(taskMotors[0].rpm, 300.0f, 3.0f);
+  CHECK_NEAR(taskMotors[1].rpm, 300.0f, 3.0f);
+  CHECK(controller.getDuty(1) > controller.getDuty(0));
+}
+
+}  // namespace
+
+int main() {
+  testSettling<float>("float");
+  testSettling<Q16>("Q16");
+  testFixedPointMatchesFloat();
+  testAntiWindup();
+  testDerivativeOnMeasurement();
+  testOutputLimits();
+  testControllerTask<float>("float");
+  testControllerTask<Q16>("Q16");
+  return hostTestResult("test_pid_controller");
+}
@@ -0,0 +1,69 @@
+// user-020: group commits of the motor PWM channels, and commits that interrupt a ramp
+
+#include "HostTest.hpp"
+#include "PwmGenerator.hpp"
+#include "PwmGroup.hpp"
+
+namespace {
+
+// An instant command of the ramp's own target stops the fade and still reaches the output
+void testCommitDuringRamp(PwmGenerator &first, PwmGenerator &second, PwmGroup<2> &group) {
+  group.setPwm(0);
+  CHECK(group.rampTo(200, 3000));
+  CHECK(first.isRamping() && second.isRamping());
+  CHECK(first.getOutputDuty() == 0);
+
+  group.setPwm(200);
+  CHECK(!first.isRamping() && !second.isRamping());
+  CHECK(first.getOutputDuty() == 200);
+  CHECK(second.getOutputDuty() == 200);
+
+  // The immediate stop after a ramp down, and the stop after it
+  CHECK(group.rampTo(0, 3000));
+  group.setPwm(0);
+  CHECK(first.getOutputDuty() == 0);
+  CHECK(second.getOutputDuty() == 0);
+  group.setPwm(0);
+  CHECK(first.getOutputDuty() == 0);
+
+  // The speed loop committing the ramp target in full resolution
+  CHECK(group.rampTo(128, 3000));
+  const float duties[2] = {0.5f, 0.5f};
+  group.setDuties(duties);
+  CHECK(first.getOutputDuty() == 128);
+  CHECK(second.getOutputDuty() == 128);
+  CHECK(first.getDuty() == 0.5f);
+}
+
+// Unchanged duties are not committed, changed ones latch every channel in one commit
+void testCommits(PwmGenerator &first, PwmGenerator &second, PwmGroup<2> &group) {
+  group.setPwm(10);
+  const uint32_t commits = group.getCommitCount();
+  const uint32_t firstCommits = first.getCommitCount();
+  group.setPwm(10);
+  CHECK(group.getCommitCount() == commits);
+
+  const uint8_t values[2] = {10, 90};
+  group.setPwms(values);
+  CHECK(group.getCommitCount() == commits + 1);
+  CHECK(first.getCommitCount() == firstCommits);
+  CHECK(second.getOutputDuty() == 90);
+}
+
+}  // namespace
+
+int main() {
+  PwmGenerator first(GPIO_NUM_25);
+  PwmGenerator second(GPIO_NUM_26, first);
+  first.begin();
+  second.begin();
+  PwmGroup<2> group;
+  group.add(first);
+  group.add(second);
+  group.begin();
+  CHECK(group.isSynchronized());
+
+  testCommitDuringRamp(first, second, group);
+  testCommits(first, second, group);
+  return hostTestResult("test_pwm_group");
+}
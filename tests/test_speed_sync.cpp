@@ -0,0 +1,135 @@
+// user-023: synchronization of two motors when one of them is loaded, for every sync mode
+
+#include <initializer_list>
+#include "HostTest.hpp"
+#include "HostMotor.hpp"
+#include "PwmGenerator.hpp"
+#include "PwmGroup.hpp"
+#include "SpeedController.hpp"
+
+namespace {
+
+using Controller = SpeedController<HostMotor, 2>;
+
+constexpr float SETPOINT_RPM = 300.0f;
+constexpr float BASE_LOAD_RPM = 30.0f;
+constexpr float STEP_LOAD_RPM = 80.0f;      // Motor 2 only, from LOAD_STEP_S on
+constexpr float LOAD_STEP_S = 5.0f;
+constexpr float RUN_S = 10.0f;
+
+struct Result {
+  float peak;     // Sync error in percent of the setpoint after the load step
+  float final;
+};
+
+HostMotor motors[2];
+PwmGroup<2> *output = nullptr;
+float elapsedSeconds = 0.0f;
+float peakAfterStep = 0.0f;
+
+float syncError() {
+  return std::fabs(motors[0].rpm - motors[1].rpm) / SETPOINT_RPM * 100.0f;
+}
+
+void stepMotors(const float *duties, float seconds) {
+  elapsedSeconds += seconds;
+  if (elapsedSeconds >= LOAD_STEP_S) {
+    motors[1].load = STEP_LOAD_RPM;
+  }
+  for (uint8_t i = 0; i < 2; i++) {
+    motors[i].step(duties[i], seconds);
+  }
+  if (elapsedSeconds >= LOAD_STEP_S) {
+    peakAfterStep = std::fmax(peakAfterStep, syncError());
+  }
+}
+
+bool stepControlledMotors(TickType_t ticks) {
+  const float duties[2] = {output->getDuty(0), output->getDuty(1)};
+  stepMotors(duties, ticks * portTICK_PERIOD_MS / 1000.0f);
+  return elapsedSeconds < RUN_S;
+}
+
+void startRun() {
+  motors[0] = HostMotor{};
+  motors[1] = HostMotor{};
+  motors[0].load = BASE_LOAD_RPM;
+  motors[1].load = BASE_LOAD_RPM;
+  elapsedSeconds = 0.0f;
+  peakAfterStep = 0.0f;
+}
+
+// Both motors at the duty that runs an unloaded motor at the setpoint
+Result runOpenLoop() {
+  startRun();
+  const float duty = HostMotor::DEADBAND_DUTY + SETPOINT_RPM / HostMotor::FULL_RPM * (1.0f - HostMotor::DEADBAND_DUTY);
+  const float duties[2] = {duty, duty};
+  while (elapsedSeconds < RUN_S) {
+    stepMotors(duties, Controller::CONTROL_PERIOD_MS / 1000.0f);
+  }
+  return Result{peakAfterStep, syncError()};
+}
+
+Result runControlled(Controller::SyncMode mode, float couplingGain) {
+  PwmGenerator first(GPIO_NUM_25);
+  PwmGenerator second(GPIO_NUM_26, first);
+  first.begin();
+  second.begin();
+  PwmGroup<2> group;
+  group.add(first);
+  group.add(second);
+  group.begin();
+  output = &group;
+
+  startRun();
+  Controller controller(group, HostMotor::FULL_RPM);
+  controller.add(motors[0]);
+  controller.add(motors[1]);
+  TaskHandle_t handle = nullptr;
+  controller.begin(handle, 0);
+  controller.setSyncMode(mode);
+  controller.setCouplingGain(couplingGain);
+  controller.setSpeed(SETPOINT_RPM);
+
+  hostDelayHook = stepControlledMotors;
+  try {
+    Controller::speedControllerTask(&controller);
+  } catch (const HostTaskExit &) {
+  }
+  hostDelayHook = nullptr;
+
+  // The controller's own figure, from the speeds it read one period earlier
+  CHECK_NEAR(controller.getSyncError(), syncError(), 0.1f);
+  return Result{peakAfterStep, syncError()};
+}
+
+}  // namespace
+
+int main() {
+  printf("motor 2 load %.0f -> %.0f rpm at %.0f s, sync error in %% of %.0f rpm\n", BASE_LOAD_RPM, STEP_LOAD_RPM,
+         LOAD_STEP_S, SETPOINT_RPM);
+  printf("%-18s %8s %8s\n", "mode", "peak", "final");
+
+  const Result open = runOpenLoop();
+  printf("%-18s %8.2f %8.2f\n", "open loop", open.peak, open.final);
+
+  const Result independent = runControlled(Controller::SyncMode::INDEPENDENT, 1.0f);
+  printf("%-18s %8.2f %8.2f\n", "independent", independent.peak, independent.final);
+  CHECK(independent.final < 0.5f);
+
+  float previousPeak = independent.peak;
+  for (float gain : {1.0f, 2.0f, 4.0f}) {
+    const Result coupled = runControlled(Controller::SyncMode::CROSS_COUPLED, gain);
+    printf("cross-coupled k=%.0f %8.2f %8.2f\n", gain, coupled.peak, coupled.final);
+    CHECK(coupled.peak < 5.0f);
+    CHECK(coupled.peak < previousPeak);
+    CHECK(coupled.final < 0.5f);
+    previousPeak = coupled.peak;
+  }
+
+  const Result masterSlave = runControlled(Controller::SyncMode::MASTER_SLAVE, 1.0f);
+  printf("%-18s %8.2f %8.2f\n", "master/slave", masterSlave.peak, masterSlave.final);
+  CHECK(masterSlave.final < 0.5f);
+
+  return hostTestResult("test_speed_sync");
+}